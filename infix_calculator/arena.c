@@ -0,0 +1,99 @@
+/** 
+ * @file arena.c
+ * @author Jason Wang
+ * This program implements the arena that holds the scratch memory of one evaluation.
+ * Allocation bumps a pointer through a chain of blocks; a reset rewinds to the first block without freeing any,
+ * so once the blocks have grown to fit the largest expression seen, evaluating another one does not call malloc.
+ * Nothing is freed on its own, which also means a failure that longjmps out of an evaluation cannot leak.
+*/
+#include "arena.h"
+
+#include <stdlib.h>
+
+/**
+ * Creates an empty arena; the first block is allocated by the first allocation.
+ * @param arena the arena
+ */
+void arenaInit(Arena* arena)
+{
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+/**
+ * Allocates a block and links it in after the current one, so a reset still walks every block.
+ * @param arena the arena
+ * @param size bytes the block must hold at least
+ * @return the new block, or NULL if memory ran out
+ */
+static ArenaBlock* addBlock(Arena* arena, size_t size)
+{
+    if (size < ARENA_BLOCK_SIZE) {
+        size = ARENA_BLOCK_SIZE;
+    }
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = size;
+    if (arena->current == NULL) {
+        block->next = arena->first;
+        arena->first = block;
+    } else {
+        block->next = arena->current->next;
+        arena->current->next = block;
+    }
+    return block;
+}
+
+/**
+ * Allocates from the arena. The memory lives until the next reset.
+ * @param arena the arena
+ * @param size bytes wanted
+ * @return aligned memory for size bytes, or NULL if memory ran out
+ */
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (arena->current == NULL || arena->current->size - arena->used < size) {
+        // Move on to the next kept block if it is big enough, otherwise add one in front of it
+        ArenaBlock* next = arena->current == NULL ? arena->first : arena->current->next;
+        if (next == NULL || next->size < size) {
+            next = addBlock(arena, size);
+            if (next == NULL) {
+                return NULL;
+            }
+        }
+        arena->current = next;
+        arena->used = 0;
+    }
+    void* memory = arena->current->data + arena->used;
+    arena->used += size;
+    return memory;
+}
+
+/**
+ * Releases everything allocated since the last reset. Blocks stay allocated for the next evaluation.
+ * @param arena the arena
+ */
+void arenaReset(Arena* arena)
+{
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+/**
+ * Returns every block to malloc, leaving an empty arena.
+ * @param arena the arena
+ */
+void arenaFree(Arena* arena)
+{
+    ArenaBlock* block = arena->first;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arenaInit(arena);
+}
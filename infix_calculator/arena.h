@@ -0,0 +1,35 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/** Bytes in a block unless one allocation needs more. */
+#define ARENA_BLOCK_SIZE 65536
+
+/** Every allocation starts on a multiple of this. */
+#define ARENA_ALIGN 16
+
+/** One block of arena memory; blocks are chained and kept across resets. */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    _Alignas(ARENA_ALIGN) char data[];
+} ArenaBlock;
+
+/** Bump allocator whose memory is all released at once by a reset, and only returned to malloc when freed. */
+typedef struct {
+    ArenaBlock* first;
+    ArenaBlock* current;
+    size_t used;
+} Arena;
+
+/** Function to create an empty arena*/
+void arenaInit(Arena* arena);
+/** Function to allocate size bytes, or return NULL if memory runs out*/
+void* arenaAlloc(Arena* arena, size_t size);
+/** Function to release every allocation while keeping the blocks for reuse*/
+void arenaReset(Arena* arena);
+/** Function to return every block to malloc*/
+void arenaFree(Arena* arena);
+
+#endif /*ARENA_H*/
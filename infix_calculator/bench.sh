@@ -0,0 +1,81 @@
+#!/bin/bash
+# Benchmarks --rpn against infix on the same workloads. Each workload is generated once as expression trees and
+# written in both notations, then evaluated with --reduce sum on one evaluator thread, so the time measured is
+# reading, parsing and arithmetic rather than formatting output. Both runs must agree on the sum.
+# Usage: make && bash bench.sh [LINES]
+
+LINES=${1:-200000}
+FAIL=0
+
+# Writes LINES expressions of one shape to bench-infix.txt and bench-rpn.txt
+# $1 shape: chain (16 terms joined by + and -) or nested (random trees of + - * up to 5 deep)
+# $2 base of the literals, $3 prefix of every line (the "$base " of infix_n)
+generate() {
+  awk -v shape="$1" -v base="$2" -v prefix="$3" -v lines="$LINES" '
+    function digits(v,   s, d) {
+      s = ""
+      while (v > 0) { d = v % base; s = substr("0123456789ABCDEFGHIJKLMNOPQRSTUV", d + 1, 1) s; v = int(v / base) }
+      return s
+    }
+    function tree(depth,   op, leftIn, leftPost) {
+      if (depth == 0 || rand() < 0.25) { IN = digits(int(rand() * 999) + 1); POST = IN; return }
+      op = substr("+-*", int(rand() * 3) + 1, 1)
+      tree(depth - 1); leftIn = IN; leftPost = POST
+      tree(depth - 1)
+      IN = "(" leftIn " " op " " IN ")"; POST = leftPost " " POST " " op
+    }
+    BEGIN {
+      srand(42)
+      for (n = 0; n < lines; n++) {
+        if (shape == "chain") {
+          IN = digits(int(rand() * 999) + 1); POST = IN
+          for (t = 1; t < 16; t++) {
+            v = digits(int(rand() * 999) + 1); op = rand() < 0.5 ? "+" : "-"
+            IN = IN " " op " " v; POST = POST " " v " " op
+          }
+        } else {
+          tree(5)
+        }
+        print prefix IN > "bench-infix.txt"
+        print prefix POST > "bench-rpn.txt"
+      }
+    }'
+}
+
+# Prints the milliseconds a command takes, leaving its output in bench-output-$1.txt
+# $1 name of the output, then the command and its arguments, reading $2's input file last
+timed() {
+  local name=$1 input=$2
+  shift 2
+  local start=$(date +%s%N)
+  "$@" < "$input" > "bench-output-$name.txt"
+  local end=$(date +%s%N)
+  echo $(( (end - start) / 1000000 ))
+}
+
+printf "%-9s %-7s %8s %10s %10s %8s\n" program shape lines infix_ms rpn_ms speedup
+for program in infix_10 infix_32 infix_n ; do
+  if [ ! -x $program ]; then
+    echo "**** $program is not built; run make first"
+    FAIL=1
+    continue
+  fi
+  case $program in
+    infix_10) base=10; prefix="" ;;
+    infix_32) base=32; prefix="" ;;
+    infix_n) base=16; prefix="\$16 " ;;
+  esac
+  for shape in chain nested ; do
+    generate $shape $base "$prefix"
+    infix=$(timed infix bench-infix.txt ./$program --overflow wrap --reduce sum 1)
+    rpn=$(timed rpn bench-rpn.txt ./$program --overflow wrap --rpn --reduce sum 1)
+    if ! cmp -s bench-output-infix.txt bench-output-rpn.txt ; then
+      echo "**** $program $shape: the notations disagree"
+      FAIL=1
+    fi
+    printf "%-9s %-7s %8d %10d %10d %7.2fx\n" $program $shape $LINES $infix $rpn \
+      $(awk -v a=$infix -v b=$rpn 'BEGIN { print (b > 0 ? a / b : 0) }')
+  done
+done
+rm -f bench-infix.txt bench-rpn.txt bench-output-infix.txt bench-output-rpn.txt
+exit $FAIL
@@ -0,0 +1,351 @@
+/**
+ * @file capture.c
+ * @author Jason Wang
+ * This program writes and reads capture logs for --capture and --replay. Each evaluated expression is appended
+ * as one compact record: its text, when it arrived, how long it took and what came of it, with the numbers as
+ * LEB128 varints so a short expression costs a few bytes beyond its text. Every thread fills a buffer of its own
+ * and appends it whole under the log's lock, so capturing adds a copy and no contention per expression.
+*/
+#include "capture.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "context.h"
+#include "operation.h"
+
+/** Status bit of a record whose value a policy that keeps going had to wrap or saturate. */
+#define CAPTURE_OVERFLOWED 0x100
+
+/** The overflow policies, in the order a header numbers them. */
+static const OverflowPolicy* const POLICIES[] = { &OVERFLOW_TRAP, &OVERFLOW_WRAP, &OVERFLOW_SATURATE };
+
+/**
+ * Describes the settings of a context, those that change results, in a header.
+ * @param header the header
+ * @param context the context
+ */
+void captureHeaderInit(CaptureHeader* header, const EvalContext* context)
+{
+    memset(header, 0, sizeof(CaptureHeader));
+    header->program = context->program;
+    header->modulus = context->modulus.value;
+    header->flags = context->rpn ? CAPTURE_RPN : 0;
+    header->length = context->limits.length;
+    header->depth = context->limits.depth;
+    header->operations = context->limits.operations;
+    for (int i = 0; i < (int)(sizeof(POLICIES) / sizeof(POLICIES[0])); i++) {
+        if (context->overflow == POLICIES[i]) {
+            header->overflow = i;
+        }
+    }
+}
+
+/**
+ * Gives a context the settings a log was captured with, so its expressions evaluate as they did.
+ * @param context the context
+ * @param header the log's header
+ * @return 0, or -1 if the log was captured by another program or its settings are not valid
+ */
+int captureApplyHeader(EvalContext* context, const CaptureHeader* header)
+{
+    if (header->program != context->program || header->overflow < 0
+        || header->overflow >= (int)(sizeof(POLICIES) / sizeof(POLICIES[0])) || (header->flags & ~CAPTURE_RPN) != 0) {
+        return -1;
+    }
+    context->overflow = POLICIES[header->overflow];
+    context->rpn = (header->flags & CAPTURE_RPN) != 0;
+    // The time cap stays the replay's own
+    context->limits.length = header->length;
+    context->limits.depth = header->depth;
+    context->limits.operations = header->operations;
+    if (header->modulus == 0) {
+        context->modulus.value = 0;
+        return 0;
+    }
+    return modulusInit(&context->modulus, header->modulus) == 0 ? 0 : -1;
+}
+
+/**
+ * Write all of a buffer to a file descriptor.
+ * @param fd the file descriptor
+ * @param data the bytes
+ * @param size how many
+ * @return true if all were written
+ */
+static bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * Creates a log, replacing any file at the path, and writes its header.
+ * @param path the path
+ * @param header the header, whose magic number and version are filled in
+ * @return the log, or NULL if it could not be created
+ */
+CaptureLog* captureLogCreate(const char* path, const CaptureHeader* header)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    CaptureHeader written = *header;
+    memcpy(written.magic, CAPTURE_MAGIC, sizeof(written.magic));
+    written.version = CAPTURE_VERSION;
+    CaptureLog* log = malloc(sizeof(CaptureLog));
+    if (log == NULL || !writeAll(fd, &written, sizeof(written))) {
+        free(log);
+        close(fd);
+        return NULL;
+    }
+    pthread_mutex_init(&log->lock, NULL);
+    log->fd = fd;
+    log->start = latencyNow();
+    return log;
+}
+
+/**
+ * Closes a log. Every buffer must have been freed first, or its records are lost.
+ * @param log the log
+ */
+void captureLogClose(CaptureLog* log)
+{
+    close(log->fd);
+    pthread_mutex_destroy(&log->lock);
+    free(log);
+}
+
+/**
+ * Creates an empty buffer for a thread.
+ * @param log the log it appends to
+ * @return the buffer, or NULL if memory ran out, in which case the thread captures nothing
+ */
+CaptureBuffer* captureBufferCreate(CaptureLog* log)
+{
+    CaptureBuffer* buffer = malloc(sizeof(CaptureBuffer));
+    if (buffer != NULL) {
+        buffer->log = log;
+        buffer->used = 0;
+    }
+    return buffer;
+}
+
+/**
+ * Append a buffer's records to the log and empty it.
+ * A failed write loses those records rather than the evaluation, which capturing must never change.
+ * @param buffer the buffer
+ */
+static void flush(CaptureBuffer* buffer)
+{
+    CaptureLog* log = buffer->log;
+    pthread_mutex_lock(&log->lock);
+    writeAll(log->fd, buffer->data, buffer->used);
+    pthread_mutex_unlock(&log->lock);
+    buffer->used = 0;
+}
+
+/**
+ * Append an unsigned LEB128 varint: seven bits per byte, low bits first, the top bit set on all but the last.
+ * @param buffer the buffer, with room for ten bytes
+ * @param value the value
+ */
+static void putVarint(CaptureBuffer* buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer->data[buffer->used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->used++] = (unsigned char)value;
+}
+
+/**
+ * Starts a record. The text is copied now, since evaluating it removes its whitespace in place.
+ * @param buffer the thread's buffer
+ * @param arrival monotonic clock reading when the expression arrived
+ * @param text the expression
+ * @param length its length; only the first MAX_SIZE bytes are kept, which still fail as too long when replayed
+ */
+void captureBegin(CaptureBuffer* buffer, uint64_t arrival, const char* text, size_t length)
+{
+    if (length > MAX_SIZE) {
+        length = MAX_SIZE;
+    }
+    if (buffer->used + length + CAPTURE_FIXED > CAPTURE_BUFFER) {
+        flush(buffer);
+    }
+    putVarint(buffer, arrival - buffer->log->start);
+    putVarint(buffer, length);
+    memcpy(buffer->data + buffer->used, text, length);
+    buffer->used += length;
+}
+
+/**
+ * Finishes the record captureBegin started.
+ * @param buffer the thread's buffer
+ * @param nanoseconds how long the evaluation took
+ * @param base the base of the result
+ * @param status 0 or the exit status the expression produced
+ * @param overflowed whether a policy that keeps going overflowed
+ * @param result the value, when status is 0
+ */
+void captureEnd(CaptureBuffer* buffer, uint64_t nanoseconds, int base, int status, bool overflowed, long result)
+{
+    putVarint(buffer, nanoseconds);
+    putVarint(buffer, base);
+    putVarint(buffer, status | (overflowed ? CAPTURE_OVERFLOWED : 0));
+    // Zigzag encoding keeps small negative results short too
+    putVarint(buffer, ((uint64_t)result << 1) ^ (uint64_t)(result >> 63));
+}
+
+/**
+ * Appends what is left in a buffer to its log and frees it.
+ * @param buffer the buffer
+ */
+void captureBufferFree(CaptureBuffer* buffer)
+{
+    if (buffer->used > 0) {
+        flush(buffer);
+    }
+    free(buffer);
+}
+
+/**
+ * Read an unsigned LEB128 varint.
+ * @param at the next byte, advanced past the varint
+ * @param end the end of the log
+ * @param value set to the value
+ * @return false if the log ends inside the varint or it is longer than 64 bits
+ */
+static bool getVarint(const unsigned char** at, const unsigned char* end, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*at == end) {
+            return false;
+        }
+        unsigned char byte = *(*at)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Order records by arrival; each thread's records are in order, but the threads' buffers are interleaved.
+ * Records that arrived at the same time keep the order of the log.
+ * @param a a record
+ * @param b another record
+ * @return negative, 0 or positive as a arrived before, with or after b
+ */
+static int byArrival(const void* a, const void* b)
+{
+    const CaptureRecord* left = a;
+    const CaptureRecord* right = b;
+    if (left->arrival != right->arrival) {
+        return left->arrival < right->arrival ? -1 : 1;
+    }
+    return left->text < right->text ? -1 : left->text > right->text;
+}
+
+/**
+ * Maps a log and decodes every record. The records' text points into the mapping.
+ * @param path the log
+ * @param file filled in on success
+ * @return 0, or -1 if the log cannot be read, is not a capture log of this version, is cut short, or has a text
+ *         longer than captureBegin keeps
+ */
+int captureLoad(const char* path, CaptureFile* file)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(CaptureHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    *file = (CaptureFile){ .map = map, .size = info.st_size };
+    memcpy(&file->header, map, sizeof(CaptureHeader));
+    if (memcmp(file->header.magic, CAPTURE_MAGIC, sizeof(file->header.magic)) != 0 || file->header.version != CAPTURE_VERSION) {
+        captureUnload(file);
+        return -1;
+    }
+
+    const unsigned char* at = (const unsigned char*)map + sizeof(CaptureHeader);
+    const unsigned char* end = (const unsigned char*)map + file->size;
+    size_t capacity = 0;
+    while (at < end) {
+        uint64_t arrival, length, nanoseconds, base, status, result;
+        if (!getVarint(&at, end, &arrival) || !getVarint(&at, end, &length) || length > MAX_SIZE
+            || length > (uint64_t)(end - at)) {
+            captureUnload(file);
+            return -1;
+        }
+        const char* text = (const char*)at;
+        at += length;
+        if (!getVarint(&at, end, &nanoseconds) || !getVarint(&at, end, &base) || !getVarint(&at, end, &status)
+            || !getVarint(&at, end, &result)) {
+            captureUnload(file);
+            return -1;
+        }
+        if (file->count == capacity) {
+            capacity = capacity == 0 ? 1024 : capacity * 2;
+            CaptureRecord* records = realloc(file->records, capacity * sizeof(CaptureRecord));
+            if (records == NULL) {
+                captureUnload(file);
+                return -1;
+            }
+            file->records = records;
+        }
+        file->records[file->count++] = (CaptureRecord){
+            .arrival = arrival,
+            .nanoseconds = nanoseconds,
+            .base = (int)base,
+            .status = (int)(status & ~CAPTURE_OVERFLOWED),
+            .overflowed = (status & CAPTURE_OVERFLOWED) != 0,
+            .result = (long)((result >> 1) ^ (0 - (result & 1))),
+            .text = text,
+            .length = length,
+        };
+    }
+    qsort(file->records, file->count, sizeof(CaptureRecord), byArrival);
+    return 0;
+}
+
+/**
+ * Unmaps a loaded log and frees its records.
+ * @param file the log
+ */
+void captureUnload(CaptureFile* file)
+{
+    free(file->records);
+    munmap(file->map, file->size);
+    file->records = NULL;
+    file->count = 0;
+}
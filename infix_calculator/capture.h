@@ -0,0 +1,106 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+struct EvalContext;
+
+/** First bytes of a capture log. */
+#define CAPTURE_MAGIC "INFIXCAP"
+
+/** Version of the log format, raised whenever it changes. */
+#define CAPTURE_VERSION 2
+
+/** Header flag of a log of postfix expressions (--rpn). */
+#define CAPTURE_RPN 1
+
+/** Bytes a thread buffers before appending them to the log. */
+#define CAPTURE_BUFFER 65536
+
+/** Most bytes of a record besides its text: six varints of at most ten bytes. */
+#define CAPTURE_FIXED 60
+
+/** Start of a capture log: what a replay needs to evaluate the expressions as they were. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    /** PROGRAM_10, PROGRAM_32 or PROGRAM_N */
+    int32_t program;
+    /** The modulus of --mod, 0 for none */
+    int64_t modulus;
+    /** The --overflow policy: 0 trap, 1 wrap, 2 saturate */
+    int32_t overflow;
+    /** CAPTURE_RPN if the expressions are postfix; other bits are reserved and 0 */
+    uint32_t flags;
+    /** The length, depth and operation caps of --limit, 0 for none; CPU time differs between runs and is not kept */
+    uint64_t length;
+    uint64_t depth;
+    uint64_t operations;
+} CaptureHeader;
+
+/** One log shared by every thread of a run. */
+typedef struct CaptureLog {
+    pthread_mutex_t lock;
+    int fd;
+    /** Monotonic clock reading that arrival times count from */
+    uint64_t start;
+} CaptureLog;
+
+/**
+ * Records of one thread, appended to the log a buffer at a time so threads rarely take the lock.
+ * A record is varints of the arrival time, the text's length, the text itself, then varints of the evaluation
+ * time, the base, the status (with 0x100 set when a policy that keeps going overflowed) and the zigzagged result.
+ */
+typedef struct {
+    CaptureLog* log;
+    size_t used;
+    unsigned char data[CAPTURE_BUFFER];
+} CaptureBuffer;
+
+/** One record read back from a log. */
+typedef struct {
+    /** Nanoseconds after the log started that the expression arrived */
+    uint64_t arrival;
+    uint64_t nanoseconds;
+    int base;
+    int status;
+    bool overflowed;
+    long result;
+    const char* text;
+    size_t length;
+} CaptureRecord;
+
+/** A log read back, mapped into memory. */
+typedef struct {
+    CaptureHeader header;
+    CaptureRecord* records;
+    size_t count;
+    void* map;
+    size_t size;
+} CaptureFile;
+
+/** Function to describe a context's settings in a header*/
+void captureHeaderInit(CaptureHeader* header, const struct EvalContext* context);
+/** Function to give a context the settings a header describes; 0 if they are valid for its program*/
+int captureApplyHeader(struct EvalContext* context, const CaptureHeader* header);
+/** Function to create a log, writing its header, or return NULL*/
+CaptureLog* captureLogCreate(const char* path, const CaptureHeader* header);
+/** Function to close a log once every buffer is freed*/
+void captureLogClose(CaptureLog* log);
+/** Function to give a thread a buffer of its own for a log*/
+CaptureBuffer* captureBufferCreate(CaptureLog* log);
+/** Function to start a record with an expression's text, before it is evaluated in place*/
+void captureBegin(CaptureBuffer* buffer, uint64_t arrival, const char* text, size_t length);
+/** Function to finish the record with the evaluation's outcome*/
+void captureEnd(CaptureBuffer* buffer, uint64_t nanoseconds, int base, int status, bool overflowed, long result);
+/** Function to append a buffer's records to its log and free it*/
+void captureBufferFree(CaptureBuffer* buffer);
+/** Function to map a log and decode its records, sorted by arrival; 0 on success*/
+int captureLoad(const char* path, CaptureFile* file);
+/** Function to release a loaded log*/
+void captureUnload(CaptureFile* file);
+
+#endif /*CAPTURE_H*/
@@ -0,0 +1,239 @@
+/** 
+ * @file columns.c
+ * @author Jason Wang
+ * This program evaluates binary column files: each row of two little-endian int64 columns is combined with a fixed
+ * operator, producing an int64 result column and a one-byte status column. Nothing is converted to or from text;
+ * the columns move through large aligned blocks with plain read and write calls.
+*/
+#include "columns.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <endian.h>
+#include <sys/stat.h>
+
+#include "operation.h"
+
+/**
+ * Read until the buffer is full or the file ends.
+ * @param fd the file to read
+ * @param buffer where to read to
+ * @param size how many bytes to read
+ * @return the number of bytes read, or -1 on error
+ */
+static ssize_t readFully(int fd, void* buffer, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, (char*)buffer + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * Write the whole buffer.
+ * @param fd the file to write
+ * @param buffer what to write
+ * @param size how many bytes
+ * @return 0, or -1 on error
+ */
+static int writeFully(int fd, const void* buffer, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, (const char*)buffer + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/**
+ * Evaluate one block of rows modulo --mod in place, as a line would: both operands are reduced, except the
+ * exponent of ^, which stays an ordinary integer. A divisor with no inverse fails its row with FAIL_DIVZERO.
+ * @param context the evaluation context, whose modulus is used
+ * @param op the operator
+ * @param left the left operands, replaced by the results
+ * @param right the right operands
+ * @param status one status byte per row
+ * @param rows how many rows
+ */
+static void evaluateBlockModular(EvalContext* context, char op, int64_t* left, const int64_t* right, uint8_t* status,
+                                 size_t rows)
+{
+    const Modulus* modulus = &context->modulus;
+    jmp_buf recovery;
+    volatile size_t i = 0;
+    context->recovery = &recovery;
+    if (setjmp(recovery) != 0) {
+        // The row at i failed; the loop goes on from the next one
+        left[i] = 0;
+        status[i] = context->status;
+        i++;
+    }
+    for (; i < rows; i++) {
+        long a = modReduce(modulus, (long)le64toh(left[i]));
+        long b = (long)le64toh(right[i]);
+        left[i] = htole64(modApplyOp(context, modulus, a, op == '^' ? b : modReduce(modulus, b), op));
+        status[i] = 0;
+    }
+    context->recovery = NULL;
+}
+
+/**
+ * Evaluate one block of rows in place: results overwrite the left column.
+ * Under a policy that keeps going, an overflowing row gets the policy's value and FAIL_OVERFLOW as its status.
+ * @param context the evaluation context, whose modulus or overflow policy is used
+ * @param op the operator
+ * @param left the left operands, replaced by the results
+ * @param right the right operands
+ * @param status one status byte per row
+ * @param rows how many rows
+ */
+static void evaluateBlock(EvalContext* context, char op, int64_t* left, const int64_t* right, uint8_t* status,
+                          size_t rows)
+{
+    if (context->modulus.value != 0) {
+        evaluateBlockModular(context, op, left, right, status, rows);
+        return;
+    }
+    if (context->overflow != &OVERFLOW_TRAP) {
+        PolicyOp apply = context->overflow->ops[(unsigned char)op];
+        for (size_t i = 0; i < rows; i++) {
+            long a = (long)le64toh(left[i]);
+            long b = (long)le64toh(right[i]);
+            // The policy's operators fail on these, which would end the run instead of the row
+            if ((op == '/' && b == 0) || (op == '^' && b < 0)) {
+                left[i] = 0;
+                status[i] = op == '/' ? FAIL_DIVZERO : FAIL_NEGEXP;
+                continue;
+            }
+            context->overflowed = false;
+            left[i] = htole64(apply(context, a, b));
+            status[i] = context->overflowed ? FAIL_OVERFLOW : 0;
+        }
+        return;
+    }
+    for (size_t i = 0; i < rows; i++) {
+        long result = 0;
+        int rowStatus = tryApplyOp((long)le64toh(left[i]), (long)le64toh(right[i]), op, &result);
+        left[i] = htole64(rowStatus == 0 ? result : 0);
+        status[i] = rowStatus;
+    }
+}
+
+/**
+ * Check whether a path names an open file, so an output column is never one of the inputs it would truncate.
+ * @param path the path
+ * @param fd the open file
+ * @return true if they are the same file
+ */
+static bool isSameFile(const char* path, int fd)
+{
+    struct stat named;
+    struct stat open;
+    return stat(path, &named) == 0 && fstat(fd, &open) == 0 && named.st_dev == open.st_dev && named.st_ino == open.st_ino;
+}
+
+/**
+ * Applies op to every row of two int64 column files of equal length and writes the results and statuses.
+ * A failing row gets a result of 0 and its exit status (FAIL_OVERFLOW, FAIL_DIVZERO, FAIL_NEGEXP) in the status
+ * column; the other rows are still evaluated.
+ * @param context the evaluation context; under its wrap or saturate policy an overflowing row keeps its value,
+ *        and under --mod every row is a residue
+ * @param op the operator, one of + - * / ^
+ * @param leftPath the left operand column
+ * @param rightPath the right operand column
+ * @param resultPath the result column to create
+ * @param statusPath the status column to create
+ * @return 0 once every row has been written, or FAIL_INPUT if the operator or the files are unusable; nothing is
+ *         created or truncated until the operator and the inputs have been checked
+ */
+int evaluateColumns(EvalContext* context, char op, const char* leftPath, const char* rightPath,
+                    const char* resultPath, const char* statusPath)
+{
+    int status = FAIL_INPUT;
+    int64_t* left = NULL;
+    int64_t* right = NULL;
+    uint8_t* rowStatus = NULL;
+    int leftFd = -1;
+    int rightFd = -1;
+    int resultFd = -1;
+    int statusFd = -1;
+
+    if (!isOperator(op)) {
+        fprintf(stderr, "Error: The operator must be one of + - * / ^.\n");
+        goto done;
+    }
+    leftFd = open(leftPath, O_RDONLY);
+    rightFd = open(rightPath, O_RDONLY);
+    if (leftFd < 0 || rightFd < 0) {
+        fprintf(stderr, "Error: Cannot open the column files.\n");
+        goto done;
+    }
+    if (isSameFile(resultPath, leftFd) || isSameFile(resultPath, rightFd)
+        || isSameFile(statusPath, leftFd) || isSameFile(statusPath, rightFd)) {
+        fprintf(stderr, "Error: The result columns must not be the operand columns.\n");
+        goto done;
+    }
+    resultFd = open(resultPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    statusFd = open(statusPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (resultFd < 0 || statusFd < 0) {
+        fprintf(stderr, "Error: Cannot open the column files.\n");
+        goto done;
+    }
+    if (posix_memalign((void**)&left, COLUMN_ALIGNMENT, COLUMN_BLOCK * sizeof(int64_t)) != 0
+        || posix_memalign((void**)&right, COLUMN_ALIGNMENT, COLUMN_BLOCK * sizeof(int64_t)) != 0
+        || posix_memalign((void**)&rowStatus, COLUMN_ALIGNMENT, COLUMN_BLOCK) != 0) {
+        goto done;
+    }
+
+    for (;;) {
+        ssize_t leftBytes = readFully(leftFd, left, COLUMN_BLOCK * sizeof(int64_t));
+        ssize_t rightBytes = readFully(rightFd, right, COLUMN_BLOCK * sizeof(int64_t));
+        if (leftBytes < 0 || rightBytes < 0 || leftBytes != rightBytes || leftBytes % sizeof(int64_t) != 0) {
+            fprintf(stderr, "Error: The columns differ in length or are not int64 columns.\n");
+            goto done;
+        }
+        if (leftBytes == 0) {
+            break;
+        }
+        size_t rows = leftBytes / sizeof(int64_t);
+        evaluateBlock(context, op, left, right, rowStatus, rows);
+        if (writeFully(resultFd, left, leftBytes) != 0 || writeFully(statusFd, rowStatus, rows) != 0) {
+            fprintf(stderr, "Error: Cannot write the result columns.\n");
+            goto done;
+        }
+    }
+    status = 0;
+
+done:
+    free(left);
+    free(right);
+    free(rowStatus);
+    if (leftFd >= 0) close(leftFd);
+    if (rightFd >= 0) close(rightFd);
+    if (resultFd >= 0) close(resultFd);
+    if (statusFd >= 0) close(statusFd);
+    return status;
+}
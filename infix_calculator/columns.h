@@ -0,0 +1,16 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "context.h"
+
+/** Number of int64 values read, evaluated and written per block. */
+#define COLUMN_BLOCK 65536
+
+/** Alignment of the column buffers. */
+#define COLUMN_ALIGNMENT 64
+
+/** Function to apply an operator row by row to two little-endian int64 column files*/
+int evaluateColumns(EvalContext* context, char op, const char* leftPath, const char* rightPath,
+                    const char* resultPath, const char* statusPath);
+
+#endif /*COLUMNS_H*/
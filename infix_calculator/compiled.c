@@ -0,0 +1,745 @@
+/**
+ * @file compiled.c
+ * @author Jason Wang
+ * This program saves expressions compiled ahead of time for --compile and evaluates them for --load, so a file of
+ * expressions that is evaluated again and again is read, checked and parsed once. Each non-blank line becomes one
+ * record: the base of its result and either the status its checks fail with, or postfix code for one operand
+ * stack, with literals as zigzagged LEB128 varints. The code keeps the order a line is evaluated in, so a syntax
+ * error or an overflowing literal becomes an instruction failing where the parser would have stopped, and nesting
+ * deeper than ever before in the line an instruction checking --limit depth where the parser would have checked it.
+ * The file starts with a fixed header whose numbers are all little-endian, whatever the machine, and ends the
+ * header with an FNV-1a checksum of the records. Loading maps the file and checks the header, the checksum and
+ * every record's code once; evaluating then reads the code straight from the mapping.
+*/
+#include "compiled.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "radix.h"
+#include "operation.h"
+#include "probes.h"
+
+/** Bytes of records buffered at first when compiling, and of output formatted before it is written. */
+#define COMPILED_CHUNK 65536
+
+/** Binding power and associativity of a binary operator, as in infix.c. */
+typedef struct {
+    unsigned char precedence;
+    bool rightAssociative;
+} CompiledOperator;
+
+/** Binary operators indexed by their character; a precedence of 0 means "not an operator". */
+static const CompiledOperator OPERATORS[UCHAR_MAX + 1] = {
+    ['+'] = { 1, false },
+    ['-'] = { 1, false },
+    ['*'] = { 2, false },
+    ['/'] = { 2, false },
+    ['^'] = { 3, true },
+};
+
+/** The records of a file being compiled. */
+typedef struct {
+    unsigned char* data;
+    size_t used;
+    size_t capacity;
+} CompiledBody;
+
+/** Everything the compiler carries through one line. */
+typedef struct {
+    const char* text;
+    int next;
+    unsigned char* code;
+    size_t length;
+    /** Values on the stack after the instructions so far, and the most there have been */
+    size_t depth;
+    size_t maxDepth;
+    /** Levels of nesting open, counted where parse_climb and parse_operand count them for --limit depth */
+    size_t nesting;
+    size_t maxNesting;
+    /** Where a line that cannot compile further stops, once its failing instruction is emitted */
+    jmp_buf stop;
+} Compiler;
+
+/** One record, decoded as far as its code. */
+typedef struct {
+    int base;
+    int status;
+    size_t stack;
+    const unsigned char* code;
+    const unsigned char* end;
+} CompiledRecord;
+
+/**
+ * Check whether a line has anything but whitespace; blank lines are skipped as --pipeline skips them.
+ * @param line the line
+ * @param length its length
+ * @return true if the line is blank
+ */
+static bool isBlank(const char* line, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '\v' && line[i] != '\f') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check for a decimal digit; the compiler only sees expressions already converted to base 10.
+ * @param c the character
+ * @return true if it is one
+ */
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * Append an unsigned LEB128 varint: seven bits per byte, low bits first, the top bit set on all but the last.
+ * @param out the next byte, advanced past the varint, with room for ten bytes
+ * @param value the value
+ */
+static void putVarint(unsigned char** out, uint64_t value)
+{
+    while (value >= 0x80) {
+        *(*out)++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *(*out)++ = (unsigned char)value;
+}
+
+/**
+ * Read an unsigned LEB128 varint.
+ * @param at the next byte, advanced past the varint
+ * @param end the end of the records
+ * @param value set to the value
+ * @return false if the records end inside the varint or it is longer than 64 bits
+ */
+static bool getVarint(const unsigned char** at, const unsigned char* end, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*at == end) {
+            return false;
+        }
+        unsigned char byte = *(*at)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Read a varint of code that loading has already checked.
+ * @param at the next byte, advanced past the varint
+ * @return the value
+ */
+static inline uint64_t readVarint(const unsigned char** at)
+{
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = *(*at)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+}
+
+/**
+ * Store a number little-endian, so the file reads the same on any machine.
+ * @param out where to store it
+ * @param value the number
+ * @param bytes how many bytes it takes
+ */
+static void storeLittle(unsigned char* out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * Load a number stored little-endian.
+ * @param in where it is stored
+ * @param bytes how many bytes it takes
+ * @return the number
+ */
+static uint64_t loadLittle(const unsigned char* in, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * FNV-1a hash of the records, which the header carries to catch a damaged file.
+ * @param data the records
+ * @param size their size
+ * @return the hash
+ */
+static uint64_t checksum(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211u;
+    }
+    return hash;
+}
+
+/**
+ * Emit an instruction failing with a status and stop compiling the line.
+ * @param compiler the compiler
+ * @param status the status the line fails with when it gets this far
+ */
+static void __attribute__((noreturn)) compileFail(Compiler* compiler, int status)
+{
+    unsigned char* out = compiler->code + compiler->length;
+    *out++ = COMPILED_FAIL;
+    putVarint(&out, status);
+    compiler->length = out - compiler->code;
+    longjmp(compiler->stop, 1);
+}
+
+/**
+ * Emit an instruction, keeping track of the stack depth.
+ * @param compiler the compiler
+ * @param instruction COMPILED_NEGATE or an operator
+ * @param modular whether it is reduced by --mod
+ */
+static void emit(Compiler* compiler, unsigned char instruction, bool modular)
+{
+    compiler->code[compiler->length++] = instruction | (modular ? 0 : COMPILED_PLAIN);
+    if (instruction != COMPILED_NEGATE) {
+        compiler->depth--;
+    }
+}
+
+/**
+ * Open a level of nesting: a parenthesis, a negation or an operator waiting for its right operand.
+ * Only a level deeper than any before can go over the cap, so only those are checked.
+ * @param compiler the compiler
+ */
+static inline void enter(Compiler* compiler)
+{
+    if (++compiler->nesting > compiler->maxNesting) {
+        compiler->maxNesting = compiler->nesting;
+        unsigned char* out = compiler->code + compiler->length;
+        *out++ = COMPILED_DEPTH;
+        putVarint(&out, compiler->nesting);
+        compiler->length = out - compiler->code;
+    }
+}
+
+/**
+ * Compile a literal, which may be negative so -9223372036854775808 is exact, as parseDecimal reads it.
+ * @param compiler the compiler, at the literal's sign or first digit
+ * @param modular whether to reduce it modulo --mod
+ */
+static void compileLiteral(Compiler* compiler, bool modular)
+{
+    const char* text = compiler->text;
+    bool negative = text[compiler->next] == '-';
+    const char* digits = text + compiler->next + negative;
+    int length = 0;
+    while (isDigit(digits[length])) {
+        length++;
+    }
+    compiler->next += negative + length;
+
+    unsigned long magnitude = 0;
+    int status = parseRadixLiteral(digits, length, 10, &magnitude);
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    if (status != 0 || magnitude > limit) {
+        compileFail(compiler, FAIL_OVERFLOW);
+    }
+    long value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    unsigned char* out = compiler->code + compiler->length;
+    *out++ = COMPILED_PUSH | (modular ? 0 : COMPILED_PLAIN);
+    // Zigzag encoding keeps small negative literals short too
+    putVarint(&out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    compiler->length = out - compiler->code;
+    if (++compiler->depth > compiler->maxDepth) {
+        compiler->maxDepth = compiler->depth;
+    }
+}
+
+static void compileClimb(Compiler* compiler, int minPrecedence, bool modular);
+
+/**
+ * Compile a single operand, as parse_operand in infix.c reads it: a literal (optionally negative),
+ * a parenthesized sub-expression or a negated operand.
+ * @param compiler the compiler, at the operand's first character
+ * @param modular whether arithmetic is modulo --mod here
+ */
+static void compileOperand(Compiler* compiler, bool modular)
+{
+    const char* text = compiler->text;
+    char c = text[compiler->next];
+    if (isDigit(c) || (c == '-' && isDigit(text[compiler->next + 1]))) {
+        compileLiteral(compiler, modular);
+    } else if (c == '-') {
+        compiler->next++;
+        enter(compiler);
+        compileOperand(compiler, modular);
+        compiler->nesting--;
+        emit(compiler, COMPILED_NEGATE, modular);
+    } else if (c == '(') {
+        compiler->next++;
+        enter(compiler);
+        compileClimb(compiler, 1, modular);
+        if (text[compiler->next] != ')') {
+            compileFail(compiler, FAIL_INPUT);
+        }
+        compiler->nesting--;
+        compiler->next++;
+    } else {
+        // Missing operand, e.g. a trailing operator or an empty pair of parentheses
+        compileFail(compiler, FAIL_INPUT);
+    }
+}
+
+/**
+ * Precedence climbing, as parse_climb in infix.c does it, emitting each operator after its operands.
+ * @param compiler the compiler
+ * @param minPrecedence the weakest operator this call may consume
+ * @param modular whether arithmetic is modulo --mod here; exponents never are
+ */
+static void compileClimb(Compiler* compiler, int minPrecedence, bool modular)
+{
+    compileOperand(compiler, modular);
+    for (;;) {
+        unsigned char op = compiler->text[compiler->next];
+        CompiledOperator info = OPERATORS[op];
+        if (info.precedence < minPrecedence) {
+            return;
+        }
+        compiler->next++;
+        enter(compiler);
+        compileClimb(compiler, info.precedence + !info.rightAssociative, modular && op != '^');
+        compiler->nesting--;
+        emit(compiler, op, modular);
+    }
+}
+
+/**
+ * Make room for more records.
+ * @param body the records so far
+ * @param more bytes to make room for
+ * @return false if memory ran out
+ */
+static bool reserve(CompiledBody* body, size_t more)
+{
+    if (body->used + more <= body->capacity) {
+        return true;
+    }
+    size_t capacity = body->capacity == 0 ? COMPILED_CHUNK : body->capacity;
+    while (capacity < body->used + more) {
+        capacity *= 2;
+    }
+    unsigned char* data = realloc(body->data, capacity);
+    if (data == NULL) {
+        return false;
+    }
+    body->data = data;
+    body->capacity = capacity;
+    return true;
+}
+
+/**
+ * Compile one line into a record.
+ * @param prepare the line's checks, as evaluating it runs them
+ * @param context the evaluation context, for its program and scratch memory
+ * @param body the records, which the line's is appended to
+ * @param line the line, modified in place
+ * @param length its length
+ * @return false if memory ran out
+ */
+static bool compileLine(LinePreparer prepare, EvalContext* context, CompiledBody* body, char* line, size_t length)
+{
+    // A record without code: two varints
+    if (!reserve(body, 20)) {
+        return false;
+    }
+    unsigned char* out = body->data + body->used;
+    char* expression = NULL;
+    if (length >= MAX_SIZE) {
+        context->status = FAIL_INPUT;
+    } else {
+        jmp_buf recovery;
+        context->recovery = &recovery;
+        context->status = setjmp(recovery);
+        if (context->status == 0) {
+            expression = prepare(context, line);
+        }
+        context->recovery = NULL;
+    }
+    putVarint(&out, context->base);
+    putVarint(&out, context->status);
+    body->used = out - body->data;
+    if (context->status != 0) {
+        return true;
+    }
+
+    // At most four bytes of code per character, an operator and a depth check below MAX_SIZE, and a failure
+    Compiler compiler = { .text = expression };
+    compiler.code = contextAlloc(context, 4 * strlen(expression) + 16);
+    if (setjmp(compiler.stop) == 0) {
+        compileClimb(&compiler, 1, true);
+        if (expression[compiler.next] != '\0') {
+            // Unbalanced ')' or other trailing garbage
+            compileFail(&compiler, FAIL_INPUT);
+        }
+    }
+    if (!reserve(body, 30 + compiler.length)) {
+        return false;
+    }
+    out = body->data + body->used;
+    putVarint(&out, compiler.maxDepth);
+    putVarint(&out, compiler.length);
+    memcpy(out, compiler.code, compiler.length);
+    body->used = out + compiler.length - body->data;
+    return true;
+}
+
+/**
+ * Write all of a buffer to a file descriptor.
+ * @param fd the file descriptor
+ * @param data the bytes
+ * @param size how many
+ * @return true if all were written
+ */
+static bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * Compiles every non-blank line of standard input, in order, and writes the file, replacing any at the path.
+ * Lines that fail their checks are compiled too, into records that fail the same way, so the file has one
+ * record per line a line mode would evaluate. Nothing is printed.
+ * @param prepare the checks a line goes through before it is parsed
+ * @param context the evaluation context, whose program decides how lines are read
+ * @param path where to write the file
+ * @return 0, or FAIL_INPUT if the file could not be written
+ */
+int runCompile(LinePreparer prepare, EvalContext* context, const char* path)
+{
+    CompiledBody body = { 0 };
+    uint64_t count = 0;
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    bool compiled = true;
+    while (compiled && (length = getline(&line, &capacity, stdin)) >= 0) {
+        if (length > 0 && line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+        if (!isBlank(line, length)) {
+            compiled = compileLine(prepare, context, &body, line, length);
+            count++;
+        }
+    }
+    free(line);
+
+    unsigned char header[COMPILED_HEADER];
+    memcpy(header, COMPILED_MAGIC, 8);
+    storeLittle(header + 8, COMPILED_VERSION, 4);
+    storeLittle(header + 12, context->program, 4);
+    storeLittle(header + 16, count, 8);
+    storeLittle(header + 24, body.used, 8);
+    storeLittle(header + 32, checksum(body.data, body.used), 8);
+    int fd = compiled ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    bool written = fd >= 0 && writeAll(fd, header, sizeof(header)) && writeAll(fd, body.data, body.used);
+    if (fd >= 0 && close(fd) != 0) {
+        written = false;
+    }
+    free(body.data);
+    if (!written) {
+        fprintf(stderr, "Error: Cannot write the compiled file %s.\n", path);
+        return FAIL_INPUT;
+    }
+    return 0;
+}
+
+/**
+ * Decode a record as far as its code.
+ * @param at the record, advanced past it
+ * @param end the end of the records
+ * @param record filled in
+ * @return false if the record is cut short or its numbers are out of range
+ */
+static bool readRecord(const unsigned char** at, const unsigned char* end, CompiledRecord* record)
+{
+    uint64_t base, status, stack, length;
+    if (!getVarint(at, end, &base) || !getVarint(at, end, &status) || base > RADIX_MAX_BASE || status > 255) {
+        return false;
+    }
+    *record = (CompiledRecord){ .base = (int)base, .status = (int)status };
+    if (status != 0) {
+        return true;
+    }
+    if (!getVarint(at, end, &stack) || !getVarint(at, end, &length) || base < 2 || stack > MAX_SIZE
+        || length > (uint64_t)(end - *at)) {
+        return false;
+    }
+    record->stack = stack;
+    record->code = *at;
+    record->end = *at + length;
+    *at = record->end;
+    return true;
+}
+
+/**
+ * Check that a record's code can run: every instruction and varint is whole, no instruction takes more
+ * operands than the stack holds, the stack never grows past what the record says, and the code either leaves
+ * one value or ends in the failure it stops at.
+ * @param record the record
+ * @return true if it can
+ */
+static bool checkCode(const CompiledRecord* record)
+{
+    const unsigned char* code = record->code;
+    size_t depth = 0;
+    while (code < record->end) {
+        unsigned char op = *code++ & ~COMPILED_PLAIN;
+        uint64_t value;
+        if (op == COMPILED_PUSH) {
+            if (!getVarint(&code, record->end, &value) || ++depth > record->stack) {
+                return false;
+            }
+        } else if (op == COMPILED_NEGATE) {
+            if (depth < 1) {
+                return false;
+            }
+        } else if (op == COMPILED_DEPTH) {
+            if (!getVarint(&code, record->end, &value)) {
+                return false;
+            }
+        } else if (op == COMPILED_FAIL) {
+            return getVarint(&code, record->end, &value) && value != 0 && value <= 255 && code == record->end;
+        } else if (OPERATORS[op].precedence == 0 || depth-- < 2) {
+            return false;
+        }
+    }
+    return depth == 1;
+}
+
+/**
+ * Maps a compiled file and checks it whole, so evaluating its records needs no checks.
+ * @param path the file
+ * @param file filled in on success
+ * @return 0, or -1 if the file cannot be read, is not a compiled file of this version, or is damaged
+ */
+int compiledLoad(const char* path, CompiledFile* file)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < COMPILED_HEADER) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    *file = (CompiledFile){ .map = map, .size = info.st_size };
+    const unsigned char* header = map;
+    file->program = (int)loadLittle(header + 12, 4);
+    file->count = loadLittle(header + 16, 8);
+    file->body = header + COMPILED_HEADER;
+    file->bodySize = file->size - COMPILED_HEADER;
+    if (memcmp(header, COMPILED_MAGIC, 8) != 0 || loadLittle(header + 8, 4) != COMPILED_VERSION
+        || loadLittle(header + 24, 8) != file->bodySize || loadLittle(header + 32, 8) != checksum(file->body, file->bodySize)) {
+        compiledUnload(file);
+        return -1;
+    }
+
+    const unsigned char* at = file->body;
+    const unsigned char* end = file->body + file->bodySize;
+    uint64_t count = 0;
+    while (at < end) {
+        CompiledRecord record;
+        if (!readRecord(&at, end, &record) || (record.status == 0 && !checkCode(&record))) {
+            compiledUnload(file);
+            return -1;
+        }
+        if (record.stack > file->deepest) {
+            file->deepest = record.stack;
+        }
+        count++;
+    }
+    if (count != file->count) {
+        compiledUnload(file);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Releases a loaded file.
+ * @param file the file
+ */
+void compiledUnload(CompiledFile* file)
+{
+    munmap(file->map, file->size);
+}
+
+/**
+ * Runs a record's code on one operand stack, applying the operators of the context's policy and modulus
+ * and counting them against --limit depth, operations and time, as parse_climb does.
+ * @param context the evaluation context
+ * @param record the record, whose code loading has checked
+ * @param stack room for the most values the record has on the stack
+ * @return long value of the expression
+ */
+static long runCode(EvalContext* context, const CompiledRecord* record, long* stack)
+{
+    const Modulus* modulus = context->modulus.value != 0 ? &context->modulus : NULL;
+    const unsigned char* code = record->code;
+    size_t top = 0;
+    PROBE1(evaluate__start, context->base);
+    while (code < record->end) {
+        unsigned char instruction = *code++;
+        bool modular = modulus != NULL && (instruction & COMPILED_PLAIN) == 0;
+        unsigned char op = instruction & ~COMPILED_PLAIN;
+        if (op == COMPILED_PUSH) {
+            uint64_t zigzag = readVarint(&code);
+            long value = (long)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+            stack[top++] = modular ? modReduce(modulus, value) : value;
+        } else if (op == COMPILED_NEGATE) {
+            limitOperation(context);
+            long value = stack[top - 1];
+            stack[top - 1] = modular ? modApplyOp(context, modulus, 0, value, '-') : context->overflow->ops['-'](context, 0, value);
+        } else if (op == COMPILED_DEPTH) {
+            if (readVarint(&code) > context->usage.maxDepth) {
+                limitTooDeep(context);
+            }
+        } else if (op == COMPILED_FAIL) {
+            fail(context, (int)readVarint(&code));
+        } else {
+            limitOperation(context);
+            long rhs = stack[--top];
+            long lhs = stack[top - 1];
+            stack[top - 1] = modular ? modApplyOp(context, modulus, lhs, rhs, op) : context->overflow->ops[op](context, lhs, rhs);
+        }
+    }
+    PROBE2(evaluate__end, stack[0], (int)(record->end - record->code));
+    return stack[0];
+}
+
+/**
+ * Write out whatever has been formatted.
+ * @param buffer the formatted text
+ * @param length its length, reset to 0
+ */
+static void flushOutput(const char* buffer, size_t* length)
+{
+    writeAll(STDOUT_FILENO, buffer, *length);
+    *length = 0;
+}
+
+/**
+ * Evaluates every record of a compiled file, in order, with the --mod, --overflow and --limit settings of this
+ * run, and prints one line each as --pipeline does: results in their base, "error <status>" for failures and
+ * "<result> overflow" for results that overflowed under wrap or saturate. --limit length has no text to measure.
+ * @param context the evaluation context
+ * @param path the compiled file
+ * @return 0, or the status of the first expression that failed
+ */
+int runCompiled(EvalContext* context, const char* path)
+{
+    CompiledFile file;
+    if (compiledLoad(path, &file) != 0) {
+        fprintf(stderr, "Error: %s is not a compiled file of this version, or it is damaged.\n", path);
+        return FAIL_INPUT;
+    }
+    if (file.program != context->program) {
+        fprintf(stderr, "Error: %s was compiled by another program.\n", path);
+        compiledUnload(&file);
+        return FAIL_INPUT;
+    }
+    long* stack = malloc((file.deepest + 1) * sizeof(long));
+    char* output = malloc(COMPILED_CHUNK + RADIX_MAX_DIGITS + 16);
+    if (stack == NULL || output == NULL) {
+        free(stack);
+        free(output);
+        compiledUnload(&file);
+        return FAIL_INPUT;
+    }
+    size_t length = 0;
+    int firstFailure = 0;
+
+    const unsigned char* at = file.body;
+    const unsigned char* end = file.body + file.bodySize;
+    while (at < end) {
+        CompiledRecord record;
+        readRecord(&at, end, &record);
+        context->overflowed = false;
+        context->status = record.status;
+        long result = 0;
+        if (record.status == 0) {
+            jmp_buf recovery;
+            context->recovery = &recovery;
+            context->status = setjmp(recovery);
+            if (context->status == 0) {
+                context->base = record.base;
+                limitStart(context, 0);
+                result = runCode(context, &record, stack);
+            }
+            context->recovery = NULL;
+        }
+
+        if (context->status == 0) {
+            length += formatRadix(result, record.base, output + length);
+            if (context->overflowed) {
+                length += sprintf(output + length, " overflow");
+                if (firstFailure == 0) {
+                    firstFailure = FAIL_OVERFLOW;
+                }
+            }
+            output[length++] = '\n';
+        } else {
+            length += sprintf(output + length, "error %d\n", context->status);
+            if (firstFailure == 0) {
+                firstFailure = context->status;
+            }
+        }
+        if (length >= COMPILED_CHUNK) {
+            flushOutput(output, &length);
+        }
+    }
+    flushOutput(output, &length);
+    free(output);
+    free(stack);
+    compiledUnload(&file);
+    return firstFailure;
+}
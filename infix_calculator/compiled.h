@@ -0,0 +1,61 @@
+#ifndef COMPILED_H
+#define COMPILED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "context.h"
+
+/** First bytes of a compiled file. */
+#define COMPILED_MAGIC "INFIXEXP"
+
+/** Version of the compiled format, raised whenever it changes. */
+#define COMPILED_VERSION 1
+
+/** Bytes of the header: the magic number, then the version, program, count, body size and checksum, little-endian. */
+#define COMPILED_HEADER 40
+
+/** Instruction pushing the zigzagged varint literal that follows. */
+#define COMPILED_PUSH 'L'
+
+/** Instruction negating the value on top. */
+#define COMPILED_NEGATE 'N'
+
+/** Instruction checking --limit depth against the varint level of nesting that follows, the deepest yet. */
+#define COMPILED_DEPTH 'D'
+
+/** Instruction failing with the varint status that follows; always the last of its record. */
+#define COMPILED_FAIL 'F'
+
+/** Flag of a push, negation or operator that is not reduced by --mod, as in an exponent. Operators are their own characters. */
+#define COMPILED_PLAIN 0x80
+
+/**
+ * Checks one line the way it is evaluated and returns the compacted base 10 expression the parser reads,
+ * setting the context's base. Failures end in fail().
+ */
+typedef char* (*LinePreparer)(EvalContext* context, char* line);
+
+/** A compiled file, mapped into memory and checked. */
+typedef struct {
+    /** PROGRAM_10, PROGRAM_32 or PROGRAM_N, which compiled it */
+    int program;
+    uint64_t count;
+    /** The records, in the mapping */
+    const unsigned char* body;
+    size_t bodySize;
+    /** The most values any record's code has on the stack at once */
+    size_t deepest;
+    void* map;
+    size_t size;
+} CompiledFile;
+
+/** Function to compile every non-blank line of standard input into a file*/
+int runCompile(LinePreparer prepare, EvalContext* context, const char* path);
+/** Function to map a compiled file and check its header, checksum and every record; 0 on success*/
+int compiledLoad(const char* path, CompiledFile* file);
+/** Function to release a loaded file*/
+void compiledUnload(CompiledFile* file);
+/** Function to evaluate every record of a compiled file and print one line each, as --pipeline does*/
+int runCompiled(EvalContext* context, const char* path);
+
+#endif /*COMPILED_H*/
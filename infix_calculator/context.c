@@ -0,0 +1,76 @@
+/** 
+ * @file context.c
+ * @author Jason Wang
+ * This program sets up and tears down evaluation contexts.
+*/
+#include "context.h"
+#include "operation.h"
+
+/**
+ * Sets up a context with an empty arena.
+ * @param context the context
+ * @param program PROGRAM_10, PROGRAM_32 or PROGRAM_N
+ */
+void contextInit(EvalContext* context, int program)
+{
+    context->program = program;
+    context->base = program == PROGRAM_32 ? 32 : 10;
+    context->modulus.value = 0;
+    context->overflow = &OVERFLOW_TRAP;
+    context->rpn = false;
+    context->overflowed = false;
+    arenaInit(&context->arena);
+    context->report = NULL;
+    context->latency = NULL;
+    context->captureLog = NULL;
+    context->capture = NULL;
+    context->limits = (Limits){ 0 };
+    context->usage = (LimitUsage){ .maxDepth = SIZE_MAX, .checkpoint = UINT64_MAX };
+    context->recovery = NULL;
+    context->status = 0;
+}
+
+/**
+ * Sets up a context for another thread: the settings are copied, the memory is not shared.
+ * With --latency the new context records into histograms of its own in the same report,
+ * and with --capture it buffers records of its own for the same log.
+ * @param context the new context
+ * @param settings the context to copy the settings of
+ */
+void contextInitFrom(EvalContext* context, const EvalContext* settings)
+{
+    *context = *settings;
+    arenaInit(&context->arena);
+    context->latency = settings->report != NULL ? latencyStatsCreate(settings->report) : NULL;
+    context->capture = settings->captureLog != NULL ? captureBufferCreate(settings->captureLog) : NULL;
+    context->recovery = NULL;
+    context->status = 0;
+}
+
+/**
+ * Allocates from the context's arena; the memory lives until the next expression.
+ * @param context the context
+ * @param size bytes wanted
+ * @return the memory
+ */
+void* contextAlloc(EvalContext* context, size_t size)
+{
+    void* memory = arenaAlloc(&context->arena, size);
+    if (memory == NULL) {
+        fail(context, FAIL_INPUT);
+    }
+    return memory;
+}
+
+/**
+ * Releases everything the context allocated, appending its captured records to the log first.
+ * @param context the context
+ */
+void contextFree(EvalContext* context)
+{
+    if (context->capture != NULL) {
+        captureBufferFree(context->capture);
+        context->capture = NULL;
+    }
+    arenaFree(&context->arena);
+}
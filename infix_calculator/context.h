@@ -0,0 +1,98 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include "arena.h"
+#include "modular.h"
+#include "overflow.h"
+#include "latency.h"
+#include "capture.h"
+#include "limit.h"
+
+/** Program built with number_10.c */
+#define PROGRAM_10 0
+/** Program built with number_32.c */
+#define PROGRAM_32 1
+/** Program built with number_n.c, reading "$base expression" */
+#define PROGRAM_N 2
+
+/**
+ * Everything one evaluation works with: settings, the base being read, scratch memory and error state.
+ * Every function that evaluates takes one, so evaluations share nothing unless they share a context,
+ * and each thread that evaluates expressions owns its own.
+ */
+typedef struct EvalContext {
+    /** PROGRAM_10, PROGRAM_32 or PROGRAM_N */
+    int program;
+    /** Base of the literals of the current expression, and of its result */
+    int base;
+    /** Modulus of --mod M; its value is 0 for ordinary arithmetic */
+    Modulus modulus;
+    /** Operators of the --overflow policy, OVERFLOW_TRAP unless another was asked for */
+    const OverflowPolicy* overflow;
+    /** Whether lines are written in postfix (--rpn) rather than infix */
+    bool rpn;
+    /** Set when an operator overflowed under a policy that keeps going; cleared before each expression */
+    bool overflowed;
+    /** Scratch memory of the current expression, reset before each one */
+    Arena arena;
+    /** Report of --latency that this context's histograms belong to, or NULL when latencies are not recorded */
+    LatencyReport* report;
+    /** This context's histograms in the report */
+    LatencyStats* latency;
+    /** Log of --capture that this context's records are appended to, or NULL when nothing is captured */
+    CaptureLog* captureLog;
+    /** This context's records not yet appended to the log */
+    CaptureBuffer* capture;
+    /** Caps of --limit on each evaluation */
+    Limits limits;
+    /** What the current evaluation has used of them */
+    LimitUsage usage;
+    /** Where fail() returns to; armed with setjmp around each evaluation */
+    jmp_buf* recovery;
+    /** Exit status of the last failure, 0 if the last evaluation succeeded */
+    int status;
+} EvalContext;
+
+/** Function to set up a context for a program*/
+void contextInit(EvalContext* context, int program);
+/** Function to set up a context with the same settings as another but its own memory*/
+void contextInitFrom(EvalContext* context, const EvalContext* settings);
+/** Function to allocate scratch memory for the current expression, failing with FAIL_INPUT if memory runs out*/
+void* contextAlloc(EvalContext* context, size_t size);
+/** Function to release the memory of a context*/
+void contextFree(EvalContext* context);
+
+/**
+ * Counts an operator application against the operation and time limits; inline, since every operator runs it.
+ * @param context the evaluation context
+ */
+static inline void limitOperation(EvalContext* context)
+{
+    if (++context->usage.operations >= context->usage.checkpoint) {
+        limitReached(context);
+    }
+}
+
+/**
+ * Opens a level of nesting: a parenthesis, a negation or an operator waiting for its right operand.
+ * @param context the evaluation context
+ */
+static inline void limitEnter(EvalContext* context)
+{
+    if (++context->usage.depth > context->usage.maxDepth) {
+        limitTooDeep(context);
+    }
+}
+
+/**
+ * Closes the level limitEnter opened.
+ * @param context the evaluation context
+ */
+static inline void limitLeave(EvalContext* context)
+{
+    context->usage.depth--;
+}
+
+#endif /*CONTEXT_H*/
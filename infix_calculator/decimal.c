@@ -0,0 +1,100 @@
+/** 
+ * @file decimal.c
+ * @author Jason Wang
+ * This program parses decimal literals eight digits per step with SWAR (SIMD within a register) arithmetic,
+ * with exact overflow detection against LONG_MAX and LONG_MIN.
+*/
+#include "decimal.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "operation.h"
+
+/**
+ * Load 8 bytes so the first character ends up in the lowest byte.
+ * @param p the address to read at
+ * @return the 8 bytes
+ */
+static inline uint64_t loadEight(const char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/**
+ * Check that all 8 bytes are ASCII digits: the high nibble must be 3 both before and after adding 6.
+ * @param v the 8 bytes
+ * @return true if every byte is '0'-'9'
+ */
+static inline bool isEightDigits(uint64_t v)
+{
+    return ((v & 0xF0F0F0F0F0F0F0F0ULL) | (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+/**
+ * Convert 8 ASCII digits to their value with three multiply-add steps (pairs, quads, then the full 8).
+ * @param v the 8 digits, first digit in the lowest byte
+ * @return the value, below 100000000
+ */
+static inline uint64_t parseEightDigits(uint64_t v)
+{
+    v = (v & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+    v = (v & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+    return (v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32;
+}
+
+/**
+ * This function reads a decimal literal starting at expression[*i] and advances *i past it.
+ * A leading '-' makes the literal negative, so -9223372036854775808 parses to LONG_MIN.
+ * If the literal does not fit in a long the evaluation fails with FAIL_OVERFLOW.
+ * Eight digits are loaded at once only while eight bytes of the expression remain; the rest go one at a time.
+ * @param context the evaluation context
+ * @param expression the expression to read from
+ * @param i index of the literal, advanced past it
+ * @param length the length of the expression, which nothing is read past
+ * @return long value of the literal
+ */
+long parseDecimal(EvalContext* context, const char* expression, int* i, int length)
+{
+    const char* end = expression + length;
+    const char* p = expression + *i;
+    bool negative = *p == '-';
+    p += negative;
+    uint64_t limit = negative ? (uint64_t)LONG_MAX + 1 : (uint64_t)LONG_MAX;
+    uint64_t magnitude = 0;
+
+    while (end - p >= 8) {
+        uint64_t chunk = loadEight(p);
+        if (!isEightDigits(chunk)) {
+            break;
+        }
+        chunk = parseEightDigits(chunk);
+        if (magnitude > (limit - chunk) / 100000000) {
+            fail(context, FAIL_OVERFLOW);
+        }
+        magnitude = magnitude * 100000000 + chunk;
+        p += 8;
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+        uint64_t digit = *p - '0';
+        if (magnitude > (limit - digit) / 10) {
+            fail(context, FAIL_OVERFLOW);
+        }
+        magnitude = magnitude * 10 + digit;
+        p++;
+    }
+
+    *i = p - expression;
+    if (negative) {
+        return magnitude == (uint64_t)LONG_MAX + 1 ? LONG_MIN : -(long)magnitude;
+    }
+    return (long)magnitude;
+}
@@ -0,0 +1,9 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include "context.h"
+
+/** Function to parse a decimal literal, with an optional leading minus sign, eight digits at a time*/
+long parseDecimal(EvalContext* context, const char* expression, int* i, int length);
+
+#endif /*DECIMAL_H*/
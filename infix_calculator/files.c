@@ -0,0 +1,227 @@
+/** 
+ * @file files.c
+ * @author Jason Wang
+ * This program evaluates many small expression files in one process, the same shape as the input-*.txt fixtures:
+ * each file holds one expression on its first non-blank line. Up to FILES_DEPTH reads are kept in flight in an
+ * io_uring and submitted together, and each result is printed as "filename<TAB>result<TAB>status" in the order
+ * the files were named. Where io_uring is not available the files are read with pread instead.
+*/
+#include "files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "uring.h"
+#include "radix.h"
+#include "operation.h"
+
+/** One file whose read is in flight or finished but not yet printed. */
+typedef struct {
+    int fd;
+    /** Bytes read, or a negative errno */
+    int result;
+    bool done;
+    char buffer[MAX_SIZE + 1];
+} FileSlot;
+
+/** A growable list of file names. */
+typedef struct {
+    char** names;
+    int count;
+    int capacity;
+} FileList;
+
+/**
+ * Add a copy of a name to the list.
+ * @param list the list
+ * @param name the name
+ */
+static void addName(FileList* list, const char* name)
+{
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->names = realloc(list->names, list->capacity * sizeof(char*));
+    }
+    list->names[list->count++] = strdup(name);
+}
+
+/**
+ * Skip hidden entries such as "." and "..".
+ * @param entry a directory entry
+ * @return 1 if the entry should be listed
+ */
+static int isVisible(const struct dirent* entry)
+{
+    return entry->d_name[0] != '.';
+}
+
+/**
+ * Add a path to the list: a directory adds its regular files in name order, anything else is added as is.
+ * @param list the list
+ * @param path the path
+ */
+static void addPath(FileList* list, const char* path)
+{
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISDIR(info.st_mode)) {
+        addName(list, path);
+        return;
+    }
+    struct dirent** entries;
+    int count = scandir(path, &entries, isVisible, alphasort);
+    for (int i = 0; i < count; i++) {
+        char name[PATH_MAX];
+        snprintf(name, sizeof(name), "%s/%s", path, entries[i]->d_name);
+        if (stat(name, &info) == 0 && S_ISREG(info.st_mode)) {
+            addName(list, name);
+        }
+        free(entries[i]);
+    }
+    if (count >= 0) {
+        free(entries);
+    }
+}
+
+/**
+ * Evaluate a finished read and print its line.
+ * @param evaluate the line evaluator
+ * @param context passed to evaluate
+ * @param name the file name
+ * @param slot the finished read
+ * @return 0 or the status printed
+ */
+static int printFile(LineEvaluator evaluate, EvalContext* context, const char* name, FileSlot* slot)
+{
+    int status = FAIL_INPUT;
+    long result = 0;
+
+    if (slot->result >= 0) {
+        char* text = slot->buffer;
+        text[slot->result] = '\0';
+        // Like scanf(" %[^\n]"): skip leading whitespace, then take the first line
+        text += strspn(text, " \t\n\v\f\r");
+        char* newline = strchr(text, '\n');
+        if (newline != NULL) {
+            *newline = '\0';
+        }
+        if (newline != NULL || slot->result < MAX_SIZE) {
+            status = evaluate(context, text, &result);
+        }
+    }
+
+    if (status == 0) {
+        // A result kept by the wrap or saturate policy is printed with the overflow status
+        status = context->overflowed ? FAIL_OVERFLOW : 0;
+        char digits[RADIX_MAX_DIGITS];
+        formatRadix(result, context->base, digits);
+        printf("%s\t%s\t%d\n", name, digits, status);
+    } else {
+        printf("%s\t\t%d\n", name, status);
+    }
+    return status;
+}
+
+/**
+ * Open a file and start reading it, or read it right away when there is no io_uring.
+ * @param ring the io_uring, or NULL
+ * @param slot the slot to read into
+ * @param name the file name
+ * @param index the file's position, handed back with the completion
+ */
+static void startRead(Uring* ring, FileSlot* slot, const char* name, size_t index)
+{
+    slot->done = false;
+    slot->fd = open(name, O_RDONLY);
+    if (slot->fd < 0) {
+        slot->result = -errno;
+        slot->done = true;
+        return;
+    }
+    if (ring == NULL || !uringQueueRead(ring, slot->fd, slot->buffer, MAX_SIZE, 0, index)) {
+        slot->result = pread(slot->fd, slot->buffer, MAX_SIZE, 0);
+        if (slot->result < 0) {
+            slot->result = -errno;
+        }
+        close(slot->fd);
+        slot->done = true;
+    }
+}
+
+/**
+ * Evaluates each named file, or each regular file in a named directory. A single name "-" reads the names
+ * from standard input, one per line.
+ * @param evaluate evaluates a single line
+ * @param context the evaluation context, reused for every file
+ * @param paths the files and directories
+ * @param count how many there are
+ * @return the status of the first failed file, or 0
+ */
+int runFiles(LineEvaluator evaluate, EvalContext* context, char** paths, int count)
+{
+    FileList list = { NULL, 0, 0 };
+    if (count == 1 && strcmp(paths[0], "-") == 0) {
+        char name[PATH_MAX];
+        while (fgets(name, sizeof(name), stdin) != NULL) {
+            name[strcspn(name, "\n")] = '\0';
+            if (name[0] != '\0') {
+                addPath(&list, name);
+            }
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            addPath(&list, paths[i]);
+        }
+    }
+
+    Uring uring;
+    Uring* ring = uringInit(&uring, FILES_DEPTH) == 0 ? &uring : NULL;
+    FileSlot* slots = malloc(FILES_DEPTH * sizeof(FileSlot));
+    size_t files = list.count;
+    size_t next = 0;
+    size_t emitted = 0;
+    int firstFailure = 0;
+
+    while (emitted < files) {
+        for (; next < files && next < emitted + FILES_DEPTH; next++) {
+            startRead(ring, &slots[next % FILES_DEPTH], list.names[next], next);
+        }
+        if (ring != NULL) {
+            // One system call submits every new read and waits only if the next file to print is still in flight
+            if (uringSubmit(ring, slots[emitted % FILES_DEPTH].done ? 0 : 1) != 0) {
+                fprintf(stderr, "Error: io_uring submission failed.\n");
+                firstFailure = FAIL_INPUT;
+                break;
+            }
+            unsigned long long index;
+            int result;
+            while (uringReap(ring, &index, &result)) {
+                FileSlot* slot = &slots[index % FILES_DEPTH];
+                slot->result = result;
+                slot->done = true;
+                close(slot->fd);
+            }
+        }
+        for (; emitted < next && slots[emitted % FILES_DEPTH].done; emitted++) {
+            int status = printFile(evaluate, context, list.names[emitted], &slots[emitted % FILES_DEPTH]);
+            if (firstFailure == 0) {
+                firstFailure = status;
+            }
+        }
+    }
+
+    if (ring != NULL) {
+        uringDestroy(ring);
+    }
+    free(slots);
+    for (int i = 0; i < list.count; i++) {
+        free(list.names[i]);
+    }
+    free(list.names);
+    return firstFailure;
+}
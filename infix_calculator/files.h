@@ -0,0 +1,12 @@
+#ifndef FILES_H
+#define FILES_H
+
+#include "pipeline.h"
+
+/** Reads kept in flight at once. */
+#define FILES_DEPTH 64
+
+/** Function to evaluate the expression in each of many files, reading them through io_uring*/
+int runFiles(LineEvaluator evaluate, EvalContext* context, char** paths, int count);
+
+#endif /*FILES_H*/
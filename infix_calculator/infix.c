@@ -7,200 +7,598 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <ctype.h>
 #include "number.h"
 #include "operation.h"
+#include "scan.h"
+#include "columns.h"
+#include "pipeline.h"
+#include "workers.h"
+#include "files.h"
+#include "shared.h"
+#include "stream.h"
+#include "parallel.h"
+#include "script.h"
+#include "replay.h"
+#include "rpn.h"
+#include "compiled.h"
+#include "probes.h"
 
 
-static long parse_mul_div();
-static long parse_exp();
+static long parse_mul_div(EvalContext* context, char* express);
+static long parse_exp(EvalContext* context, char* expression);
+static long parse_climb(EvalContext* context, const char* expression, int length, int* i, int minPrecedence, const Modulus* modulus);
+
+/** Binding power and associativity of a single operator. */
+typedef struct {
+    unsigned char precedence;
+    bool rightAssociative;
+} OperatorInfo;
+
+/** Operator table indexed by the operator character itself; a precedence of 0 means "not an operator". */
+static const OperatorInfo OPERATORS[UCHAR_MAX + 1] = {
+    ['+'] = { 1, false },
+    ['-'] = { 1, false },
+    ['*'] = { 2, false },
+    ['/'] = { 2, false },
+    ['^'] = { 3, true },
+};
 
 /**
- * Function for parsing and calculating exponents in the equation, called by parse_mul_div
- * @param expression the expression that this function is operating on
- * @return long value.
+ * Parses a single operand: a literal (optionally negative), a parenthesized sub-expression or a negated operand.
+ * @param context the evaluation context, whose overflow policy supplies the operators
+ * @param expression the expression being parsed
+ * @param length the length of the expression
+ * @param i index of the first character of the operand, advanced past it
+ * @param modulus the modulus to reduce by, or NULL for ordinary arithmetic
+ * @return long value of the operand.
  */
-static long parse_exp(char* expression) 
+static inline long parse_operand(EvalContext* context, const char* expression, int length, int* i, const Modulus* modulus)
 {
-    Stack operands;
-    Stack operators;
-    initializeStack(&operands, 0); // 0 represents integer stack
-    initializeStack(&operators, 1); // 1 represents character stack
-
-    int expression_length = strlen(expression);
-    bool flag = false;
-    for (int i = 0; i < expression_length; i++) {
-        if (expression[i] == ' ' || expression[i] == '\t' || expression[i] == '\v' || expression[i] == '\f' || expression[i] == '\r') {
-            continue;
+    char c = expression[*i];
+    if (isdigit(c) || (c == '-' && isdigit(expression[*i + 1]))) {
+        // parseValue takes the sign itself so -9223372036854775808 is exact
+        long value = parseValue(context, (char*)expression, i, length);
+        return modulus ? modReduce(modulus, value) : value;
+    }
+    if (c == '-') {
+        *i += 1;
+        limitEnter(context);
+        long value = parse_operand(context, expression, length, i, modulus);
+        limitLeave(context);
+        limitOperation(context);
+        return modulus ? modApplyOp(context, modulus, 0, value, '-') : context->overflow->ops['-'](context, 0, value);
+    }
+    if (c == '(') {
+        *i += 1;
+        limitEnter(context);
+        long val = parse_climb(context, expression, length, i, 1, modulus);
+        if (expression[*i] != ')') {
+            fail(context, FAIL_INPUT);
         }
-        if (isdigit(expression[i]) || (expression[i] == '-' && (i == 0 || isOperator(expression[i - 1]) || expression[i - 1] == '('))) {
-            long val = 0; 
-
-            if (expression[i] == '-') {
-                i += 1;
-                flag = true;
-            }
-
-            val = parseValue(expression, &i);
-            
+        limitLeave(context);
+        *i += 1;
+        return val;
+    }
+    // Missing operand, e.g. a trailing operator or an empty pair of parentheses
+    fail(context, FAIL_INPUT);
+}
 
-            if (flag) {
-                push(&operands, -1 * val);
-                i--;
-                flag = false;
-                continue;
-            }
-            push(&operands, val);
+/**
+ * Precedence climbing: parses operators binding at least as tightly as minPrecedence.
+ * Each operator waiting for its right operand is a level of nesting for --limit depth.
+ * Left-associative operators recurse with a higher minimum so equal precedence folds to the left,
+ * right-associative ones (^) recurse with the same minimum so 2^3^2 is 2^(3^2).
+ * Under a modulus, exponents are still ordinary integers: reducing them modulo M would change the power.
+ * @param context the evaluation context, whose overflow policy supplies the operators
+ * @param expression the expression being parsed
+ * @param length the length of the expression
+ * @param i index to parse from, advanced past everything consumed
+ * @param minPrecedence the weakest operator this call may consume
+ * @param modulus the modulus to reduce by, or NULL for ordinary arithmetic
+ * @return long value of the parsed sub-expression.
+ */
+static long parse_climb(EvalContext* context, const char* expression, int length, int* i, int minPrecedence, const Modulus* modulus)
+{
+    long lhs = parse_operand(context, expression, length, i, modulus);
+    for (;;) {
+        unsigned char op = expression[*i];
+        OperatorInfo info = OPERATORS[op];
+        if (info.precedence < minPrecedence) {
+            return lhs;
+        }
+        *i += 1;
+        limitEnter(context);
+        long rhs = parse_climb(context, expression, length, i, info.precedence + !info.rightAssociative, op == '^' ? NULL : modulus);
+        limitLeave(context);
+        limitOperation(context);
+        lhs = modulus ? modApplyOp(context, modulus, lhs, rhs, op) : context->overflow->ops[op](context, lhs, rhs);
+    }
+}
 
-            i--;
-        } else if (isOperator(expression[i])) {
-            while (!isEmpty(&operators) && precedence(topChar(&operators)) >= precedence(expression[i])) {
+/**
+ * Function for parsing and calculating exponents in the equation, called by parse_mul_div
+ * @param context the evaluation context, which says whether arithmetic is modular
+ * @param expression the expression that this function is operating on, with whitespace already removed
+ * @return long value.
+ */
+static long parse_exp(EvalContext* context, char* expression) 
+{
+    int i = 0;
+    const Modulus* modulus = context->modulus.value != 0 ? &context->modulus : NULL;
+    PROBE1(evaluate__start, context->base);
+    long result = parse_climb(context, expression, (int)strlen(expression), &i, 1, modulus);
+    if (expression[i] != '\0') {
+        // Unbalanced ')' or other trailing garbage
+        fail(context, FAIL_INPUT);
+    }
+    PROBE2(evaluate__end, result, i);
+    return result;
+}
 
-                long val2 = top(&operands);
-                pop(&operands);
+/**
+ * Compacts a decimal expression and checks its characters and operators, failing as a line would.
+ * @param context the evaluation context
+ * @param expression the expression, compacted in place
+ * @return the same expression
+ */
+static char* check_decimal(EvalContext* context, char* expression)
+{
+    // The scanner compacts and checks in one pass; isValid only runs to pick the exit status when it finds something
+    if (!scanExpression(expression, SCAN_DECIMAL))
+    {
+        int valid = isValid(context, expression);
+        if(valid != 0)
+        {
+            fail(context, FAIL_INPUT);
+        }
+    }
+    PROBE1(validate, context->base);
+    return expression;
+}
 
-                long val1 = top(&operands);
-                pop(&operands);
+/**
+   Function for parsing multiplication and division used to read and evaluate the equation. Calls on parse_exp when seeing one.
+   @param context the evaluation context
+   @param express the expression being operated on
+   @return a long value.
+ */
+static long parse_mul_div(EvalContext* context, char* express)
+{
+    long return_value = parse_exp(context, check_decimal(context, express));
+    return return_value;
+}
 
-                char op = topChar(&operators);
-                popChar(&operators);
+/**
+ * Converts an expression in base 32 or base n to a checked base 10 one.
+ * @param context the evaluation context holding the converted expression and the base of the literals
+ * @param expression the expression, compacted in place
+ * @return the converted expression, in the context's arena
+ */
+static char* convert_base(EvalContext* context, char* expression)
+{
+    if (!scanExpression(expression, SCAN_LETTERS))
+    {
+        fail(context, FAIL_INPUT);
+    }
+    int operatorsBeforeParse = numberOfOperators(expression);
+    char* convertedExpression = convertBaseNtoBase10(context, expression);
 
-                push(&operands, applyOp(val1, val2, op));
-            }
-            pushChar(&operators, expression[i]);
-        } else if (expression[i] == '(') {
-            pushChar(&operators, expression[i]);
-        } else if (expression[i] == ')') {
-            while (!isEmpty(&operators) && topChar(&operators) != '(') {
-                long val2 = top(&operands);
-                pop(&operands);
+    int operatorsAfterParse = numberOfOperators(convertedExpression);
+    if(operatorsBeforeParse != operatorsAfterParse)
+    {
+        fail(context, FAIL_OVERFLOW);
+    }
+    return check_decimal(context, convertedExpression);
+}
 
-                long val1 = top(&operands);
-                pop(&operands);
+/**
+ * Converts an expression in base 32 or base n to base 10 and evaluates it.
+ * @param context the evaluation context holding the converted expression and the base of the literals
+ * @param expression the expression, compacted in place
+ * @return long value of the expression
+ */
+static long parse_base(EvalContext* context, char* expression)
+{
+    return parse_exp(context, convert_base(context, expression));
+}
 
-                char op = topChar(&operators);
-                popChar(&operators);
+/**
+ * Evaluates one line of input the way the context's program reads it. Failures end in fail().
+ * Scratch memory comes from the context's arena, which is reset first, so nothing is left to free.
+ * @param context the evaluation context, whose base is set to the base the result should be printed in
+ * @param line the line, modified in place
+ * @return long value of the expression
+ */
+static long evaluate(EvalContext* context, char* line)
+{
+    arenaReset(&context->arena);
+    context->overflowed = false;
+    int program = context->program;
+    if(program == PROGRAM_10)
+    {
+        context->base = 10;
+        return context->rpn ? evaluateRpn(context, line) : parse_mul_div(context, line);
+    }
+    if(program == PROGRAM_32)
+    {
+        context->base = 32;
+        return context->rpn ? evaluateRpn(context, line) : parse_base(context, line);
+    }
 
-                push(&operands, applyOp(val1, val2, op));
-            }
-            if (!isEmpty(&operators) && topChar(&operators) == '(') {
-                popChar(&operators); // Pop '('
-            }
-        }
+    ExpressionData data = parseExpression(context, line);
+    if (data.expression == NULL)
+    {
+        fail(context, FAIL_INPUT);
     }
+    context->base = data.base;
+    return context->rpn ? evaluateRpn(context, data.expression) : parse_base(context, data.expression);
+}
 
-    while (!isEmpty(&operators)) {
-        long val2 = top(&operands);
-        pop(&operands);
+/**
+ * Line checks for --compile: everything evaluate() does before parse_exp, so the checks of the characters,
+ * operators and literals fail with the same statuses. Scratch memory comes from the context's arena, reset first.
+ * @param context the evaluation context, whose base is set to the base of the line's literals and result
+ * @param line the line, modified in place
+ * @return the compacted base 10 expression parse_exp would read
+ */
+static char* prepareLine(EvalContext* context, char* line)
+{
+    arenaReset(&context->arena);
+    int program = context->program;
+    if(program == PROGRAM_10)
+    {
+        context->base = 10;
+        return check_decimal(context, line);
+    }
+    if(program == PROGRAM_32)
+    {
+        context->base = 32;
+        return convert_base(context, line);
+    }
 
-        long val1 = top(&operands);
-        pop(&operands);
+    ExpressionData data = parseExpression(context, line);
+    if (data.expression == NULL)
+    {
+        fail(context, FAIL_INPUT);
+    }
+    context->base = data.base;
+    return convert_base(context, data.expression);
+}
 
-        char op = topChar(&operators);
-        popChar(&operators);
-        push(&operands, applyOp(val1, val2, op));
+/**
+ * Line evaluator for every mode: evaluates one line and reports failures as a status.
+ * The recovery point fail() returns to lives in the context, so threads with their own contexts never interfere.
+ * @param context the evaluation context of the calling thread; its base is set to the base to print the value in
+ * @param line the line, modified in place
+ * @param result set to the value on success
+ * @return 0 or the exit status the line would have produced
+ */
+static int evaluateLine(EvalContext* context, char* line, long* result)
+{
+    size_t length = strlen(line);
+    PROBE1(read, length);
+    uint64_t start = context->latency != NULL || context->capture != NULL ? latencyNow() : 0;
+    if (context->capture != NULL)
+    {
+        captureBegin(context->capture, start, line, length);
+    }
+    jmp_buf recovery;
+    context->recovery = &recovery;
+    context->status = setjmp(recovery);
+    if (context->status == 0)
+    {
+        limitStart(context, length);
+        if (length >= MAX_SIZE)
+        {
+            fail(context, FAIL_INPUT);
+        }
+        *result = evaluate(context, line);
+    }
+    context->recovery = NULL;
+    uint64_t elapsed = start != 0 ? latencyNow() - start : 0;
+    if (context->latency != NULL)
+    {
+        // The line may have had its whitespace removed in place by now; it is kept as it is
+        latencyRecord(context->latency, elapsed, length, context->base, line);
+    }
+    if (context->capture != NULL)
+    {
+        captureEnd(context->capture, elapsed, context->base, context->status, context->overflowed, context->status == 0 ? *result : 0);
     }
+    return context->status;
+}
 
-    // Top of 'values' contains the result, return it.
-    return top(&operands);
+/**
+ * Reads the expression of single-line mode: the first line of standard input that is not blank, whatever its length,
+ * so that --limit length and the MAX_SIZE check see the whole line instead of a fixed buffer overflowing first.
+ * @param line the getline buffer, to be freed by the caller
+ * @param capacity the capacity of the buffer
+ * @return the line without its leading whitespace and newline, or "" at the end of input
+ */
+static char* readExpression(char** line, size_t* capacity)
+{
+    ssize_t length;
+    while ((length = getline(line, capacity, stdin)) >= 0)
+    {
+        if (length > 0 && (*line)[length - 1] == '\n')
+        {
+            (*line)[--length] = '\0';
+        }
+        char* start = *line;
+        while (isspace((unsigned char)*start))
+        {
+            start++;
+        }
+        if (*start != '\0')
+        {
+            return start;
+        }
+    }
+    // Evaluation works in place, so the empty line has to be writable
+    static char empty[1];
+    return empty;
 }
 
 /**
-   Function for parsing multiplication and division used to read and evaluate the equation. Calls on parse_exp when seeing one.
-   @param express the expression being operated on
-   @return a long value.
+ * Works out which program is running from its name.
+ * @param name argv[0]
+ * @return PROGRAM_10, PROGRAM_32, PROGRAM_N, or -1 if unknown
  */
-static long parse_mul_div(char* express)
+static int programOf(const char* name)
 {
-    char* expression;
-    expression = skipSpace(express);
-    int valid = isValid(expression);
-    if(valid != 0)
+    if(strcmp("./infix_10", name) == 0)
     {
-        puts("yahs fail\n");
-        exit(FAIL_INPUT);
+        return PROGRAM_10;
     }
-    long return_value = parse_exp(expression);
-    return return_value;
+    if(strcmp("./infix_32", name) == 0)
+    {
+        return PROGRAM_32;
+    }
+    if(strcmp("./infix_n", name) == 0)
+    {
+        return PROGRAM_N;
+    }
+    return -1;
 }
 
 /**
  * Main program that runs and takes input from the terminal to calculate the function.
+ * With --columns OP LEFT RIGHT RESULT STATUS it instead applies OP to two binary int64 column files (see columns.c).
+ * With --pipeline [THREADS] it evaluates every line of standard input on evaluator threads (see pipeline.c).
+ * With --workers [COUNT] it does the same in worker processes, restarting any that die (see workers.c).
+ * With --reduce sum|min|max|count|histogram [THREADS] it does the same but prints only the aggregate (see reduce.c).
+ * With --files PATH... it evaluates the expression in each file or each file of a directory (see files.c).
+ * With --shm NAME it serves a client through a shared-memory region of that name (see shared.c).
+ * With --stream it evaluates all of standard input as one expression of any length (see stream.c).
+ * With --parallel FILE [THREADS] it evaluates the one expression in a file of any size on several threads (see parallel.c).
+ * With --script it compiles and runs all of standard input as statements with variables (see script.c).
+ * --mod M, before any of the modes, makes all arithmetic modulo M (see modular.c).
+ * --overflow trap|wrap|saturate, before any of the modes, picks what an overflowing operator does (see overflow.c).
+ * With --replay LOG [fast] it evaluates the expressions of a capture log again and compares the results and latencies (see replay.c).
+ * With --compile FILE it compiles every line of standard input into FILE, and with --load FILE it evaluates them (see compiled.c).
+ * --rpn, before any of the line modes, reads every line as a postfix expression instead (see rpn.c).
+ * --latency, before any of the line modes, prints latency percentiles to standard error at exit or on SIGUSR1 (see latency.c).
+ * --limit length|depth|operations|time=VALUE, before any of the modes, caps what one evaluation may use (see limit.c).
+ * --capture LOG, before any of the line modes, appends every expression and its outcome and latency to a log (see capture.c).
  * @param argc a argument / equation
  * @param aargv a pointer for infix_n to convert base to the chosen value.
  * @return int that is evaluated and outputted in the chosen base.
 */
 int main(int argc, char **argv)
 {
+    int program = programOf(argv[0]);
+    EvalContext context;
+    contextInit(&context, program);
+    const char* capturePath = NULL;
 
-    if(strcmp("./infix_10", argv[0]) == 0)
+    // Options that apply to every mode come first, in any order
+    while(argc >= 2)
     {
-        char expression[MAX_SIZE];
-        
-        scanf(" %[^\n]", expression);
-
-        long result = parse_mul_div(expression);
-       
-        printValue(result);
+        if(strcmp("--latency", argv[1]) == 0)
+        {
+            if(context.report == NULL)
+            {
+                context.report = latencyReportCreate();
+                context.latency = context.report != NULL ? latencyStatsCreate(context.report) : NULL;
+            }
+            argc -= 1;
+            argv += 1;
+            continue;
+        }
+        if(strcmp("--rpn", argv[1]) == 0)
+        {
+            context.rpn = true;
+            argc -= 1;
+            argv += 1;
+            continue;
+        }
+        if(argc < 3)
+        {
+            break;
+        }
+        if(strcmp("--mod", argv[1]) == 0)
+        {
+            char* end;
+            errno = 0;
+            long modulus = strtol(argv[2], &end, 10);
+            if(end == argv[2] || *end != '\0' || errno != 0 || modulusInit(&context.modulus, modulus) != 0)
+            {
+                fprintf(stderr, "Error: The modulus must be from 1 to %ld.\n", LONG_MAX);
+                return FAIL_INPUT;
+            }
+        }
+        else if(strcmp("--capture", argv[1]) == 0)
+        {
+            capturePath = argv[2];
+        }
+        else if(strcmp("--limit", argv[1]) == 0)
+        {
+            if(limitSet(&context.limits, argv[2]) != 0)
+            {
+                fprintf(stderr, "Error: The limit must be length=BYTES, depth=LEVELS, operations=COUNT or time=MILLISECONDS.\n");
+                return FAIL_INPUT;
+            }
+        }
+        else if(strcmp("--overflow", argv[1]) == 0)
+        {
+            context.overflow = overflowPolicyNamed(argv[2]);
+            if(context.overflow == NULL)
+            {
+                fprintf(stderr, "Error: The overflow policy must be trap, wrap or saturate.\n");
+                return FAIL_INPUT;
+            }
+        }
+        else
+        {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
     }
 
-    else if(strcmp("./infix_32", argv[0]) == 0)
+    // Binary column mode works on int64 values, so it is the same for every base
+    if(argc == 7 && strcmp("--columns", argv[1]) == 0)
     {
-        char expression[MAX_SIZE];
-        
-        scanf(" %[^\n]", expression);
-        int operatorsBeforeParse = numberOfOperators(expression);
-        char* expression_without_space = malloc(strlen(expression) * sizeof(char));
-        expression_without_space = skipSpace(expression);
-        int base = 32;
-
-        char* convertedExpression = convertBaseNtoBase10(expression_without_space, base);
-        
-        int operatorsAfterParse = numberOfOperators(convertedExpression);
-        if(operatorsBeforeParse != operatorsAfterParse)
+        if(strlen(argv[2]) != 1)
         {
-            exit(FAIL_OVERFLOW);
+            return FAIL_INPUT;
         }
-        long result = (long)parse_mul_div(convertedExpression);
-        if(result == LONG_MIN)
+        // Rows are not expressions, so there is nothing to cap or capture
+        const Limits* limits = &context.limits;
+        if(capturePath != NULL || limits->length != 0 || limits->depth != 0 || limits->operations != 0 || limits->nanoseconds != 0)
         {
-            printf("%ld\n", LONG_MIN_BASE32);
-            return 0;
+            fprintf(stderr, "Error: --limit and --capture do not apply to --columns.\n");
+            return FAIL_INPUT;
         }
-        
-        convertToBase(result, base);
+        return evaluateColumns(&context, argv[2][0], argv[3], argv[4], argv[5], argv[6]);
+    }
 
+    if(program < 0)
+    {
+        puts("please make infix_10 infix_32 infix_n first\n");
+        return 0;
     }
-    
-    else if(strcmp("./infix_n", argv[0]) == 0)
+
+    // Postfix is read a line at a time; the modes that read one long expression or statements, and compiled files, stay infix
+    if(context.rpn && argc >= 2
+       && (strcmp("--stream", argv[1]) == 0 || strcmp("--parallel", argv[1]) == 0 || strcmp("--script", argv[1]) == 0
+           || strcmp("--compile", argv[1]) == 0 || strcmp("--load", argv[1]) == 0))
     {
-    char expressionString[MAX_SIZE];
-    
-    scanf(" %[^\n]", expressionString);
+        fprintf(stderr, "Error: --rpn applies to the line modes only.\n");
+        return FAIL_INPUT;
+    }
 
-    ExpressionData data = parseExpression(expressionString);
+    if(capturePath != NULL)
+    {
+        CaptureHeader header;
+        captureHeaderInit(&header, &context);
+        context.captureLog = captureLogCreate(capturePath, &header);
+        if(context.captureLog == NULL)
+        {
+            fprintf(stderr, "Error: Cannot create the capture log %s.\n", capturePath);
+            return FAIL_INPUT;
+        }
+        context.capture = captureBufferCreate(context.captureLog);
+    }
 
-    if (data.expression != NULL) {
-        // printf("Base: %d\n", data.base);
-        // printf("Expression: %s\n", data.expression);
-        int operatorsBeforeParse = numberOfOperators(data.expression);
-        char* convertedExpression = convertBaseNtoBase10(data.expression, data.base);
-        
-        int operatorsAfterParse = numberOfOperators(convertedExpression);
-        
-        if(operatorsBeforeParse != operatorsAfterParse)
+    int status;
+    if(argc >= 2 && strcmp("--pipeline", argv[1]) == 0)
+    {
+        int threads = argc >= 3 ? atoi(argv[2]) : 0;
+        status = runPipeline(evaluateLine, &context, threads, NULL);
+    }
+    else if(argc >= 2 && strcmp("--workers", argv[1]) == 0)
+    {
+        int workers = argc >= 3 ? atoi(argv[2]) : 0;
+        status = runWorkers(evaluateLine, &context, workers);
+    }
+    else if(argc >= 3 && strcmp("--reduce", argv[1]) == 0)
+    {
+        int kind = reduceKindNamed(argv[2]);
+        if(kind < 0)
         {
-            exit(FAIL_OVERFLOW);
+            fprintf(stderr, "Error: The reduction must be sum, min, max, count or histogram.\n");
+            return FAIL_INPUT;
+        }
+        Reduction reduction;
+        reduceInit(&reduction, kind);
+        int threads = argc >= 4 ? atoi(argv[3]) : 0;
+        status = runPipeline(evaluateLine, &context, threads, &reduction);
+        if(status == 0)
+        {
+            status = reducePrint(&reduction, stdout);
         }
-        long result = (long)parse_mul_div(convertedExpression);
-        convertToBase(result, data.base);
-        free(data.expression);
     }
+    else if(argc >= 3 && strcmp("--files", argv[1]) == 0)
+    {
+        status = runFiles(evaluateLine, &context, argv + 2, argc - 2);
     }
-    else
+    else if(argc == 3 && strcmp("--shm", argv[1]) == 0)
     {
-        puts("please make infix_10 infix_32 infix_n first\n");
+        status = runShared(evaluateLine, &context, argv[2]);
     }
-    return 0;
-}
+    else if(argc >= 3 && strcmp("--parallel", argv[1]) == 0)
+    {
+        int threads = argc >= 4 ? atoi(argv[3]) : 0;
+        status = runParallel(&context, argv[2], threads);
+    }
+    else if(argc == 2 && strcmp("--stream", argv[1]) == 0)
+    {
+        status = runStream(&context);
+    }
+    else if((argc == 3 || (argc == 4 && strcmp("fast", argv[3]) == 0)) && strcmp("--replay", argv[1]) == 0)
+    {
+        status = runReplay(evaluateLine, &context, argv[2], argc == 4);
+    }
+    else if(argc == 3 && strcmp("--compile", argv[1]) == 0)
+    {
+        status = runCompile(prepareLine, &context, argv[2]);
+    }
+    else if(argc == 3 && strcmp("--load", argv[1]) == 0)
+    {
+        status = runCompiled(&context, argv[2]);
+    }
+    else if(argc == 2 && strcmp("--script", argv[1]) == 0)
+    {
+        status = runScript(&context);
+    }
+    else
+    {
+        char* line = NULL;
+        size_t capacity = 0;
+        char* expression = readExpression(&line, &capacity);
 
+        long result;
+        status = evaluateLine(&context, expression, &result);
+        free(line);
+        if(status == 0)
+        {
+            if(program == PROGRAM_10)
+            {
+                printValue(result);
+            }
+            else
+            {
+                convertToBase(&context, result);
+            }
+            // A policy that keeps going still reports the overflow through the exit status
+            status = context.overflowed ? FAIL_OVERFLOW : 0;
+        }
+    }
 
+    if(context.report != NULL)
+    {
+        latencyPrint(context.report, stderr);
+        latencyReportFree(context.report);
+    }
+    // Freeing the context appends its last captured records, so the log is closed after
+    CaptureLog* captureLog = context.captureLog;
+    contextFree(&context);
+    if(captureLog != NULL)
+    {
+        captureLogClose(captureLog);
+    }
+    return status;
+}
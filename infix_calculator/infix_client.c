@@ -0,0 +1,196 @@
+/** 
+ * @file infix_client.c
+ * @author Jason Wang
+ * This program is the client library for --shm (libinfixclient.a). Expressions are written straight into slots of the
+ * server's request ring, so submitting one is a copy into shared memory and an index store, and results are read
+ * from the response ring in submission order. A client keeps at most INFIX_MAX_IN_FLIGHT requests outstanding,
+ * which is what both rings hold, so neither side ever blocks the other for good.
+*/
+#include "infix_client.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm.h"
+
+_Static_assert(INFIX_MAX_IN_FLIGHT == SHM_SLOTS, "a client may fill the request ring and no more");
+_Static_assert(INFIX_MAX_TEXT == SHM_TEXT, "a claimed slot is a request slot's text");
+
+/** How long to sleep between attempts to map a region the server has not created yet, in milliseconds. */
+#define CONNECT_RETRY_MS 10
+
+struct InfixClient {
+    ShmRegion* region;
+    /** Requests published whose results have not been received */
+    int inFlight;
+    /** Whether infixClaim handed out a slot that is not yet published */
+    bool claimed;
+};
+
+/**
+ * Connects to a server's region. Only one client may use a region at a time.
+ * @param name the name the server was started with
+ * @param timeoutMs how long to keep trying while the server starts up
+ * @return the client, or NULL if there is no server or it already has a client
+ */
+InfixClient* infixConnect(const char* name, int timeoutMs)
+{
+    ShmRegion* region = shmMap(name, false);
+    for (int waited = 0; region == NULL && waited < timeoutMs; waited += CONNECT_RETRY_MS) {
+        struct timespec pause = { 0, CONNECT_RETRY_MS * 1000000L };
+        nanosleep(&pause, NULL);
+        region = shmMap(name, false);
+    }
+    if (region == NULL) {
+        return NULL;
+    }
+    unsigned expected = 0;
+    if (!atomic_compare_exchange_strong(&region->connected, &expected, 1)) {
+        shmUnmap(region);
+        return NULL;
+    }
+    atomic_store(&region->client, getpid());
+    InfixClient* client = calloc(1, sizeof(InfixClient));
+    if (client == NULL) {
+        shmUnmap(region);
+        return NULL;
+    }
+    client->region = region;
+    return client;
+}
+
+/**
+ * Claims the next request slot. The expression is written into the returned buffer, in place, and then submitted with infixPublish.
+ * @param client the client
+ * @param tag a value copied into the result, e.g. to match results with requests
+ * @return a buffer of INFIX_MAX_TEXT bytes, or NULL if INFIX_MAX_IN_FLIGHT requests are already in flight or the
+ *         server exited
+ */
+char* infixClaim(InfixClient* client, uint64_t tag)
+{
+    if (client->inFlight >= INFIX_MAX_IN_FLIGHT) {
+        return NULL;
+    }
+    // Fewer requests are in flight than the ring holds, so a slot frees up unless the server is gone
+    ShmRing* ring = &client->region->requests;
+    if (shmWaitWritable(ring, NULL, &client->region->server) == 0) {
+        return NULL;
+    }
+    ShmRequest* request = &client->region->request[atomic_load_explicit(&ring->tail, memory_order_relaxed) & (SHM_SLOTS - 1)];
+    request->tag = tag;
+    client->claimed = true;
+    return request->text;
+}
+
+/**
+ * Submits the slot claimed last.
+ * @param client the client
+ * @param length bytes of expression written into the slot, less than INFIX_MAX_TEXT
+ * @return 0, or -1 if no slot is claimed or the expression is too long
+ */
+int infixPublish(InfixClient* client, size_t length)
+{
+    if (!client->claimed || length >= INFIX_MAX_TEXT) {
+        return -1;
+    }
+    ShmRing* ring = &client->region->requests;
+    client->region->request[atomic_load_explicit(&ring->tail, memory_order_relaxed) & (SHM_SLOTS - 1)].length = length;
+    shmPublish(ring, 1);
+    client->claimed = false;
+    client->inFlight++;
+    return 0;
+}
+
+/**
+ * Copies an expression into a slot and submits it.
+ * @param client the client
+ * @param text the expression as the server's program reads it, e.g. "$16 FF + 1" for infix_n
+ * @param tag a value copied into the result
+ * @return 0, or -1 if too many requests are in flight, the expression is too long or the server exited
+ */
+int infixSubmit(InfixClient* client, const char* text, uint64_t tag)
+{
+    size_t length = strlen(text);
+    if (length >= INFIX_MAX_TEXT) {
+        return -1;
+    }
+    char* slot = infixClaim(client, tag);
+    if (slot == NULL) {
+        return -1;
+    }
+    memcpy(slot, text, length);
+    return infixPublish(client, length);
+}
+
+/**
+ * Reads the result at the head of the response ring and frees its slot.
+ * @param client the client
+ * @param result set to the result
+ */
+static void takeResult(InfixClient* client, InfixResult* result)
+{
+    ShmRing* ring = &client->region->responses;
+    const ShmResponse* response = &client->region->response[atomic_load_explicit(&ring->head, memory_order_relaxed) & (SHM_SLOTS - 1)];
+    result->tag = response->tag;
+    result->value = response->value;
+    result->status = response->status;
+    result->base = response->base;
+    result->overflowed = response->overflowed != 0;
+    shmConsume(ring, 1);
+    client->inFlight--;
+}
+
+/**
+ * Waits for the next result, in the order the requests were submitted.
+ * @param client the client
+ * @param result set to the result
+ * @return 0, or -1 if nothing is in flight or the server exited before answering
+ */
+int infixReceive(InfixClient* client, InfixResult* result)
+{
+    if (client->inFlight == 0 || shmWaitReadable(&client->region->responses, NULL, &client->region->server) == 0) {
+        return -1;
+    }
+    takeResult(client, result);
+    return 0;
+}
+
+/**
+ * Takes the next result if the server has produced it.
+ * @param client the client
+ * @param result set to the result
+ * @return true if a result was taken
+ */
+bool infixTryReceive(InfixClient* client, InfixResult* result)
+{
+    if (client->inFlight == 0 || shmReadable(&client->region->responses) == 0) {
+        return false;
+    }
+    takeResult(client, result);
+    return true;
+}
+
+/**
+ * Counts the requests whose results have not been received.
+ * @param client the client
+ * @return the count
+ */
+int infixInFlight(const InfixClient* client)
+{
+    return client->inFlight;
+}
+
+/**
+ * Disconnects. The server answers what was already submitted, then removes the region and exits.
+ * @param client the client
+ */
+void infixClose(InfixClient* client)
+{
+    atomic_store(&client->region->closed, 1);
+    shmWakeAll(&client->region->requests);
+    shmWakeAll(&client->region->responses);
+    shmUnmap(client->region);
+    free(client);
+}
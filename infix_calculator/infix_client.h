@@ -0,0 +1,47 @@
+#ifndef INFIX_CLIENT_H
+#define INFIX_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Most requests a client may have in flight; receive a result before claiming more. */
+#define INFIX_MAX_IN_FLIGHT 256
+
+/** Bytes of expression text a claimed slot holds, including the terminating NUL. */
+#define INFIX_MAX_TEXT 4096
+
+/** A connection to an infix server started with --shm NAME. */
+typedef struct InfixClient InfixClient;
+
+/** The result of one expression. */
+typedef struct {
+    /** The tag the expression was submitted with */
+    uint64_t tag;
+    long value;
+    /** 0 or the exit status the expression would have produced */
+    int status;
+    /** Base the value is meant to be printed in */
+    int base;
+    /** Whether the value overflowed under a policy that keeps going */
+    bool overflowed;
+} InfixResult;
+
+/** Function to connect to a server's region, waiting up to timeoutMs for the server to create it*/
+InfixClient* infixConnect(const char* name, int timeoutMs);
+/** Function to claim the next request slot and get its text buffer to write an expression into, or NULL*/
+char* infixClaim(InfixClient* client, uint64_t tag);
+/** Function to submit the claimed slot once length bytes of expression are written*/
+int infixPublish(InfixClient* client, size_t length);
+/** Function to copy an expression into a slot and submit it*/
+int infixSubmit(InfixClient* client, const char* text, uint64_t tag);
+/** Function to wait for the next result, in submission order; -1 if the server exited first*/
+int infixReceive(InfixClient* client, InfixResult* result);
+/** Function to take the next result if it is ready*/
+bool infixTryReceive(InfixClient* client, InfixResult* result);
+/** Function to count the requests submitted whose results are not yet received*/
+int infixInFlight(const InfixClient* client);
+/** Function to disconnect, which also stops the server*/
+void infixClose(InfixClient* client);
+
+#endif /*INFIX_CLIENT_H*/
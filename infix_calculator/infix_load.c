@@ -0,0 +1,169 @@
+/** 
+ * @file infix_load.c
+ * @author Jason Wang
+ * This program is a local load test for --shm. It connects to an infix_n server started with --shm NAME, keeps DEPTH
+ * requests in flight until COUNT have been answered, checks every result, and prints the throughput and round-trip
+ * percentiles. Each request is "$base x op y" in a base from 2 to 32, so every radix kernel is exercised.
+ * Closing the connection at the end also stops the server.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "infix_client.h"
+
+/** Requests answered unless COUNT is given. */
+#define DEFAULT_COUNT 100000
+
+/** Requests kept in flight unless DEPTH is given. */
+#define DEFAULT_DEPTH 32
+
+/** How long to wait for the server to create its region, in milliseconds. */
+#define CONNECT_TIMEOUT_MS 5000
+
+/** One request and the answer the server should give. */
+typedef struct {
+    uint64_t start;
+    long expected;
+    int base;
+} Pending;
+
+/**
+ * Read the monotonic clock.
+ * @return nanoseconds
+ */
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + time.tv_nsec;
+}
+
+/**
+ * Write a non-negative value in a base.
+ * @param value the value
+ * @param base the base, 2 to 32
+ * @param out where to write the digits
+ * @return the number of digits
+ */
+static int formatValue(long value, int base, char* out)
+{
+    char digits[64];
+    int count = 0;
+    do {
+        digits[count++] = "0123456789ABCDEFGHIJKLMNOPQRSTUV"[value % base];
+        value /= base;
+    } while (value > 0);
+    for (int i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+/**
+ * Write request number n straight into a claimed slot and work out its answer.
+ * @param n the request number
+ * @param slot the slot's text buffer
+ * @param pending set to the expected answer
+ * @return the length of the text
+ */
+static int makeRequest(uint64_t n, char* slot, Pending* pending)
+{
+    uint64_t mix = n * 0x9E3779B97F4A7C15u;
+    long x = (mix >> 12) & 0xFFFFF;
+    long y = (mix >> 40) & 0xFFFFF;
+    char op = "+-*"[n % 3];
+    pending->base = 2 + n % 31;
+    pending->expected = op == '+' ? x + y : op == '-' ? x - y : x * y;
+
+    int length = sprintf(slot, "$%d ", pending->base);
+    length += formatValue(x, pending->base, slot + length);
+    slot[length++] = ' ';
+    slot[length++] = op;
+    slot[length++] = ' ';
+    length += formatValue(y, pending->base, slot + length);
+    return length;
+}
+
+/**
+ * Compare round trips for qsort.
+ * @param a a round trip
+ * @param b another
+ * @return their order
+ */
+static int compareTimes(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Runs the load test.
+ * @param argc argument count
+ * @param argv NAME [COUNT] [DEPTH]
+ * @return 0 if every result was right, 1 otherwise
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s NAME [COUNT] [DEPTH]\n", argv[0]);
+        return 1;
+    }
+    long count = argc >= 3 ? atol(argv[2]) : DEFAULT_COUNT;
+    int depth = argc >= 4 ? atoi(argv[3]) : DEFAULT_DEPTH;
+    if (count < 1 || depth < 1 || depth > INFIX_MAX_IN_FLIGHT) {
+        fprintf(stderr, "COUNT must be positive and DEPTH from 1 to %d\n", INFIX_MAX_IN_FLIGHT);
+        return 1;
+    }
+    InfixClient* client = infixConnect(argv[1], CONNECT_TIMEOUT_MS);
+    if (client == NULL) {
+        fprintf(stderr, "Cannot connect to %s\n", argv[1]);
+        return 1;
+    }
+
+    Pending pending[INFIX_MAX_IN_FLIGHT];
+    uint64_t* roundTrips = malloc(count * sizeof(uint64_t));
+    long submitted = 0;
+    long received = 0;
+    long wrong = 0;
+    uint64_t begin = now();
+    while (received < count) {
+        while (submitted < count && infixInFlight(client) < depth) {
+            Pending* request = &pending[submitted % INFIX_MAX_IN_FLIGHT];
+            char* slot = infixClaim(client, submitted);
+            if (slot == NULL) {
+                fprintf(stderr, "The server of %s exited\n", argv[1]);
+                return 1;
+            }
+            request->start = now();
+            infixPublish(client, makeRequest(submitted, slot, request));
+            submitted++;
+        }
+        InfixResult result;
+        if (infixReceive(client, &result) != 0) {
+            fprintf(stderr, "The server of %s exited\n", argv[1]);
+            return 1;
+        }
+        const Pending* request = &pending[result.tag % INFIX_MAX_IN_FLIGHT];
+        roundTrips[received] = now() - request->start;
+        if (result.tag != (uint64_t)received || result.status != 0 || result.value != request->expected || result.base != request->base) {
+            if (wrong == 0) {
+                fprintf(stderr, "request %lu: got %ld in base %d with status %d, expected %ld in base %d\n",
+                        (unsigned long)result.tag, result.value, result.base, result.status, request->expected, request->base);
+            }
+            wrong++;
+        }
+        received++;
+    }
+    double seconds = (now() - begin) / 1e9;
+    infixClose(client);
+
+    qsort(roundTrips, count, sizeof(uint64_t), compareTimes);
+    printf("%ld requests, %d in flight: %.0f per second, round trip p50 %.1fus p99 %.1fus max %.1fus, %ld wrong\n",
+           count, depth, count / seconds, roundTrips[count / 2] / 1e3, roundTrips[count * 99 / 100] / 1e3,
+           roundTrips[count - 1] / 1e3, wrong);
+    free(roundTrips);
+    return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+/** 
+ * @file latency.c
+ * @author Jason Wang
+ * This program records how long each expression takes to evaluate, in log-linear (HDR-style) histograms:
+ * below 16ns every nanosecond has its own bucket, above it every power of two is split into 16 buckets,
+ * so each latency is kept to within 6.25% in a fixed amount of memory. There is a histogram for every
+ * length class and base. Each evaluating thread records into its own histograms, so recording takes two clock
+ * reads and a few plain stores; a report merges the threads' histograms when it is printed.
+*/
+#include "latency.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/** Set by SIGUSR1. It is the only state shared by the whole process, as signal dispositions already are. */
+static atomic_int printRequested;
+
+/** Percentiles printed for every histogram. */
+static const double PERCENTILES[] = { 0.50, 0.90, 0.99, 0.999 };
+
+/** Names of the length classes. */
+static const char* const LENGTH_NAMES[LATENCY_LENGTHS] = { "<16", "16-63", "64-255", "256-1023", ">=1024" };
+
+/**
+ * SIGUSR1 handler: asks the next thread to record a latency to print the report.
+ * @param signal SIGUSR1
+ */
+static void requestPrint(int signal)
+{
+    atomic_store(&printRequested, 1);
+}
+
+/**
+ * Creates an empty report and installs the SIGUSR1 handler.
+ * @return the report, or NULL if memory ran out
+ */
+LatencyReport* latencyReportCreate(void)
+{
+    LatencyReport* report = calloc(1, sizeof(LatencyReport));
+    if (report == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&report->lock, NULL);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestPrint;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+    return report;
+}
+
+/**
+ * Creates the histograms of one thread and adds them to the report.
+ * @param report the report
+ * @return the thread's histograms, or NULL if memory ran out
+ */
+LatencyStats* latencyStatsCreate(LatencyReport* report)
+{
+    LatencyStats* stats = calloc(1, sizeof(LatencyStats));
+    if (stats == NULL) {
+        return NULL;
+    }
+    stats->report = report;
+    pthread_mutex_lock(&report->lock);
+    stats->next = report->stats;
+    report->stats = stats;
+    pthread_mutex_unlock(&report->lock);
+    return stats;
+}
+
+/**
+ * Reads the monotonic clock.
+ * @return nanoseconds since an arbitrary point
+ */
+uint64_t latencyNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Finds the bucket of a latency: the value itself below 16, otherwise 16 buckets per power of two,
+ * chosen by the four bits after the leading one.
+ * @param nanoseconds the latency
+ * @return the bucket, clamped to the last one
+ */
+static inline int bucketOf(uint64_t nanoseconds)
+{
+    if (nanoseconds < LATENCY_SUB_BUCKETS) {
+        return nanoseconds;
+    }
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    int bucket = (exponent - 3) * LATENCY_SUB_BUCKETS + ((nanoseconds >> (exponent - 4)) & (LATENCY_SUB_BUCKETS - 1));
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/**
+ * The middle of a bucket, reported for percentiles that fall in it.
+ * @param bucket the bucket
+ * @return a latency in nanoseconds
+ */
+static uint64_t bucketValue(int bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+    return low + ((1ULL << shift) >> 1);
+}
+
+/**
+ * Finds the length class of an expression.
+ * @param length its length in characters
+ * @return 0 to LATENCY_LENGTHS - 1
+ */
+static inline int lengthClass(size_t length)
+{
+    int lengthClass = 0;
+    for (size_t limit = 16; lengthClass < LATENCY_LENGTHS - 1 && length >= limit; limit *= 4) {
+        lengthClass++;
+    }
+    return lengthClass;
+}
+
+/**
+ * Keeps an expression among the slowest, replacing the fastest of them.
+ * @param stats the thread's histograms
+ * @param nanoseconds its latency, above the floor
+ * @param text the expression
+ */
+static void keepSlowest(LatencyStats* stats, uint64_t nanoseconds, const char* text)
+{
+    pthread_mutex_lock(&stats->report->lock);
+    int fastest = 0;
+    for (int i = 1; i < LATENCY_SLOWEST; i++) {
+        if (stats->slowest[i].nanoseconds < stats->slowest[fastest].nanoseconds) {
+            fastest = i;
+        }
+    }
+    stats->slowest[fastest].nanoseconds = nanoseconds;
+    strncpy(stats->slowest[fastest].text, text, LATENCY_TEXT - 1);
+    stats->slowest[fastest].text[LATENCY_TEXT - 1] = '\0';
+    uint64_t floor = nanoseconds;
+    for (int i = 0; i < LATENCY_SLOWEST; i++) {
+        if (stats->slowest[i].nanoseconds < floor) {
+            floor = stats->slowest[i].nanoseconds;
+        }
+    }
+    stats->slowestFloor = floor;
+    pthread_mutex_unlock(&stats->report->lock);
+}
+
+/**
+ * Records one expression. Only the thread that owns the histograms may call this.
+ * @param stats the thread's histograms
+ * @param nanoseconds how long the expression took
+ * @param length its length in characters
+ * @param base the base it was read in
+ * @param text the expression, kept if it is among the slowest
+ */
+void latencyRecord(LatencyStats* stats, uint64_t nanoseconds, size_t length, int base, const char* text)
+{
+    int lengthIndex = lengthClass(length);
+    int baseIndex = base >= 0 && base < LATENCY_BASES ? base : 0;
+    // Relaxed atomics: free for the only writer, and a report printed meanwhile never sees a torn count
+    uint32_t* count = &stats->counts[lengthIndex][baseIndex][bucketOf(nanoseconds)];
+    __atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    uint64_t* max = &stats->max[lengthIndex][baseIndex];
+    if (nanoseconds > __atomic_load_n(max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(max, nanoseconds, __ATOMIC_RELAXED);
+    }
+    if (nanoseconds > stats->slowestFloor) {
+        keepSlowest(stats, nanoseconds, text);
+    }
+    if (atomic_load_explicit(&printRequested, memory_order_relaxed) && atomic_exchange(&printRequested, 0)) {
+        latencyPrint(stats->report, stderr);
+    }
+}
+
+/**
+ * Prints one histogram's count, percentiles and maximum.
+ * @param out where to print
+ * @param name what the histogram covers
+ * @param counts the histogram
+ * @param max the largest latency in it
+ */
+static void printHistogram(FILE* out, const char* name, const uint64_t* counts, uint64_t max)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        total += counts[i];
+    }
+    fprintf(out, "%-24s %10lu", name, total);
+    for (size_t p = 0; p < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); p++) {
+        // The smallest latency with at least this share of the expressions at or below it
+        uint64_t rank = (uint64_t)(PERCENTILES[p] * total + 0.999999);
+        uint64_t seen = 0;
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && (seen += counts[bucket]) < rank) {
+            bucket++;
+        }
+        uint64_t value = bucketValue(bucket);
+        fprintf(out, " %10lu", value < max ? value : max);
+    }
+    fprintf(out, " %10lu\n", max);
+}
+
+/**
+ * Prints a line for all expressions, one for every length and base that has any, and the slowest expressions.
+ * Latencies are in nanoseconds. Safe to call while other threads are still recording.
+ * @param report the report
+ * @param out where to print
+ */
+void latencyPrint(LatencyReport* report, FILE* out)
+{
+    const size_t CELLS = LATENCY_LENGTHS * LATENCY_BASES;
+    uint64_t* counts = calloc(CELLS + 1, LATENCY_BUCKETS * sizeof(uint64_t));
+    uint64_t* totals = calloc(CELLS + 1, sizeof(uint64_t));
+    uint64_t* max = calloc(CELLS + 1, sizeof(uint64_t));
+    SlowExpression slowest[LATENCY_SLOWEST];
+    if (counts == NULL || totals == NULL || max == NULL) {
+        free(counts);
+        free(totals);
+        free(max);
+        return;
+    }
+    memset(slowest, 0, sizeof(slowest));
+
+    // Merge every thread's histograms; cell CELLS collects all of them
+    pthread_mutex_lock(&report->lock);
+    for (LatencyStats* stats = report->stats; stats != NULL; stats = stats->next) {
+        for (size_t cell = 0; cell < CELLS; cell++) {
+            const uint32_t* from = stats->counts[cell / LATENCY_BASES][cell % LATENCY_BASES];
+            uint64_t cellMax = __atomic_load_n(&stats->max[cell / LATENCY_BASES][cell % LATENCY_BASES], __ATOMIC_RELAXED);
+            for (int i = 0; i < LATENCY_BUCKETS; i++) {
+                uint32_t count = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+                counts[cell * LATENCY_BUCKETS + i] += count;
+                counts[CELLS * LATENCY_BUCKETS + i] += count;
+                totals[cell] += count;
+            }
+            max[cell] = cellMax > max[cell] ? cellMax : max[cell];
+            max[CELLS] = cellMax > max[CELLS] ? cellMax : max[CELLS];
+        }
+        for (int i = 0; i < LATENCY_SLOWEST; i++) {
+            // Keep the overall slowest by replacing the fastest kept so far
+            int fastest = 0;
+            for (int j = 1; j < LATENCY_SLOWEST; j++) {
+                if (slowest[j].nanoseconds < slowest[fastest].nanoseconds) {
+                    fastest = j;
+                }
+            }
+            if (stats->slowest[i].nanoseconds > slowest[fastest].nanoseconds) {
+                slowest[fastest] = stats->slowest[i];
+            }
+        }
+    }
+    pthread_mutex_unlock(&report->lock);
+
+    fprintf(out, "%-24s %10s %10s %10s %10s %10s %10s\n", "latency (ns)", "count", "p50", "p90", "p99", "p99.9", "max");
+    printHistogram(out, "all", counts + CELLS * LATENCY_BUCKETS, max[CELLS]);
+    for (size_t cell = 0; cell < CELLS; cell++) {
+        if (totals[cell] != 0) {
+            char name[32];
+            snprintf(name, sizeof(name), "length %s base %zu", LENGTH_NAMES[cell / LATENCY_BASES], cell % LATENCY_BASES);
+            printHistogram(out, name, counts + cell * LATENCY_BUCKETS, max[cell]);
+        }
+    }
+
+    // Slowest first
+    fprintf(out, "slowest (ns)\n");
+    for (int i = 0; i < LATENCY_SLOWEST; i++) {
+        int slowestIndex = i;
+        for (int j = i + 1; j < LATENCY_SLOWEST; j++) {
+            if (slowest[j].nanoseconds > slowest[slowestIndex].nanoseconds) {
+                slowestIndex = j;
+            }
+        }
+        SlowExpression swap = slowest[i];
+        slowest[i] = slowest[slowestIndex];
+        slowest[slowestIndex] = swap;
+        if (slowest[i].nanoseconds != 0) {
+            fprintf(out, "%10lu  %s\n", slowest[i].nanoseconds, slowest[i].text);
+        }
+    }
+    fflush(out);
+    free(counts);
+    free(totals);
+    free(max);
+}
+
+/**
+ * Frees a report and every thread's histograms; no thread may still be recording.
+ * @param report the report
+ */
+void latencyReportFree(LatencyReport* report)
+{
+    LatencyStats* stats = report->stats;
+    while (stats != NULL) {
+        LatencyStats* next = stats->next;
+        free(stats);
+        stats = next;
+    }
+    pthread_mutex_destroy(&report->lock);
+    free(report);
+}
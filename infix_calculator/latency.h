@@ -0,0 +1,65 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/** Sub-buckets per power of two; latencies are kept to within 1/16 (6.25%). */
+#define LATENCY_SUB_BUCKETS 16
+
+/** Buckets of a histogram: exact below 16ns, then 16 per power of two up to 2^40ns (about 18 minutes). */
+#define LATENCY_BUCKETS (37 * LATENCY_SUB_BUCKETS)
+
+/** Expression length classes: under 16, 64, 256 and 1024 characters, and longer. */
+#define LATENCY_LENGTHS 5
+
+/** Bases 0 to 32, indexed directly. */
+#define LATENCY_BASES 33
+
+/** How many of the slowest expressions are kept. */
+#define LATENCY_SLOWEST 10
+
+/** How much of a slow expression's text is kept. */
+#define LATENCY_TEXT 96
+
+/** One of the slowest expressions. */
+typedef struct {
+    uint64_t nanoseconds;
+    char text[LATENCY_TEXT];
+} SlowExpression;
+
+struct LatencyReport;
+
+/** The latencies recorded by one thread. Only that thread writes them; the counters can be read at any time. */
+typedef struct LatencyStats {
+    uint32_t counts[LATENCY_LENGTHS][LATENCY_BASES][LATENCY_BUCKETS];
+    uint64_t max[LATENCY_LENGTHS][LATENCY_BASES];
+    /** The slowest expressions, guarded by the report's lock */
+    SlowExpression slowest[LATENCY_SLOWEST];
+    /** The fastest of the kept slowest, below which nothing needs the lock */
+    uint64_t slowestFloor;
+    struct LatencyReport* report;
+    struct LatencyStats* next;
+} LatencyStats;
+
+/** All threads' latencies for one run. */
+typedef struct LatencyReport {
+    pthread_mutex_t lock;
+    LatencyStats* stats;
+} LatencyReport;
+
+/** Function to create a report and make SIGUSR1 ask for it to be printed*/
+LatencyReport* latencyReportCreate(void);
+/** Function to add a thread's latencies to a report*/
+LatencyStats* latencyStatsCreate(LatencyReport* report);
+/** Function to read the clock used for latencies, in nanoseconds*/
+uint64_t latencyNow(void);
+/** Function to record one expression's latency, printing the report if SIGUSR1 asked for it*/
+void latencyRecord(LatencyStats* stats, uint64_t nanoseconds, size_t length, int base, const char* text);
+/** Function to print the percentiles of every length and base, and the slowest expressions*/
+void latencyPrint(LatencyReport* report, FILE* out);
+/** Function to free a report and the latencies of every thread*/
+void latencyReportFree(LatencyReport* report);
+
+#endif /*LATENCY_H*/
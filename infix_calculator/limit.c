@@ -0,0 +1,164 @@
+/**
+ * @file limit.c
+ * @author Jason Wang
+ * This program enforces the caps of --limit on each evaluation: input bytes, nesting depth, operator applications
+ * and CPU time. The evaluators count depth and operations inline (see context.h); those counters are compared with
+ * a precomputed cap, so with no limits set an operation costs an increment and a comparison that never succeeds.
+ * The CPU clock is only read every LIMIT_INTERVAL operations, and an evaluation over any cap fails with FAIL_LIMIT.
+ * Threads sharing one evaluation add their usage to a LimitPool at the same checkpoints and compare its totals.
+*/
+#include "limit.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "operation.h"
+
+/**
+ * Read the CPU time of the calling thread.
+ * @return nanoseconds
+ */
+static uint64_t cpuNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Sets one limit from a --limit argument: length=BYTES, depth=LEVELS, operations=COUNT or time=MILLISECONDS,
+ * the time possibly fractional. A value of 0 removes the limit.
+ * @param limits the limits
+ * @param setting the argument
+ * @return 0, or FAIL_INPUT if the argument is not one of those
+ */
+int limitSet(Limits* limits, const char* setting)
+{
+    const char* equals = strchr(setting, '=');
+    if (equals == NULL || equals[1] == '\0') {
+        return FAIL_INPUT;
+    }
+    size_t nameLength = equals - setting;
+    const char* value = equals + 1;
+    char* end;
+    errno = 0;
+    if (nameLength == 4 && strncmp(setting, "time", 4) == 0) {
+        double milliseconds = strtod(value, &end);
+        if (*end != '\0' || errno != 0 || !(milliseconds >= 0) || milliseconds > 1e12) {
+            return FAIL_INPUT;
+        }
+        limits->nanoseconds = (uint64_t)(milliseconds * 1e6);
+        return 0;
+    }
+    if (*value == '-') {
+        return FAIL_INPUT;
+    }
+    unsigned long long count = strtoull(value, &end, 10);
+    if (*end != '\0' || errno != 0) {
+        return FAIL_INPUT;
+    }
+    if (nameLength == 6 && strncmp(setting, "length", 6) == 0) {
+        limits->length = count;
+    } else if (nameLength == 5 && strncmp(setting, "depth", 5) == 0) {
+        limits->depth = count;
+    } else if (nameLength == 10 && strncmp(setting, "operations", 10) == 0) {
+        limits->operations = count;
+    } else {
+        return FAIL_INPUT;
+    }
+    return 0;
+}
+
+/**
+ * The operation count at which limitReached must run next: just past the operation cap, or sooner to read the clock.
+ * @param context the evaluation context
+ * @return the count
+ */
+static uint64_t nextCheckpoint(const EvalContext* context)
+{
+    uint64_t checkpoint = context->limits.operations != 0 ? context->limits.operations + 1 : UINT64_MAX;
+    bool pooled = context->usage.pool != NULL && context->limits.operations != 0;
+    if ((pooled || context->limits.nanoseconds != 0) && context->usage.operations + LIMIT_INTERVAL < checkpoint) {
+        checkpoint = context->usage.operations + LIMIT_INTERVAL;
+    }
+    return checkpoint;
+}
+
+/**
+ * Starts counting for an evaluation. Must be called with the context's recovery point armed.
+ * @param context the evaluation context
+ * @param length bytes of input, or 0 if they are only known as they are read
+ */
+void limitStart(EvalContext* context, size_t length)
+{
+    const Limits* limits = &context->limits;
+    LimitUsage* usage = &context->usage;
+    usage->depth = 0;
+    usage->maxDepth = limits->depth != 0 ? limits->depth : SIZE_MAX;
+    usage->operations = 0;
+    usage->deadline = limits->nanoseconds != 0 ? cpuNow() + limits->nanoseconds : 0;
+    usage->pool = NULL;
+    usage->checkpoint = nextCheckpoint(context);
+    if (limits->length != 0 && length > limits->length) {
+        fail(context, FAIL_LIMIT);
+    }
+}
+
+/**
+ * Counts the rest of an evaluation in a pool: from now on the operation and time caps are compared with what all
+ * the threads that joined it have added up. The pool's counters start at 0 and each thread adds its own usage at
+ * its checkpoints, which come every LIMIT_INTERVAL operations; a thread must call limitReached when it is done so
+ * the last of its usage counts too.
+ * @param context the evaluation context of the thread, after limitStart
+ * @param pool the pool
+ */
+void limitJoin(EvalContext* context, LimitPool* pool)
+{
+    LimitUsage* usage = &context->usage;
+    usage->pool = pool;
+    usage->pooledOperations = usage->operations;
+    usage->pooledClock = context->limits.nanoseconds != 0 ? cpuNow() : 0;
+    usage->checkpoint = nextCheckpoint(context);
+}
+
+/**
+ * Fails an evaluation that opened more levels than the depth cap allows.
+ * @param context the evaluation context
+ */
+void limitTooDeep(EvalContext* context)
+{
+    fail(context, FAIL_LIMIT);
+}
+
+/**
+ * The slow check, run when the operation count reaches the checkpoint, and by readers of unbounded input
+ * between reads: fails if the evaluation has used too many operations or too much CPU time.
+ * @param context the evaluation context
+ */
+void limitReached(EvalContext* context)
+{
+    const Limits* limits = &context->limits;
+    LimitUsage* usage = &context->usage;
+    uint64_t operations = usage->operations;
+    uint64_t now = limits->nanoseconds != 0 ? cpuNow() : 0;
+    bool late = limits->nanoseconds != 0 && now >= usage->deadline;
+    if (usage->pool != NULL) {
+        uint64_t added = usage->operations - usage->pooledOperations;
+        operations = atomic_fetch_add(&usage->pool->operations, added) + added;
+        usage->pooledOperations = usage->operations;
+        if (limits->nanoseconds != 0) {
+            uint64_t spent = atomic_fetch_add(&usage->pool->nanoseconds, now - usage->pooledClock) + now - usage->pooledClock;
+            usage->pooledClock = now;
+            late = spent >= limits->nanoseconds;
+        }
+    }
+    if (limits->operations != 0 && operations > limits->operations) {
+        fail(context, FAIL_LIMIT);
+    }
+    if (late) {
+        fail(context, FAIL_LIMIT);
+    }
+    usage->checkpoint = nextCheckpoint(context);
+}
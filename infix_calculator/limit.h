@@ -0,0 +1,59 @@
+#ifndef LIMIT_H
+#define LIMIT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct EvalContext;
+
+/** Operator applications between two readings of the CPU clock under a time limit. */
+#define LIMIT_INTERVAL 1024
+
+/** Caps on one evaluation, set with --limit; 0 means no cap. */
+typedef struct {
+    /** Bytes of input */
+    size_t length;
+    /** Parentheses, negations and operators open at once, waiting for what follows them */
+    size_t depth;
+    /** Operator applications, negations included */
+    uint64_t operations;
+    /** CPU time of the evaluating thread, in nanoseconds */
+    uint64_t nanoseconds;
+} Limits;
+
+/** Operations and CPU time that the threads sharing one evaluation add up, so its caps do not grow with the threads. */
+typedef struct {
+    atomic_uint_fast64_t operations;
+    atomic_uint_fast64_t nanoseconds;
+} LimitPool;
+
+/** What the current evaluation has used, and when the slow check in limitReached must next run. */
+typedef struct {
+    size_t depth;
+    /** The depth cap, SIZE_MAX when there is none, so entering a level is one comparison */
+    size_t maxDepth;
+    uint64_t operations;
+    /** Operation count at which limitReached runs next, UINT64_MAX when nothing needs checking */
+    uint64_t checkpoint;
+    /** CPU clock reading at which the evaluation fails */
+    uint64_t deadline;
+    /** The pool this thread's share of the evaluation is added to, or NULL when the thread evaluates all of it */
+    LimitPool* pool;
+    /** Operation count and CPU clock reading up to which this thread's usage is in the pool */
+    uint64_t pooledOperations;
+    uint64_t pooledClock;
+} LimitUsage;
+
+/** Function to set one limit from a --limit argument such as "depth=100"; returns 0, or FAIL_INPUT if it is not valid*/
+int limitSet(Limits* limits, const char* setting);
+/** Function to start counting for an evaluation of that many bytes, failing with FAIL_LIMIT if there are too many*/
+void limitStart(struct EvalContext* context, size_t length);
+/** Function to count the rest of an evaluation started with limitStart in a pool shared with other threads*/
+void limitJoin(struct EvalContext* context, LimitPool* pool);
+/** Function to check the operation count and the CPU time, failing with FAIL_LIMIT if either is over its cap*/
+void limitReached(struct EvalContext* context);
+/** Function to fail an evaluation nested deeper than its cap*/
+void limitTooDeep(struct EvalContext* context) __attribute__((noreturn));
+
+#endif /*LIMIT_H*/
@@ -0,0 +1,179 @@
+/** 
+ * @file modular.c
+ * @author Jason Wang
+ * This program implements the arithmetic of --mod M, where every value is a residue modulo M.
+ * Residues are below M <= LONG_MAX < 2^63, so a sum of two still fits an unsigned long and a product fits 128 bits.
+ * A single product is reduced with a 128-bit remainder; a power of an odd modulus runs in Montgomery form,
+ * where each of its multiplications is reduced with multiplies and a shift instead of a division.
+ * Division multiplies by the modular inverse, which exists whenever the divisor is coprime to M (always, for a prime M).
+*/
+#include "modular.h"
+
+#include <limits.h>
+#include "operation.h"
+
+/** Unsigned 128-bit integer for products of two residues. */
+typedef unsigned __int128 u128;
+
+/**
+ * Sets up a modulus and, for an odd one, its Montgomery constants with R = 2^64.
+ * @param modulus the modulus to set up
+ * @param value M
+ * @return 0, or FAIL_INPUT if M is not from 1 to LONG_MAX
+ */
+int modulusInit(Modulus* modulus, long value)
+{
+    if (value < 1) {
+        return FAIL_INPUT;
+    }
+    unsigned long m = value;
+    modulus->value = m;
+    modulus->montgomery = (m & 1) != 0 && m > 1;
+    modulus->negInverse = 0;
+    modulus->rSquared = 0;
+    if (modulus->montgomery) {
+        // Newton's iteration doubles the correct low bits each step: 3 (m * m == 1 mod 8 for odd m), 6, ..., 96
+        unsigned long inverse = m;
+        for (int i = 0; i < 5; i++) {
+            inverse *= 2 - m * inverse;
+        }
+        modulus->negInverse = -inverse;
+        unsigned long r = -m % m;
+        modulus->rSquared = (u128)r * r % m;
+    }
+    return 0;
+}
+
+/**
+ * Reduces any long to its residue.
+ * @param modulus the modulus
+ * @param value the value
+ * @return value modulo M, from 0 to M - 1
+ */
+long modReduce(const Modulus* modulus, long value)
+{
+    long residue = value % (long)modulus->value;
+    return residue < 0 ? residue + (long)modulus->value : residue;
+}
+
+/**
+ * Montgomery reduction: t * 2^-64 modulo M, for t below M * 2^64.
+ * @param modulus an odd modulus
+ * @param t the value to reduce
+ * @return the reduced value, below M
+ */
+static inline unsigned long redc(const Modulus* modulus, u128 t)
+{
+    unsigned long q = (unsigned long)t * modulus->negInverse;
+    unsigned long reduced = (t + (u128)q * modulus->value) >> 64;
+    return reduced >= modulus->value ? reduced - modulus->value : reduced;
+}
+
+/**
+ * Multiplies two residues with a 128-bit intermediate.
+ * @param modulus the modulus
+ * @param a a residue
+ * @param b a residue
+ * @return a * b modulo M
+ */
+static inline unsigned long mulMod(const Modulus* modulus, unsigned long a, unsigned long b)
+{
+    return (u128)a * b % modulus->value;
+}
+
+/**
+ * Finds the inverse of a residue with the extended Euclidean algorithm.
+ * @param context the evaluation context
+ * @param modulus the modulus
+ * @param a a residue
+ * @return the inverse; fails with FAIL_DIVZERO if a and M are not coprime
+ */
+static unsigned long inverseMod(EvalContext* context, const Modulus* modulus, unsigned long a)
+{
+    // Invariants: r0 == s0 * a and r1 == s1 * a modulo M; the coefficients never exceed M in size
+    long r0 = modulus->value, r1 = a;
+    long s0 = 0, s1 = 1;
+    while (r1 != 0) {
+        long q = r0 / r1;
+        long r = r0 - q * r1;
+        r0 = r1;
+        r1 = r;
+        long s = s0 - q * s1;
+        s0 = s1;
+        s1 = s;
+    }
+    if (r0 != 1) {
+        // Dividing by a multiple of a factor of M is as undefined as dividing by zero
+        fail(context, FAIL_DIVZERO);
+    }
+    return modReduce(modulus, s0);
+}
+
+/**
+ * Square-and-multiply: one squaring per bit of the exponent and one multiplication per set bit.
+ * A negative exponent raises the inverse instead.
+ * @param context the evaluation context
+ * @param modulus the modulus
+ * @param base a residue
+ * @param exponent any long
+ * @return base ^ exponent modulo M
+ */
+long modPow(EvalContext* context, const Modulus* modulus, long base, long exponent)
+{
+    unsigned long x = base;
+    unsigned long e = exponent;
+    if (exponent < 0) {
+        x = inverseMod(context, modulus, x);
+        e = -e;
+    }
+    if (!modulus->montgomery) {
+        unsigned long result = 1 % modulus->value;
+        for (; e != 0; e >>= 1) {
+            if (e & 1) {
+                result = mulMod(modulus, result, x);
+            }
+            x = mulMod(modulus, x, x);
+        }
+        return result;
+    }
+
+    // Into Montgomery form (x * R), where multiplying is a product and a redc
+    x = redc(modulus, (u128)x * modulus->rSquared);
+    unsigned long result = -modulus->value % modulus->value;
+    for (; e != 0; e >>= 1) {
+        if (e & 1) {
+            result = redc(modulus, (u128)result * x);
+        }
+        x = redc(modulus, (u128)x * x);
+    }
+    return redc(modulus, result);
+}
+
+/**
+ * Applies an operator to two residues.
+ * @param context the evaluation context
+ * @param modulus the modulus
+ * @param a a residue
+ * @param b a residue, or for ^ the exponent as an ordinary integer
+ * @param op the operator
+ * @return the result, a residue
+ */
+long modApplyOp(EvalContext* context, const Modulus* modulus, long a, long b, char op)
+{
+    unsigned long m = modulus->value;
+    unsigned long x = a;
+    unsigned long y = b;
+    switch (op) {
+        case '+':
+            return x + y >= m ? x + y - m : x + y;
+        case '-':
+            return x >= y ? x - y : x + m - y;
+        case '*':
+            return mulMod(modulus, x, y);
+        case '/':
+            return mulMod(modulus, x, inverseMod(context, modulus, y));
+        case '^':
+            return modPow(context, modulus, a, b);
+    }
+    return 0;
+}
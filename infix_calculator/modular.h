@@ -0,0 +1,29 @@
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include <stdbool.h>
+
+struct EvalContext;
+
+/** A modulus and the constants Montgomery multiplication needs for it. */
+typedef struct {
+    /** The modulus, from 1 to LONG_MAX, or 0 when arithmetic is not modular */
+    unsigned long value;
+    /** Whether powers use Montgomery form; only possible for an odd modulus above 1 */
+    bool montgomery;
+    /** -value^-1 modulo 2^64 */
+    unsigned long negInverse;
+    /** 2^128 modulo value, used to move into Montgomery form */
+    unsigned long rSquared;
+} Modulus;
+
+/** Function to set up a modulus; returns 0, or FAIL_INPUT if it is not between 1 and LONG_MAX*/
+int modulusInit(Modulus* modulus, long value);
+/** Function to reduce a value to its residue from 0 to the modulus less one*/
+long modReduce(const Modulus* modulus, long value);
+/** Function to apply an operator to two residues, failing with FAIL_DIVZERO when the divisor has no inverse*/
+long modApplyOp(struct EvalContext* context, const Modulus* modulus, long a, long b, char op);
+/** Function to raise a residue to a power, failing with FAIL_DIVZERO for a negative power of a non-invertible residue*/
+long modPow(struct EvalContext* context, const Modulus* modulus, long base, long exponent);
+
+#endif /*MODULAR_H*/
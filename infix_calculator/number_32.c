@@ -8,50 +8,35 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "operation.h"
-
-// Value of the base, so we don't have to use a magic number all over the code. You might need to change this for number_n file.
-int BASE = 32;
+#include "scan.h"
+#include "decimal.h"
+#include "radix.h"
+#include "probes.h"
 
 /**
- * This function reads characters from standard input. It keeps reading characters until it reaches a non-whitespace character or EOF. 
- * It returns the code for the first non-whitespace character it finds (or EOF). For this function, whitespace does not include the newline character. 
- * Code inside the number component or elsewhere in the program can use this to easily skip past whitespace within an expression.
- * @return char code for the first non-whitespace character it finds
+ * This function removes whitespace from the expression in place, using the vectorized scanner in scan.c.
+ * Only ASCII whitespace is removed, independent of the locale.
+ * @param expression the expression to compact
+ * @return the same expression, compacted
 */
 char* skipSpace(char* expression)
 {
-    char* result = expression;
-    char* current = expression;
-
-    while (*current) {
-        if (!isspace(*current)) {
-            *result = *current;
-            result++;
-        }
-        current++;
-    }
-
-    *result = '\0';  // Null-terminate the resulting string
+    scanExpression(expression, SCAN_LETTERS);
     return expression;
 }
 
 /**
  * This function reads the next number from the input.it will read a number in base 32
  * If it detects errors in the input number, it terminates the program with the appropriate exit status.
+ * @param context the evaluation context
  * @param expression the expression to read
  * @param i the integer array space
+ * @param length the length of the expression, which the literal is never read past
  * @return long value the parsed value as base value.
 */
-long parseValue(char* expression, int* i)
+long parseValue(EvalContext* context, char* expression, int* i, int length)
 {
-    long val = 0;
-    int expression_length = strlen(expression);
-    while (*i < expression_length && isdigit(expression[*i])) 
-    {
-        val = (val * 10) + (expression[*i] - '0');
-        *i = *i + 1;
-    }
-    return val;
+    return parseDecimal(context, expression, i, length);
 }
 
 
@@ -66,11 +51,12 @@ void printValue(long val)
 
 /**
  * This function converts the digit to base 10. 
+ * @param context the evaluation context
  * @param digit the digit read in.
  * @param base the base to convert digit to
  * @return long value converted
 */
-long convertDigitToBase10(char digit, int base) 
+long convertDigitToBase10(EvalContext* context, char digit, int base) 
 {
     long value;
 
@@ -80,13 +66,13 @@ long convertDigitToBase10(char digit, int base)
     } else if (digit >= 'A' && digit <= 'Z') {
         value = digit - 'A' + 10;
     } else {
-        printf("Invalid character: %c\n", digit);
-        exit(FAIL_INPUT);
+        fprintf(stderr, "Invalid character: %c\n", digit);
+        fail(context, FAIL_INPUT);
     }
 
     // Check for invalid digits in base N
     if (value >= base) {
-        exit(FAIL_INPUT);
+        fail(context, FAIL_INPUT);
     }
 
     return value;
@@ -94,20 +80,26 @@ long convertDigitToBase10(char digit, int base)
 
 /**
  * This function converst base N to base 10 for more conversion
+ * The base's kernel is selected once and parses every literal (see radix.c). A literal that does not fit in a long
+ * terminates the program with FAIL_OVERFLOW once the whole expression has been checked for invalid digits.
+ * @param context the evaluation context whose arena holds the converted expression and whose base is used
  * @param expression the const expression
- * @param base the base to be used
  * @return char* the char to be as base 10
 */
-char* convertBaseNtoBase10(const char* expression, int base) 
+char* convertBaseNtoBase10(EvalContext* context, const char* expression) 
 {
     int len = strlen(expression);
-    char* convertedExpression = malloc((len * 2 + 1) * sizeof(char));  // Allocate memory for the converted expression
+    char* convertedExpression = contextAlloc(context, len * 2 + 1);  // Scratch for the converted expression, released with the arena
     int convertedIndex = 0;
+    bool overflow = false;
+    const RadixKernel* kernel = radixKernel(context->base);
+    if (kernel == NULL) {
+        fail(context, FAIL_INPUT);
+    }
 
     for (int i = 0; i < len; i++) {
         // Check if the character is a valid digit in base N
         if ((expression[i] >= '0' && expression[i] <= '9') || (expression[i] >= 'A' && expression[i] <= 'Z')) {
-            int startIndex = i;
             int endIndex = i;
 
             // Find the end index of the number
@@ -116,19 +108,15 @@ char* convertBaseNtoBase10(const char* expression, int base)
             }
 
             // Convert the number to base 10
-            long value = 0;
-            long power = 1;
-            for (int j = endIndex - 1; j >= startIndex; j--) {
-                long digitValue = convertDigitToBase10(expression[j], base);
-                value += digitValue * power;
-                power *= base;
+            unsigned long value = 0;
+            int status = kernel->parse(expression + i, endIndex - i, &value);
+            if (status == FAIL_INPUT) {
+                fail(context, FAIL_INPUT);
             }
+            overflow = overflow || status == FAIL_OVERFLOW;
 
-            // Convert the value to a string and append it to the converted expression
-            char valueString[20];  // Assuming the maximum number of digits is 20
-            sprintf(valueString, "%ld", value);
-            strcat(convertedExpression, valueString);
-            convertedIndex += strlen(valueString);
+            // Append the value; a base 10 literal is never longer than twice the base N one
+            convertedIndex += sprintf(convertedExpression + convertedIndex, "%lu", value);
 
             // Update the main loop index
             i = endIndex - 1;
@@ -141,6 +129,10 @@ char* convertBaseNtoBase10(const char* expression, int base)
 
     convertedExpression[convertedIndex] = '\0';  // Null-terminate the converted expression
 
+    if (overflow) {
+        fail(context, FAIL_OVERFLOW);
+    }
+    PROBE2(tokenize, convertedIndex, context->base);
     return convertedExpression;
 }
 
@@ -161,56 +153,20 @@ int isValidDigit(int digit, int base) {
 
 /**
  * Function to convert a decimal value to the specified base
+ * @param context the evaluation context, whose base the value is printed in
  * @param val the value to convert
- * @param base the base to convert value to
  */ 
-void convertToBase(long val, int base) {
-    if (base < 1 || base > 32) {
+void convertToBase(EvalContext* context, long val) {
+    const RadixKernel* kernel = radixKernel(context->base);
+    if (kernel == NULL) {
         
-        exit(FAIL_INPUT);
-    }
-
-    int result[100];
-    int i = 0;
-
-    if (val == 0) {
-        result[i++] = 0;
-    } else {
-        int negative = 0;
-
-        if (val < 0) {
-            negative = 1;
-            val = -val;
-        }
-
-        while (val > 0) {
-            int remainder = val % base;
-            result[i++] = remainder;
-            val /= base;
-        }
-
-        if (negative) {
-            result[i++] = -1; // Flag for negative sign
-        }
+        fail(context, FAIL_INPUT);
     }
-    if (i == 0) {
-        printf("0");
-    } else {
-        if (result[i - 1] == -1) {
-            printf("-");
-            i--;
-        }
 
-        for (int j = i - 1; j >= 0; j--) {
-            if (result[j] < 10) {
-                printf("%d", result[j]);
-            } else {
-                printf("%c", 'A' + result[j] - 10);
-            }
-        }
-    }
-
-    printf("\n");
+    char digits[RADIX_MAX_DIGITS];
+    formatWithKernel(val, kernel, digits);
+    PROBE2(output, val, context->base);
+    printf("%s\n", digits);
 }
 
 /**
@@ -235,39 +191,40 @@ int numberOfOperators(char* expression)
 
 /**
  * Parses expression string, extracts base value and expression.
+ * @param context the evaluation context whose arena holds the extracted expression
  * @param expressionString expression string to be parsed
  * @return ExpressionData structure containing extracted base value  expression.
  */
-ExpressionData parseExpression(const char* expressionString) {
+ExpressionData parseExpression(EvalContext* context, const char* expressionString) {
     ExpressionData data;
 
-    // Create a copy of the expression string
-    char expressionCopy[MAX_SIZE];
-    strcpy(expressionCopy, expressionString);
-
-    // Tokenize the expression copy using space as the delimiter
-    char* token = strtok(expressionCopy, " ");
+    // The base is the first space-separated word, e.g. "$16"
+    const char* token = expressionString + strspn(expressionString, " ");
+    size_t tokenLength = strcspn(token, " ");
 
     // Extract the base value
-    if (token == NULL || sscanf(token + 1, "%d", &data.base) != 1) {
-        printf("Error: Invalid base value in the expression.\n");
+    if (tokenLength == 0 || sscanf(token + 1, "%d", &data.base) != 1) {
+        fprintf(stderr, "Error: Invalid base value in the expression.\n");
         data.base = 0;
         data.expression = NULL;
         return data;
     }
 
-    // Tokenize further to get the complete expression
-    char expressionBuffer[MAX_SIZE] = "";
-    token = strtok(NULL, "");
-    if (token == NULL) {
-        printf("Error: Expression missing in the input.\n");
+    // Only bases with a parse/format kernel can be evaluated
+    if (radixKernel(data.base) == NULL) {
+        fail(context, FAIL_INPUT);
+    }
+
+    // The expression is everything after the space that ends the base
+    if (token[tokenLength] == '\0' || token[tokenLength + 1] == '\0') {
+        fprintf(stderr, "Error: Expression missing in the input.\n");
         data.base = 0;
         data.expression = NULL;
         return data;
     }
 
     // Remove leading and trailing spaces from the expression
-    const char* expressionStart = token;
+    const char* expressionStart = token + tokenLength + 1;
     while (*expressionStart == ' ') {
         expressionStart++;
     }
@@ -276,13 +233,10 @@ ExpressionData parseExpression(const char* expressionString) {
         expressionLength--;
     }
 
-    // Copy the expression into the buffer
-    strncpy(expressionBuffer, expressionStart, expressionLength);
-    expressionBuffer[expressionLength] = '\0';
-
-    // Allocate memory for the expression and copy it
-    data.expression = malloc(strlen(expressionBuffer) + 1);
-    strcpy(data.expression, expressionBuffer);
+    // Copy the expression into the context's arena
+    data.expression = contextAlloc(context, expressionLength + 1);
+    memcpy(data.expression, expressionStart, expressionLength);
+    data.expression[expressionLength] = '\0';
 
     return data;
 }
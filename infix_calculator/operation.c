@@ -4,6 +4,7 @@
  * This program helps process the input using functions and operations.
 */
 #include "operation.h"
+#include "probes.h"
 #include <stdlib.h>
 #include <limits.h>
 
@@ -21,104 +22,156 @@
 
 #include "operation.h"
 
+/**
+ * Ends the current evaluation with an exit status: records it in the context and longjmps to the
+ * context's recovery point, which then sees the status as the setjmp result. Nothing outside the
+ * context is touched, so evaluations on other threads carry on.
+ * @param context the evaluation context, whose recovery point must be armed
+ * @param status the exit status, never 0
+ */
+void fail(EvalContext* context, int status)
+{
+    context->status = status;
+    PROBE2(error, status, context->base);
+    longjmp(*context->recovery, status);
+}
+
 /** Adds two long values.
+ * @param context the evaluation context
  * @param a the first value
  * @param b the second value
  * @return the sum of a and b
  */
-long plus(long a, long b)
+long plus(EvalContext* context, long a, long b)
 {
     if ((b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b)) {
         
-        exit(FAIL_OVERFLOW);
+        fail(context, FAIL_OVERFLOW);
     }
     return a + b;
 }
 
 /** Subtracts two long values.
+ * @param context the evaluation context
  * @param a the first value
  * @param b the second value
  * @return the result of a and b
  */
-long minus(long a, long b)
+long minus(EvalContext* context, long a, long b)
 {
     if ((b > 0 && a < LONG_MIN + b) || (b < 0 && a > LONG_MAX + b)) {
         
-        exit(FAIL_OVERFLOW);
+        fail(context, FAIL_OVERFLOW);
     }
     return a - b;
 }
 
+/**
+ * Number of significant bits in the magnitude of a value, 0 for 0.
+ * @param value the value
+ * @return the bit length of |value|, up to 64 for LONG_MIN
+ */
+static inline int bitLength(long value)
+{
+    unsigned long magnitude = value < 0 ? -(unsigned long)value : (unsigned long)value;
+    return magnitude == 0 ? 0 : 64 - __builtin_clzl(magnitude);
+}
+
 /** Multiplies two long values.
+ * Factors of L and M bits have a product of at least 2^(L+M-2), so L + M above 65 is rejected from the bit lengths alone.
+ * @param context the evaluation context
  * @param a the first value
  * @param b the second value
  * @return the total of a and b
  */
-long times(long a, long b)
+long times(EvalContext* context, long a, long b)
 {
-    if (a > 0) {
-        if (b > 0 && a > LONG_MAX / b) {
-            
-            exit(FAIL_OVERFLOW);
+    long product;
+    if (bitLength(a) + bitLength(b) > 65 || __builtin_mul_overflow(a, b, &product)) {
+        
+        fail(context, FAIL_OVERFLOW);
+    }
+    return product;
+}
+
+/**
+ * Raises a to the power b in O(log b) steps, reporting failures through the return value.
+ * Bases 0, 1 and -1 have closed forms. For any other base, |a| >= 2^(L-1) with L its bit length, so a power
+ * with (L-1) * b above 63 cannot fit and is rejected without multiplying; what is left needs at most 63 bits of
+ * exponent and is computed by square-and-multiply with checked multiplications.
+ * @param a the base
+ * @param b the exponent
+ * @param result set to the power on success
+ * @return 0, FAIL_NEGEXP or FAIL_OVERFLOW
+ */
+static int power(long a, long b, long* result)
+{
+    if (b < 0) {
+        return FAIL_NEGEXP;
+    }
+    if (a == 0 || a == 1) {
+        *result = a == 1 || b == 0;
+        return 0;
+    }
+    if (a == -1) {
+        *result = (b & 1) ? -1 : 1;
+        return 0;
+    }
+    if (b > 63 / (bitLength(a) - 1)) {
+        return FAIL_OVERFLOW;
+    }
+    // A square that is still needed and overflows means the power overflows too, since it is a factor of it
+    long value = 1;
+    for (;;) {
+        if ((b & 1) && __builtin_mul_overflow(value, a, &value)) {
+            return FAIL_OVERFLOW;
         }
-        if (b < 0 && b < LONG_MIN / a) {
-            
-            exit(FAIL_OVERFLOW);
+        b >>= 1;
+        if (b == 0) {
+            break;
         }
-    } else if (a < 0) {
-        if (b > 0 && a < LONG_MIN / b) {
-            
-            exit(FAIL_OVERFLOW);
-        }
-        if (b < 0 && (a != -1 || b != LONG_MIN)) {
-            if (b < LONG_MAX / a) {
-                
-                exit(FAIL_OVERFLOW);
-            }
+        if (__builtin_mul_overflow(a, a, &a)) {
+            return FAIL_OVERFLOW;
         }
     }
-    return a * b;
+    *result = value;
+    return 0;
 }
 
 /** Exponentiates two long values.
+ * @param context the evaluation context
  * @param a the first value
  * @param b the second value
  * @return the total of a and b
  */
-long exponentiate(long a, long b)
+long exponentiate(EvalContext* context, long a, long b)
 {
-    if (b < 0)
+    long result;
+    int status = power(a, b, &result);
+    if (status != 0)
     {
         
-        exit(FAIL_NEGEXP);
-    }
-    long result = 1;
-    for (long i = 0; i < b; i++)
-    {
-        if (result > LONG_MAX / a) {
-            
-            exit(FAIL_OVERFLOW);
-        }
-        result *= a;
+        fail(context, status);
     }
     return result;
 }
 
 /** Divides two long values.
+ * @param context the evaluation context
  * @param a the first value
  * @param b the second value
  * @return the division of a and b
  */
-long divide(long a, long b)
+long divide(EvalContext* context, long a, long b)
 {
     if (b == 0)
     {
         
-        return FAIL_DIVZERO;
+        fail(context, FAIL_DIVZERO);
     }
     if (a == LONG_MIN && b == -1) {
         
-        return FAIL_OVERFLOW;
+        fail(context, FAIL_OVERFLOW);
     }
     return a / b;
 }
@@ -197,12 +250,13 @@ long pop(Stack* stack) {
 
 /**
  * Remove and return the top character from stack
+ * @param context the evaluation context
  * @param stack the stack to pop
  * @return popped character
  */
-char popChar(Stack* stack) {
+char popChar(EvalContext* context, Stack* stack) {
     if (isEmpty(stack)) {
-        exit(FAIL_INPUT);
+        fail(context, FAIL_INPUT);
         return '\0';
     }
     char poppedElement = stack->charArr[stack->top];
@@ -212,12 +266,13 @@ char popChar(Stack* stack) {
 
 /**
  * Retrieve top element of the stack without removal
+ * @param context the evaluation context
  * @param stack stack to get element from
  * @return top element of the stack
  */
-long top(Stack* stack) {
+long top(EvalContext* context, Stack* stack) {
     if (isEmpty(stack)) {
-        exit(FAIL_INPUT);
+        fail(context, FAIL_INPUT);
         return -1;
     }
     return stack->longArr[stack->top];
@@ -225,12 +280,13 @@ long top(Stack* stack) {
 
 /**
  * Retrieve top character of the stack without removal.
+ * @param context the evaluation context
  * @param stack  stack to get top character
  * @return top character of stack
  */
-char topChar(Stack* stack) {
+char topChar(EvalContext* context, Stack* stack) {
     if (isEmpty(stack)) {
-        exit(FAIL_INPUT);
+        fail(context, FAIL_INPUT);
         return '\0';
     }
     return stack->charArr[stack->top];
@@ -262,34 +318,67 @@ int precedence(char op) {
 
 /**
  * Apply given operator to the operands
+ * @param context the evaluation context
  * @param a first operand
  * @param b second operand
  * @param op operator to apply
  * @return result of applying the operator to the operands
  */
-long applyOp(long a, long b, char op) {
+long applyOp(EvalContext* context, long a, long b, char op) {
     switch (op) {
         case '+':
-            return plus(a,b);
+            return plus(context, a, b);
         case '-':
-            return minus(a,b);
+            return minus(context, a, b);
         case '*':
-            return times(a,b);
+            return times(context, a, b);
         case '/':
-            if(b==0) return FAIL_DIVZERO;
-            return divide(a,b);
+            return divide(context, a, b);
         case '^':
-            return exponentiate(a,b);
+            return exponentiate(context, a, b);
     }
     return 0;
 }
 
+/**
+ * Apply given operator to the operands, reporting failures through the return value instead of exiting.
+ * Used where one bad row must not end the whole run.
+ * @param a first operand
+ * @param b second operand
+ * @param op operator to apply
+ * @param result set to the result when the operation succeeds
+ * @return 0 on success, otherwise FAIL_OVERFLOW, FAIL_DIVZERO, FAIL_NEGEXP or FAIL_INPUT for an unknown operator
+ */
+int tryApplyOp(long a, long b, char op, long* result) {
+    switch (op) {
+        case '+':
+            return __builtin_add_overflow(a, b, result) ? FAIL_OVERFLOW : 0;
+        case '-':
+            return __builtin_sub_overflow(a, b, result) ? FAIL_OVERFLOW : 0;
+        case '*':
+            return __builtin_mul_overflow(a, b, result) ? FAIL_OVERFLOW : 0;
+        case '/':
+            if (b == 0) {
+                return FAIL_DIVZERO;
+            }
+            if (a == LONG_MIN && b == -1) {
+                return FAIL_OVERFLOW;
+            }
+            *result = a / b;
+            return 0;
+        case '^':
+            return power(a, b, result);
+    }
+    return FAIL_INPUT;
+}
+
 /**
  * Checks if expression is valid
+ * @param context the evaluation context
  * @param expression  expression to validate
  * @return 0 if the expression is valid, otherwise an error code
  */
-int isValid(char* expression) {
+int isValid(EvalContext* context, char* expression) {
 
     int expression_length = strlen(expression);
 
@@ -298,20 +387,20 @@ int isValid(char* expression) {
         // Check for divide by zero
         if (expression[i] == '/' && expression[i + 1] == '0') {
             
-            exit(FAIL_DIVZERO);
+            fail(context, FAIL_DIVZERO);
         }
         // Check for double operators
         if (expression[i] == '+'  || expression[i] == '*' || expression[i] == '/' || expression[i] == '^') {
             if (i < expression_length - 1 && (expression[i] == expression[i + 1])) {
                
-                exit(FAIL_INPUT);
+                fail(context, FAIL_INPUT);
             }
         }
 
-        // Check for invalid characters (excluding numbers and operators)
-        if (!isdigit(expression[i]) && expression[i] != '+' && expression[i] != '-' && expression[i] != '*' && expression[i] != '/' && expression[i] != '^') {
+        // Check for invalid characters (excluding numbers, operators and parentheses)
+        if (!isdigit(expression[i]) && !isOperator(expression[i]) && expression[i] != '(' && expression[i] != ')') {
             
-            exit(FAIL_INPUT);
+            fail(context, FAIL_INPUT);
         }
 
         // Check for negative exponents
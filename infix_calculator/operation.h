@@ -7,6 +7,8 @@
 #include <math.h>
 #include <stdbool.h>
 #include <limits.h> 
+#include <setjmp.h>
+#include "context.h"
 
 /** Exit status for when an overflow occurs. */
 #define FAIL_OVERFLOW 100
@@ -20,6 +22,9 @@
 /** Exit status for when fail input . */
 #define FAIL_INPUT 102
 
+/** Exit status for when an evaluation goes over a cap of --limit. */
+#define FAIL_LIMIT 104
+
 #define MAX_SIZE 10000  
 
 // Define a stack structure
@@ -32,30 +37,34 @@ typedef struct {
     int isCharStack;
 } Stack;
 
+/** Function to end the evaluation with an exit status, returning to the context's recovery point*/
+void fail(EvalContext* context, int status) __attribute__((noreturn));
 /** Function to add*/
-long plus(long a, long b);
+long plus(EvalContext* context, long a, long b);
 /** Function to subtract*/
-long minus(long a, long b);
+long minus(EvalContext* context, long a, long b);
 /** Function to multiply*/
-long times(long a, long b);
+long times(EvalContext* context, long a, long b);
 /** Function to exponentiate*/
-long exponentiate(long a, long b);
+long exponentiate(EvalContext* context, long a, long b);
 /** Function to divide*/
-long divide(long a, long b);
+long divide(EvalContext* context, long a, long b);
 /** Function to apply operator*/
-long applyOp(long a, long b, char op);
+long applyOp(EvalContext* context, long a, long b, char op);
+/** Function to apply operator, returning a status instead of exiting*/
+int tryApplyOp(long a, long b, char op, long* result);
 /** Function to check validity*/
-int isValid(char* expression);
+int isValid(EvalContext* context, char* expression);
 /** Function to check precedence*/
 int precedence(char op);
 /** Function to check if it is a operator*/
 bool isOperator(char character);
 /** Function to check top char*/
-char topChar(Stack* stack);
+char topChar(EvalContext* context, Stack* stack);
 /** Function to use top*/
-long top(Stack* stack);
+long top(EvalContext* context, Stack* stack);
 /** Function to pop char*/
-char popChar(Stack* stack);
+char popChar(EvalContext* context, Stack* stack);
 /** Function to pop*/
 long pop(Stack* stack);
 /** Function to push char*/
@@ -0,0 +1,189 @@
+/** 
+ * @file overflow.c
+ * @author Jason Wang
+ * This program implements the operators under each overflow policy. A policy is a table of operators,
+ * picked once for an evaluation, so the operators themselves never look at which policy is in force.
+ * Trapping is what the operators of operation.c already do, so its table is made of them.
+ * Wrapping and saturating operators are branchless: the overflow bit comes from the checked builtins and
+ * the saturated value is selected from it with a conditional move. The only branches left are the errors
+ * no policy can turn into a value, division by zero and negative exponents.
+*/
+#include "overflow.h"
+
+#include <string.h>
+#include "operation.h"
+
+/**
+ * The value to saturate to: LONG_MIN when the true result is negative, LONG_MAX otherwise.
+ * @param negative any long whose sign bit is the sign of the true result
+ * @return LONG_MIN or LONG_MAX
+ */
+static inline long saturated(long negative)
+{
+    return (negative >> 63) ^ LONG_MAX;
+}
+
+/**
+ * Divides, failing for division by zero; only LONG_MIN / -1 overflows, and its wrapped quotient is LONG_MIN.
+ * @param context the evaluation context
+ * @param a the dividend
+ * @param b the divisor
+ * @param over set to whether the quotient did not fit
+ * @return the quotient, LONG_MIN for LONG_MIN / -1
+ */
+static inline long wrappedQuotient(EvalContext* context, long a, long b, bool* over)
+{
+    if (b == 0) {
+        fail(context, FAIL_DIVZERO);
+    }
+    *over = (a == LONG_MIN) & (b == -1);
+    // Dividing by 1 instead keeps the hardware from trapping and already gives the wrapped LONG_MIN
+    return a / (*over ? 1 : b);
+}
+
+/**
+ * Raises a to the power b by square-and-multiply with wrapping multiplications, which give the power modulo 2^64.
+ * A square that is still needed and overflows means the power overflows too, since the power is at least as large.
+ * @param context the evaluation context
+ * @param a the base
+ * @param b the exponent, failing if negative
+ * @param over set to whether the power did not fit
+ * @return the power modulo 2^64
+ */
+static inline long wrappedPower(EvalContext* context, long a, long b, bool* over)
+{
+    if (b < 0) {
+        fail(context, FAIL_NEGEXP);
+    }
+    long result = 1;
+    *over = false;
+    for (;;) {
+        if (b & 1) {
+            *over |= __builtin_mul_overflow(result, a, &result);
+        }
+        b >>= 1;
+        if (b == 0) {
+            break;
+        }
+        *over |= __builtin_mul_overflow(a, a, &a);
+    }
+    return result;
+}
+
+/** Adds modulo 2^64. */
+static long wrapPlus(EvalContext* context, long a, long b)
+{
+    long sum;
+    context->overflowed |= __builtin_add_overflow(a, b, &sum);
+    return sum;
+}
+
+/** Subtracts modulo 2^64. */
+static long wrapMinus(EvalContext* context, long a, long b)
+{
+    long difference;
+    context->overflowed |= __builtin_sub_overflow(a, b, &difference);
+    return difference;
+}
+
+/** Multiplies modulo 2^64. */
+static long wrapTimes(EvalContext* context, long a, long b)
+{
+    long product;
+    context->overflowed |= __builtin_mul_overflow(a, b, &product);
+    return product;
+}
+
+/** Divides, wrapping LONG_MIN / -1 to LONG_MIN. */
+static long wrapDivide(EvalContext* context, long a, long b)
+{
+    bool over;
+    long quotient = wrappedQuotient(context, a, b, &over);
+    context->overflowed |= over;
+    return quotient;
+}
+
+/** Exponentiates modulo 2^64. */
+static long wrapPower(EvalContext* context, long a, long b)
+{
+    bool over;
+    long power = wrappedPower(context, a, b, &over);
+    context->overflowed |= over;
+    return power;
+}
+
+/** Adds, clamping; an overflowing sum has the sign of both operands. */
+static long saturatePlus(EvalContext* context, long a, long b)
+{
+    long sum;
+    bool over = __builtin_add_overflow(a, b, &sum);
+    context->overflowed |= over;
+    return over ? saturated(a) : sum;
+}
+
+/** Subtracts, clamping; an overflowing difference has the sign of a. */
+static long saturateMinus(EvalContext* context, long a, long b)
+{
+    long difference;
+    bool over = __builtin_sub_overflow(a, b, &difference);
+    context->overflowed |= over;
+    return over ? saturated(a) : difference;
+}
+
+/** Multiplies, clamping; an overflowing product is negative when exactly one operand is. */
+static long saturateTimes(EvalContext* context, long a, long b)
+{
+    long product;
+    bool over = __builtin_mul_overflow(a, b, &product);
+    context->overflowed |= over;
+    return over ? saturated(a ^ b) : product;
+}
+
+/** Divides, clamping LONG_MIN / -1 to LONG_MAX. */
+static long saturateDivide(EvalContext* context, long a, long b)
+{
+    bool over;
+    long quotient = wrappedQuotient(context, a, b, &over);
+    context->overflowed |= over;
+    return over ? LONG_MAX : quotient;
+}
+
+/** Exponentiates, clamping; an overflowing power is negative when the base is negative and the exponent odd. */
+static long saturatePower(EvalContext* context, long a, long b)
+{
+    bool over;
+    long power = wrappedPower(context, a, b, &over);
+    context->overflowed |= over;
+    return over ? saturated(a & -(b & 1)) : power;
+}
+
+const OverflowPolicy OVERFLOW_TRAP = {
+    "trap",
+    { ['+'] = plus, ['-'] = minus, ['*'] = times, ['/'] = divide, ['^'] = exponentiate },
+};
+
+const OverflowPolicy OVERFLOW_WRAP = {
+    "wrap",
+    { ['+'] = wrapPlus, ['-'] = wrapMinus, ['*'] = wrapTimes, ['/'] = wrapDivide, ['^'] = wrapPower },
+};
+
+const OverflowPolicy OVERFLOW_SATURATE = {
+    "saturate",
+    { ['+'] = saturatePlus, ['-'] = saturateMinus, ['*'] = saturateTimes, ['/'] = saturateDivide, ['^'] = saturatePower },
+};
+
+/**
+ * Finds a policy by the name given to --overflow.
+ * @param name "trap", "wrap" or "saturate"
+ * @return the policy, or NULL for any other name
+ */
+const OverflowPolicy* overflowPolicyNamed(const char* name)
+{
+    static const OverflowPolicy* const POLICIES[] = { &OVERFLOW_TRAP, &OVERFLOW_WRAP, &OVERFLOW_SATURATE };
+    for (size_t i = 0; i < sizeof(POLICIES) / sizeof(POLICIES[0]); i++) {
+        if (strcmp(POLICIES[i]->name, name) == 0) {
+            return POLICIES[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef OVERFLOW_H
+#define OVERFLOW_H
+
+#include <stdbool.h>
+#include <limits.h>
+
+struct EvalContext;
+
+/** One operator under one policy; sets the context's overflowed flag when the true result did not fit, and never clears it. */
+typedef long (*PolicyOp)(struct EvalContext* context, long a, long b);
+
+/** What happens when an operator's result does not fit in a long. */
+typedef struct {
+    /** The name given to --overflow */
+    const char* name;
+    /** The operators, indexed by their character; NULL for anything else */
+    PolicyOp ops[UCHAR_MAX + 1];
+} OverflowPolicy;
+
+/** Fail the evaluation with FAIL_OVERFLOW, the default. */
+extern const OverflowPolicy OVERFLOW_TRAP;
+/** Keep the low 64 bits, as two's complement arithmetic does, and flag the result. */
+extern const OverflowPolicy OVERFLOW_WRAP;
+/** Clamp to LONG_MIN or LONG_MAX, whichever the true result is beyond, and flag the result. */
+extern const OverflowPolicy OVERFLOW_SATURATE;
+
+/** Function to find a policy by name, or NULL*/
+const OverflowPolicy* overflowPolicyNamed(const char* name);
+
+#endif /*OVERFLOW_H*/
@@ -0,0 +1,467 @@
+/**
+ * @file parallel.c
+ * @author Jason Wang
+ * This program evaluates a single expression too large for one thread, such as a file of hundreds of megabytes,
+ * by indexing its structure first, the way simdjson indexes JSON:
+ *
+ * 1. Each thread classifies its share of the mapped file 64 bytes at a time with SSE2 compares into bitmaps of
+ *    parentheses, '+'/'-', whitespace and invalid characters, and sums the parenthesis depth of its share.
+ * 2. A prefix sum over the shares gives the depth each one starts at, so unbalanced parentheses and invalid
+ *    characters are found before anything is evaluated.
+ * 3. Each thread walks its share again and splits it at the binary '+' and '-' at depth 0 (a '-' is binary when
+ *    a literal or ')' comes before it). Each term is evaluated with the streaming evaluator straight from the
+ *    mapping, and the thread folds its terms in 128 bits, or modulo M.
+ *
+ * Since + and - bind loosest and associate to the left, the value is the signed sum of the terms. A thread also
+ * keeps the lowest and highest of its running sums, so the main thread can tell exactly whether any partial sum
+ * evaluated left to right would have left a long, and fails (trap) or flags (wrap) just as one thread would.
+ * Saturation depends on the order of the additions, so under saturate the file is evaluated on one thread.
+*/
+#include "parallel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "number.h"
+#include "radix.h"
+#include "stream.h"
+#include "operation.h"
+
+/** Bitmaps of one block: bit i describes byte i. */
+typedef struct {
+    uint64_t open;
+    uint64_t close;
+    uint64_t plusMinus;
+    /** Everything but whitespace */
+    uint64_t significant;
+    uint64_t invalid;
+} Structure;
+
+/** One thread's share of the input and what it found. */
+typedef struct {
+    pthread_t thread;
+    struct Parallel* parallel;
+    const char* begin;
+    const char* end;
+    /** Depth change over the share, and the lowest depth within it, relative to its start */
+    long depthChange;
+    long lowestDepth;
+    bool invalid;
+    /** The last character of the share that is not whitespace, or 0 */
+    char last;
+    /** Depth at the start of the share, and the last character before it that is not whitespace */
+    long depth;
+    char before;
+    /** Whether this is the first share, which owns the first term even if it starts with a sign */
+    bool first;
+    /** Whether any term was folded into the share */
+    bool hasTerms;
+    /** 0, or the exit status of the first term that failed, after which nothing more was folded */
+    int status;
+    bool overflowed;
+    /** Signed sum of the terms, and its lowest and highest running values after each term */
+    __int128 total;
+    __int128 lowest;
+    __int128 highest;
+    /** The sum of the terms modulo M, under --mod */
+    long residue;
+} Share;
+
+/** Everything the threads share. */
+typedef struct Parallel {
+    const EvalContext* settings;
+    const char* begin;
+    const char* end;
+    bool letters;
+    /** The operations and CPU time of stage 3 on every thread, compared with --limit as one evaluation's */
+    LimitPool usage;
+} Parallel;
+
+/**
+ * Classify 64 bytes. Where fewer are left, the block is padded with spaces.
+ * @param p the first byte
+ * @param length bytes left from p
+ * @param letters whether 'A'-'Z' are literal characters
+ * @param out the bitmaps
+ */
+static void classify(const char* p, size_t length, bool letters, Structure* out)
+{
+    char padded[PARALLEL_BLOCK];
+    if (length < PARALLEL_BLOCK) {
+        memset(padded, ' ', PARALLEL_BLOCK);
+        memcpy(padded, p, length);
+        p = padded;
+    }
+    uint64_t open = 0;
+    uint64_t close = 0;
+    uint64_t plusMinus = 0;
+    uint64_t space = 0;
+    uint64_t valid = 0;
+#ifdef __SSE2__
+    for (int k = 0; k < PARALLEL_BLOCK; k += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(p + k));
+        __m128i isOpen = _mm_cmpeq_epi8(c, _mm_set1_epi8('('));
+        __m128i isClose = _mm_cmpeq_epi8(c, _mm_set1_epi8(')'));
+        __m128i isPlusMinus = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')), _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+        __m128i isOther = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('*')),
+                                       _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')), _mm_cmpeq_epi8(c, _mm_set1_epi8('^'))));
+        // Signed compares: bytes from 0x80 up are negative and fall outside every range
+        __m128i isSpace = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                                       _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1))));
+        __m128i isLiteral = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        if (letters) {
+            isLiteral = _mm_or_si128(isLiteral, _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1))));
+        }
+        __m128i isValid = _mm_or_si128(_mm_or_si128(_mm_or_si128(isOpen, isClose), _mm_or_si128(isPlusMinus, isOther)),
+                                       _mm_or_si128(isSpace, isLiteral));
+        open |= (uint64_t)(uint16_t)_mm_movemask_epi8(isOpen) << k;
+        close |= (uint64_t)(uint16_t)_mm_movemask_epi8(isClose) << k;
+        plusMinus |= (uint64_t)(uint16_t)_mm_movemask_epi8(isPlusMinus) << k;
+        space |= (uint64_t)(uint16_t)_mm_movemask_epi8(isSpace) << k;
+        valid |= (uint64_t)(uint16_t)_mm_movemask_epi8(isValid) << k;
+    }
+#else
+    for (int k = 0; k < PARALLEL_BLOCK; k++) {
+        char c = p[k];
+        uint64_t bit = 1ULL << k;
+        open |= c == '(' ? bit : 0;
+        close |= c == ')' ? bit : 0;
+        plusMinus |= c == '+' || c == '-' ? bit : 0;
+        space |= c == ' ' || (c >= '\t' && c <= '\r') ? bit : 0;
+        valid |= strchr("()+-*/^ \t\n\v\f\r", c) != NULL || (c >= '0' && c <= '9') || (letters && c >= 'A' && c <= 'Z') ? bit : 0;
+    }
+#endif
+    out->open = open;
+    out->close = close;
+    out->plusMinus = plusMinus;
+    out->significant = ~space;
+    out->invalid = ~valid;
+}
+
+/**
+ * The last character of a block that is not whitespace.
+ * @param p the block
+ * @param significant its bitmap of characters that are not whitespace
+ * @param fallback what to return if there is none
+ * @return the character
+ */
+static inline char lastSignificant(const char* p, uint64_t significant, char fallback)
+{
+    return significant != 0 ? p[63 - __builtin_clzll(significant)] : fallback;
+}
+
+/**
+ * Stage 1: classify a share and sum its parenthesis depth.
+ * @param argument the share
+ * @return NULL
+ */
+static void* indexShare(void* argument)
+{
+    Share* share = argument;
+    bool letters = share->parallel->letters;
+    long depth = 0;
+    long lowest = 0;
+    for (const char* p = share->begin; p < share->end; p += PARALLEL_BLOCK) {
+        Structure block;
+        classify(p, share->end - p, letters, &block);
+        share->invalid |= block.invalid != 0;
+        if (block.close == 0) {
+            depth += __builtin_popcountll(block.open);
+        } else {
+            for (uint64_t parens = block.open | block.close; parens != 0; parens &= parens - 1) {
+                depth += (block.open >> __builtin_ctzll(parens) & 1) ? 1 : -1;
+                lowest = depth < lowest ? depth : lowest;
+            }
+        }
+        share->last = lastSignificant(p, block.significant, share->last);
+    }
+    share->depthChange = depth;
+    share->lowestDepth = lowest;
+    return NULL;
+}
+
+/**
+ * Evaluate one term and fold it into the share.
+ * @param share the share
+ * @param context the thread's evaluation context
+ * @param begin the term's first character
+ * @param end just past its last
+ * @param op '+' or '-', the operator before it ('+' for the first term)
+ */
+static void foldTerm(Share* share, EvalContext* context, const char* begin, const char* end, char op)
+{
+    Stream stream;
+    streamBegin(&stream, context, false);
+    streamFeed(&stream, begin, end - begin);
+    long value = streamEnd(&stream);
+    limitOperation(context);
+    if (context->modulus.value != 0) {
+        share->residue = modApplyOp(context, &context->modulus, share->residue, value, op);
+        return;
+    }
+    share->total += op == '+' ? (__int128)value : -(__int128)value;
+    share->lowest = !share->hasTerms || share->total < share->lowest ? share->total : share->lowest;
+    share->highest = !share->hasTerms || share->total > share->highest ? share->total : share->highest;
+    share->hasTerms = true;
+}
+
+/**
+ * Stage 3: evaluate the terms that start in a share. The last may run on past the share's end.
+ * The first share also owns the term at the very start.
+ * @param share the share
+ * @param context the thread's evaluation context, whose recovery point is armed
+ */
+static void evaluateTerms(Share* share, EvalContext* context)
+{
+    const Parallel* parallel = share->parallel;
+    long depth = share->depth;
+    char before = share->before;
+    bool inTerm = share->first;
+    const char* term = share->begin;
+    char op = '+';
+    for (const char* p = share->begin; p < parallel->end; p += PARALLEL_BLOCK) {
+        if (p >= share->end && !inTerm) {
+            return;
+        }
+        Structure block;
+        classify(p, parallel->end - p, parallel->letters, &block);
+        for (uint64_t events = block.open | block.close | block.plusMinus; events != 0; events &= events - 1) {
+            int bit = __builtin_ctzll(events);
+            char c = p[bit];
+            if (c == '(' || c == ')') {
+                depth += c == '(' ? 1 : -1;
+                continue;
+            }
+            if (depth != 0) {
+                continue;
+            }
+            char previous = lastSignificant(p, block.significant & ((1ULL << bit) - 1), before);
+            if (!((previous >= '0' && previous <= '9') || (parallel->letters && previous >= 'A' && previous <= 'Z') || previous == ')')) {
+                // A sign or a negation, part of the term that follows
+                continue;
+            }
+            if (inTerm) {
+                foldTerm(share, context, term, p + bit, op);
+            }
+            if (p + bit >= share->end) {
+                // The next share owns the term that starts here
+                return;
+            }
+            inTerm = true;
+            term = p + bit + 1;
+            op = c;
+        }
+        before = lastSignificant(p, block.significant, before);
+    }
+    if (inTerm) {
+        foldTerm(share, context, term, parallel->end, op);
+    }
+}
+
+/**
+ * Thread body of stage 3, with a context of its own.
+ * @param argument the share
+ * @return NULL
+ */
+static void* evaluateShare(void* argument)
+{
+    Share* share = argument;
+    EvalContext context;
+    contextInitFrom(&context, share->parallel->settings);
+    jmp_buf recovery;
+    context.recovery = &recovery;
+    share->status = setjmp(recovery);
+    if (share->status == 0) {
+        limitStart(&context, 0);
+        limitJoin(&context, &share->parallel->usage);
+        evaluateTerms(share, &context);
+        // Adds what is left of the share's usage, so the last thread to finish sees the total
+        limitReached(&context);
+    }
+    share->overflowed = context.overflowed;
+    contextFree(&context);
+    return NULL;
+}
+
+/**
+ * Run one stage on every share, one thread each.
+ * @param shares the shares
+ * @param count how many
+ * @param stage the stage
+ */
+static void runStage(Share* shares, int count, void* (*stage)(void*))
+{
+    for (int i = 1; i < count; i++) {
+        pthread_create(&shares[i].thread, NULL, stage, &shares[i]);
+    }
+    stage(&shares[0]);
+    for (int i = 1; i < count; i++) {
+        pthread_join(shares[i].thread, NULL);
+    }
+}
+
+/**
+ * Skips an infix_n "$base" header, setting the context's base.
+ * @param context the evaluation context
+ * @param p the start of the file
+ * @param end its end
+ * @return the first character after the header
+ */
+static const char* skipHeader(EvalContext* context, const char* p, const char* end)
+{
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (p == end || *p != '$') {
+        fail(context, FAIL_INPUT);
+    }
+    int base = 0;
+    for (p++; p < end && *p >= '0' && *p <= '9' && base <= RADIX_MAX_BASE; p++) {
+        base = base * 10 + *p - '0';
+    }
+    if (p == end || !isspace((unsigned char)*p) || radixKernel(base) == NULL) {
+        fail(context, FAIL_INPUT);
+    }
+    context->base = base;
+    return p;
+}
+
+/**
+ * Evaluates the expression in a mapped file, as the context's program would evaluate it on one line.
+ * @param context the evaluation context, whose base is set to the base to print the value in
+ * @param begin the file
+ * @param end its end
+ * @param threads how many threads to use at most
+ * @return long value of the expression
+ */
+static long evaluateMapped(EvalContext* context, const char* begin, const char* end, int threads)
+{
+    context->overflowed = false;
+    context->base = context->program == PROGRAM_10 ? 10 : 32;
+    limitStart(context, end - begin);
+    if (context->overflow == &OVERFLOW_SATURATE) {
+        Stream stream;
+        streamBegin(&stream, context, context->program == PROGRAM_N);
+        streamFeed(&stream, begin, end - begin);
+        return streamEnd(&stream);
+    }
+    if (context->program == PROGRAM_N) {
+        begin = skipHeader(context, begin, end);
+    }
+
+    size_t length = end - begin;
+    if (threads > (int)(length / PARALLEL_MIN_CHUNK) + 1) {
+        threads = length / PARALLEL_MIN_CHUNK + 1;
+    }
+    Parallel parallel = { .settings = context, .begin = begin, .end = end, .letters = context->program != PROGRAM_10 };
+    Share* shares = contextAlloc(context, threads * sizeof(Share));
+    memset(shares, 0, threads * sizeof(Share));
+    for (int i = 0; i < threads; i++) {
+        shares[i].parallel = &parallel;
+        shares[i].first = i == 0;
+        shares[i].begin = begin + length * i / threads;
+        shares[i].end = begin + length * (i + 1) / threads;
+    }
+
+    // Stages 1 and 2: index the shares, then find the depth and previous character each starts with
+    runStage(shares, threads, indexShare);
+    long depth = 0;
+    char before = 0;
+    for (int i = 0; i < threads; i++) {
+        if (shares[i].invalid || depth + shares[i].lowestDepth < 0) {
+            fail(context, FAIL_INPUT);
+        }
+        shares[i].depth = depth;
+        shares[i].before = before;
+        depth += shares[i].depthChange;
+        before = shares[i].last != 0 ? shares[i].last : before;
+    }
+    if (depth != 0) {
+        fail(context, FAIL_INPUT);
+    }
+
+    // Stage 3, then the shares' sums in order, as one thread would have added the terms
+    runStage(shares, threads, evaluateShare);
+    __int128 sum = 0;
+    long residue = 0;
+    for (int i = 0; i < threads; i++) {
+        Share* share = &shares[i];
+        if (share->hasTerms && (sum + share->lowest < LONG_MIN || sum + share->highest > LONG_MAX)) {
+            if (context->overflow == &OVERFLOW_TRAP) {
+                fail(context, FAIL_OVERFLOW);
+            }
+            context->overflowed = true;
+        }
+        if (share->status != 0) {
+            fail(context, share->status);
+        }
+        context->overflowed |= share->overflowed;
+        sum += share->total;
+        if (context->modulus.value != 0) {
+            residue = modApplyOp(context, &context->modulus, residue, share->residue, '+');
+        }
+    }
+    return context->modulus.value != 0 ? residue : (long)(unsigned long)sum;
+}
+
+/**
+ * Maps a file and evaluates the expression in it on up to THREADS threads, printing the result like the single-line mode.
+ * @param context the evaluation context
+ * @param path the file
+ * @param threads the most threads to use, or 0 for one per processor
+ * @return 0 or the exit status the expression produced
+ */
+int runParallel(EvalContext* context, const char* path, int threads)
+{
+    if (threads <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors > 0 ? (int)processors : 1;
+    }
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Error: Cannot read %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return FAIL_INPUT;
+    }
+    size_t size = info.st_size;
+    const char* mapped = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map %s.\n", path);
+        return FAIL_INPUT;
+    }
+    if (mapped != NULL) {
+        madvise((void*)mapped, size, MADV_SEQUENTIAL);
+    }
+
+    jmp_buf recovery;
+    context->recovery = &recovery;
+    context->status = setjmp(recovery);
+    if (context->status == 0) {
+        long result = evaluateMapped(context, mapped, mapped + size, threads);
+        if (context->program == PROGRAM_10) {
+            printValue(result);
+        } else {
+            convertToBase(context, result);
+        }
+        // A policy that keeps going still reports the overflow through the exit status
+        context->status = context->overflowed ? FAIL_OVERFLOW : 0;
+    }
+    context->recovery = NULL;
+    if (mapped != NULL) {
+        munmap((void*)mapped, size);
+    }
+    return context->status;
+}
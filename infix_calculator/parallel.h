@@ -0,0 +1,15 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "context.h"
+
+/** Bytes classified at a time, one bit per byte in each bitmap. */
+#define PARALLEL_BLOCK 64
+
+/** Smallest share of the input worth a thread of its own. */
+#define PARALLEL_MIN_CHUNK (1 << 20)
+
+/** Function to evaluate the one expression in a file of any size on several threads*/
+int runParallel(EvalContext* context, const char* path, int threads);
+
+#endif /*PARALLEL_H*/
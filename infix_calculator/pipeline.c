@@ -0,0 +1,351 @@
+/** 
+ * @file pipeline.c
+ * @author Jason Wang
+ * This program evaluates a stream of expressions, one per line, with overlapping stages:
+ * a reader thread splits standard input into batches of lines, evaluator threads run the batches,
+ * and the writer (the calling thread) puts the results back in input order and writes them out.
+ * The stages hand batches to each other through bounded lock-free rings, and a fixed pool of batches
+ * travels around the loop reader -> evaluators -> writer -> reader, so memory stays bounded.
+ * With a reduction the evaluators fold their results instead (see reduce.c) and the writer only recycles batches.
+*/
+#include "pipeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "ring.h"
+#include "radix.h"
+#include "operation.h"
+
+/** Bytes requested per read of standard input. */
+#define READ_CHUNK (1 << 20)
+
+/** Bytes of formatted output collected before each write. */
+#define WRITE_CHUNK 65536
+
+/** Offset of a line that was too long to evaluate. */
+#define LINE_TOO_LONG -1
+
+/** A run of consecutive input lines and, once evaluated, their results. */
+typedef struct {
+    /** Position of the batch in the input; the end marker carries the batch count */
+    size_t sequence;
+    /** Number of lines, or -1 for the end marker */
+    int count;
+    size_t used;
+    int offsets[BATCH_LINES];
+    long results[BATCH_LINES];
+    int bases[BATCH_LINES];
+    int statuses[BATCH_LINES];
+    /** Whether a line that evaluated overflowed under a policy that keeps going */
+    bool overflowed[BATCH_LINES];
+    char text[BATCH_BYTES];
+} Batch;
+
+/** Everything the stages share. */
+typedef struct {
+    LineEvaluator evaluate;
+    /** Settings each evaluator copies into a context of its own */
+    const EvalContext* settings;
+    int threads;
+    /** Empty batches, returned by the writer to the reader */
+    Ring free;
+    /** Batches of lines waiting for an evaluator */
+    Ring filled;
+    /** Evaluated batches (and the end marker), in any order */
+    Ring done;
+    /** Where the evaluators merge what they folded, or NULL to print every result */
+    Reduction* reduction;
+    /** Guards the merges into reduction */
+    pthread_mutex_t lock;
+} Pipeline;
+
+/**
+ * Check whether a line has anything but whitespace; blank lines are skipped like scanf(" %[^\n]") does.
+ * @param line the line
+ * @param length its length
+ * @return true if the line is blank
+ */
+static bool isBlank(const char* line, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '\v' && line[i] != '\f') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Add a complete line to the reader's batch, sending the batch on first if it is full.
+ * @param pipeline the pipeline
+ * @param batch the batch being filled, replaced when it is sent
+ * @param sequence the next batch sequence number
+ * @param line the line, or NULL if it was too long
+ * @param length its length
+ */
+static void addLine(Pipeline* pipeline, Batch** batch, size_t* sequence, const char* line, size_t length)
+{
+    Batch* current = *batch;
+    if (current->count == BATCH_LINES || (line != NULL && current->used + length + 1 > BATCH_BYTES)) {
+        ringPush(&pipeline->filled, current);
+        current = ringPop(&pipeline->free);
+        current->sequence = (*sequence)++;
+        current->count = 0;
+        current->used = 0;
+        *batch = current;
+    }
+    if (line == NULL) {
+        current->offsets[current->count++] = LINE_TOO_LONG;
+        return;
+    }
+    memcpy(current->text + current->used, line, length);
+    current->text[current->used + length] = '\0';
+    current->offsets[current->count++] = current->used;
+    current->used += length + 1;
+}
+
+/**
+ * Reader stage: splits standard input into lines and batches.
+ * @param argument the pipeline
+ * @return NULL
+ */
+static void* readerStage(void* argument)
+{
+    Pipeline* pipeline = argument;
+    char* chunk = malloc(READ_CHUNK);
+    char line[MAX_SIZE];
+    size_t length = 0;
+    bool tooLong = false;
+    size_t sequence = 0;
+
+    Batch* batch = ringPop(&pipeline->free);
+    batch->sequence = sequence++;
+    batch->count = 0;
+    batch->used = 0;
+
+    for (;;) {
+        ssize_t n = chunk == NULL ? 0 : read(STDIN_FILENO, chunk, READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        bool end = n <= 0;
+        const char* p = chunk;
+        const char* limit = end ? chunk : chunk + n;
+        while (p < limit || (end && (length > 0 || tooLong))) {
+            const char* newline = p < limit ? memchr(p, '\n', limit - p) : NULL;
+            size_t piece = (newline != NULL ? newline : limit) - p;
+            if (!tooLong && length + piece < MAX_SIZE) {
+                memcpy(line + length, p, piece);
+                length += piece;
+            } else {
+                tooLong = true;
+            }
+            p += piece;
+            if (newline == NULL && !end) {
+                break;
+            }
+            if (tooLong) {
+                addLine(pipeline, &batch, &sequence, NULL, 0);
+            } else if (!isBlank(line, length)) {
+                addLine(pipeline, &batch, &sequence, line, length);
+            }
+            length = 0;
+            tooLong = false;
+            p += newline != NULL;
+        }
+        if (end) {
+            break;
+        }
+    }
+
+    // Send the last batch even if empty, then the end marker, then one stop signal per evaluator
+    ringPush(&pipeline->filled, batch);
+    Batch* marker = ringPop(&pipeline->free);
+    marker->sequence = sequence;
+    marker->count = -1;
+    ringPush(&pipeline->done, marker);
+    for (int i = 0; i < pipeline->threads; i++) {
+        ringPush(&pipeline->filled, NULL);
+    }
+    free(chunk);
+    return NULL;
+}
+
+/**
+ * Evaluator stage: evaluates every line of each batch it takes, in a context (and arena) of its own.
+ * @param argument the pipeline
+ * @return NULL
+ */
+static void* evaluatorStage(void* argument)
+{
+    Pipeline* pipeline = argument;
+    EvalContext context;
+    contextInitFrom(&context, pipeline->settings);
+    Reduction reduction;
+    if (pipeline->reduction != NULL) {
+        reduceInit(&reduction, pipeline->reduction->kind);
+    }
+    Batch* batch;
+    while ((batch = ringPop(&pipeline->filled)) != NULL) {
+        for (int i = 0; i < batch->count; i++) {
+            if (batch->offsets[i] == LINE_TOO_LONG) {
+                batch->statuses[i] = FAIL_INPUT;
+            } else {
+                batch->statuses[i] = pipeline->evaluate(&context, batch->text + batch->offsets[i], &batch->results[i]);
+                batch->bases[i] = context.base;
+                batch->overflowed[i] = context.overflowed;
+            }
+            if (pipeline->reduction != NULL) {
+                reduceAdd(&reduction, (uint64_t)batch->sequence * BATCH_LINES + i, batch->statuses[i], batch->results[i],
+                          batch->bases[i], batch->overflowed[i]);
+            }
+        }
+        ringPush(&pipeline->done, batch);
+    }
+    if (pipeline->reduction != NULL) {
+        pthread_mutex_lock(&pipeline->lock);
+        reduceMerge(pipeline->reduction, &reduction);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+    contextFree(&context);
+    return NULL;
+}
+
+/**
+ * Write out whatever has been formatted.
+ * @param buffer the formatted text
+ * @param length its length, reset to 0
+ */
+static void flushOutput(const char* buffer, size_t* length)
+{
+    size_t done = 0;
+    while (done < *length) {
+        ssize_t n = write(STDOUT_FILENO, buffer + done, *length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            break;
+        }
+        done += n;
+    }
+    *length = 0;
+}
+
+/**
+ * Writer stage: formats batches in input order. Results print as the programs print them,
+ * failed lines as "error <status>", and results that overflowed under wrap or saturate as "<result> overflow".
+ * @param pipeline the pipeline
+ * @param pool how many batches exist, which bounds how far out of order they can arrive
+ * @return the status of the first failed line, or 0
+ */
+static int writerStage(Pipeline* pipeline, int pool)
+{
+    Batch** pending = calloc(pool, sizeof(Batch*));
+    char* output = malloc(WRITE_CHUNK + RADIX_MAX_DIGITS + 16);
+    size_t length = 0;
+    size_t next = 0;
+    size_t total = (size_t)-1;
+    int firstFailure = 0;
+
+    while (next != total) {
+        Batch* batch = ringPop(&pipeline->done);
+        if (batch->count < 0) {
+            total = batch->sequence;
+            ringPush(&pipeline->free, batch);
+            continue;
+        }
+        pending[batch->sequence % pool] = batch;
+
+        while ((batch = pending[next % pool]) != NULL && batch->sequence == next) {
+            for (int i = 0; pipeline->reduction == NULL && i < batch->count; i++) {
+                if (batch->statuses[i] == 0) {
+                    length += formatRadix(batch->results[i], batch->bases[i], output + length);
+                    if (batch->overflowed[i]) {
+                        length += sprintf(output + length, " overflow");
+                        if (firstFailure == 0) {
+                            firstFailure = FAIL_OVERFLOW;
+                        }
+                    }
+                    output[length++] = '\n';
+                } else {
+                    length += sprintf(output + length, "error %d\n", batch->statuses[i]);
+                    if (firstFailure == 0) {
+                        firstFailure = batch->statuses[i];
+                    }
+                }
+                if (length >= WRITE_CHUNK) {
+                    flushOutput(output, &length);
+                }
+            }
+            pending[next % pool] = NULL;
+            next++;
+            ringPush(&pipeline->free, batch);
+        }
+    }
+    flushOutput(output, &length);
+    free(output);
+    free(pending);
+    return firstFailure;
+}
+
+/**
+ * Evaluates every non-blank line of standard input and prints one line per expression, in input order,
+ * or folds them all into a reduction and prints nothing.
+ * @param evaluate evaluates a single line; must be safe to call from several threads on different contexts
+ * @param settings the context each evaluator thread copies its settings from
+ * @param threads number of evaluator threads, or 0 for the number of processors less two (at least 1)
+ * @param reduction an initialized reduction to fold every line into, or NULL to print them
+ * @return the exit status of the first failed line, or 0 (always 0 with a reduction, which records it instead)
+ */
+int runPipeline(LineEvaluator evaluate, const EvalContext* settings, int threads, Reduction* reduction)
+{
+    if (threads <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors > 3 ? (int)processors - 2 : 1;
+    }
+    Pipeline pipeline = { .evaluate = evaluate, .settings = settings, .threads = threads, .reduction = reduction };
+    pthread_mutex_init(&pipeline.lock, NULL);
+
+    // Every batch, stop signal and the end marker must fit in any ring at once
+    int pool = 2 * threads + 4;
+    size_t capacity = 2;
+    while (capacity < (size_t)(pool + threads + 1)) {
+        capacity *= 2;
+    }
+    Batch* batches = malloc(pool * sizeof(Batch));
+    if (batches == NULL || ringInit(&pipeline.free, capacity) != 0 || ringInit(&pipeline.filled, capacity) != 0
+        || ringInit(&pipeline.done, capacity) != 0) {
+        fprintf(stderr, "Error: Cannot set up the pipeline.\n");
+        return FAIL_INPUT;
+    }
+    for (int i = 0; i < pool; i++) {
+        ringPush(&pipeline.free, &batches[i]);
+    }
+
+    pthread_t reader;
+    pthread_t* evaluators = malloc(threads * sizeof(pthread_t));
+    pthread_create(&reader, NULL, readerStage, &pipeline);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&evaluators[i], NULL, evaluatorStage, &pipeline);
+    }
+
+    int status = writerStage(&pipeline, pool);
+
+    pthread_join(reader, NULL);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(evaluators[i], NULL);
+    }
+    free(evaluators);
+    ringDestroy(&pipeline.free);
+    ringDestroy(&pipeline.filled);
+    ringDestroy(&pipeline.done);
+    pthread_mutex_destroy(&pipeline.lock);
+    free(batches);
+    return status;
+}
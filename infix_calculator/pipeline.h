@@ -0,0 +1,19 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "context.h"
+#include "reduce.h"
+
+/** Most lines carried by one batch. */
+#define BATCH_LINES 512
+
+/** Bytes of line text carried by one batch. */
+#define BATCH_BYTES 65536
+
+/** Evaluates one line in place; returns 0 or the exit status, and on success sets the value and the context's base. */
+typedef int (*LineEvaluator)(EvalContext* context, char* line, long* result);
+
+/** Function to evaluate every line of standard input with reader, evaluator and writer stages, printing or reducing the results*/
+int runPipeline(LineEvaluator evaluate, const EvalContext* settings, int threads, Reduction* reduction);
+
+#endif /*PIPELINE_H*/
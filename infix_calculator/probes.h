@@ -0,0 +1,35 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/*
+ * USDT static tracepoints, provider "infix", for perf and bpftrace, e.g.
+ *     bpftrace -e 'usdt:./infix_10:infix:error { @[arg0] = count(); }'
+ * With systemtap's <sys/sdt.h> each probe is a single nop plus a note in the ELF file, so it costs nothing
+ * until a tracer attaches. Without the header, or with -DINFIX_NO_PROBES, the probes compile to nothing.
+ *
+ * read(length)                   a line reaches the evaluator, from any line mode
+ * tokenize(length, base)         infix_32 and infix_n converted the literals to base 10; infix_10 tokenizes and
+ *                                validates in the same scan, so it only fires validate
+ * validate(base)                 the expression passed the character and operator checks
+ * evaluate__start(base)          parse_exp starts evaluating
+ * evaluate__end(result, length)  parse_exp returns the value of an expression of that compacted length
+ * error(status, base)            fail() ends an evaluation: applyOp's overflow, division by zero or negative
+ *                                exponent, or invalid input
+ * output(result, base)           a result is printed
+ */
+#if !defined(INFIX_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define INFIX_PROBES 1
+#endif
+#endif
+
+#ifdef INFIX_PROBES
+#define PROBE1(name, a) STAP_PROBE1(infix, name, a)
+#define PROBE2(name, a, b) STAP_PROBE2(infix, name, a, b)
+#else
+#define PROBE1(name, a) ((void)0)
+#define PROBE2(name, a, b) ((void)0)
+#endif
+
+#endif /*PROBES_H*/
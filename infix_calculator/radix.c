@@ -0,0 +1,438 @@
+/** 
+ * @file radix.c
+ * @author Jason Wang
+ * This program parses and formats literals in bases 2 to 32. Power-of-two bases (2, 4, 8, 16, 32) never multiply
+ * or divide: digits are packed and unpacked with shifts and masks, eight at a time with BMI2 pext/pdep when the
+ * CPU has it, and overflow is decided from the bit length of the literal.
+ * Every base from 2 to 32 gets its own parse and format kernel, stamped out by the macros at the bottom of this
+ * file, so the base is a compile-time constant in each one: division by it becomes a multiply by its reciprocal,
+ * digits are looked up in a table built for that base, and the first safeDigits digits skip the overflow checks.
+*/
+#include "radix.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "operation.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define RADIX_BMI2 1
+#endif
+
+/** Largest literal magnitude: LONG_MAX + 1, which is only representable when the literal is negated. */
+#define LITERAL_LIMIT ((unsigned long)LONG_MAX + 1)
+
+/** The byte 0x01 repeated in every byte of a word. */
+#define ONES 0x0101010101010101ULL
+
+/** Digit characters by value. */
+static const char DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/**
+ * Value of a digit character.
+ * @param c a character in '0'-'9' or 'A'-'Z'
+ * @return its value, 0 to 35
+ */
+static inline int digitValue(char c)
+{
+    return c <= '9' ? c - '0' : c - 'A' + 10;
+}
+
+/**
+ * Convert 8 digit characters to their values, one per byte, without branches: letters have bit 6 set
+ * and sit 7 above where they would be if they followed '9'.
+ * @param chars 8 characters in '0'-'9' or 'A'-'Z'
+ * @return their values
+ */
+static inline uint64_t eightDigitValues(uint64_t chars)
+{
+    uint64_t letters = (chars >> 6) & ONES;
+    return chars - 0x30 * ONES - 7 * letters;
+}
+
+/**
+ * Check that all 8 digit values are below the base. Adding 0x80 - base sets a byte's top bit exactly when it is too big.
+ * @param values 8 digit values from eightDigitValues
+ * @param base the base
+ * @return true if every value is a digit of the base
+ */
+static inline bool eightBelow(uint64_t values, int base)
+{
+    return ((values + (0x80 - base) * ONES) & 0x80 * ONES) == 0;
+}
+
+/**
+ * Turn 8 digit values back into characters, the inverse of eightDigitValues.
+ * @param values 8 digit values, each below 36
+ * @return the 8 characters
+ */
+static inline uint64_t eightDigitChars(uint64_t values)
+{
+    uint64_t letters = ((values + (0x80 - 10) * ONES) & 0x80 * ONES) >> 7;
+    return values + 0x30 * ONES + 7 * letters;
+}
+
+/**
+ * Load 8 characters with the first one in the highest byte, so it lands in the most significant bits.
+ * @param p the characters
+ * @return the 8 bytes
+ */
+static inline uint64_t loadEightBigEndian(const char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/**
+ * Store 8 characters held with the first one in the highest byte.
+ * @param p where to store them
+ * @param v the 8 bytes
+ */
+static inline void storeEightBigEndian(char* p, uint64_t v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    memcpy(p, &v, sizeof(v));
+}
+
+/**
+ * Pack digit values of a power-of-two base with shifts and ors.
+ * @param digits the digit characters
+ * @param length how many there are
+ * @param shift log2 of the base
+ * @param valid set to false if any digit is not below the base
+ * @return the low 64 bits of the packed value
+ */
+static uint64_t packShift(const char* digits, int length, int shift, bool* valid)
+{
+    uint64_t value = 0;
+    int base = 1 << shift;
+    for (int i = 0; i < length; i++) {
+        int digit = digitValue(digits[i]);
+        *valid &= digit < base;
+        value = (value << shift) | digit;
+    }
+    return value;
+}
+
+#ifdef RADIX_BMI2
+/**
+ * Pack digit values of a power-of-two base eight at a time: pext gathers the low shift bits of every byte.
+ * @param digits the digit characters
+ * @param length how many there are
+ * @param shift log2 of the base
+ * @param valid set to false if any digit is not below the base
+ * @return the low 64 bits of the packed value
+ */
+__attribute__((target("bmi2")))
+static uint64_t packPext(const char* digits, int length, int shift, bool* valid)
+{
+    int base = 1 << shift;
+    uint64_t mask = (base - 1) * ONES;
+    uint64_t value = 0;
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t values = eightDigitValues(loadEightBigEndian(digits + i));
+        *valid &= eightBelow(values, base);
+        // A shift of 8 * shift is at most 40 bits, so it is always defined
+        value = (value << (8 * shift)) | _pext_u64(values, mask);
+    }
+    uint64_t rest = packShift(digits + i, length - i, shift, valid);
+    return (value << ((length - i) * shift)) | rest;
+}
+#endif
+
+/**
+ * Parse a literal in base 2^shift. Its bit length is known from the digit count and the first non-zero digit,
+ * so overflow is decided without looking at the packed value except for the single 64-bit case.
+ * @param digits the digit characters
+ * @param length how many there are
+ * @param shift log2 of the base
+ * @param value set to the parsed magnitude
+ * @return 0, FAIL_INPUT or FAIL_OVERFLOW
+ */
+static inline int parsePowerOfTwo(const char* digits, int length, int shift, unsigned long* value)
+{
+    // Leading zeros carry no bits
+    int start = 0;
+    while (start < length - 1 && digits[start] == '0') {
+        start++;
+    }
+    bool valid = true;
+    uint64_t packed;
+#ifdef RADIX_BMI2
+    if (__builtin_cpu_supports("bmi2")) {
+        packed = packPext(digits + start, length - start, shift, &valid);
+    } else
+#endif
+    {
+        packed = packShift(digits + start, length - start, shift, &valid);
+    }
+    if (!valid) {
+        return FAIL_INPUT;
+    }
+    int first = digitValue(digits[start]);
+    long bits = (long)(length - start - 1) * shift + (first ? 32 - __builtin_clz(first) : 0);
+    if (bits > 64 || packed > LITERAL_LIMIT) {
+        return FAIL_OVERFLOW;
+    }
+    *value = packed;
+    return 0;
+}
+
+/**
+ * Unpack a magnitude in base 2^shift, least significant digit first, with shifts and masks.
+ * @param magnitude the value
+ * @param shift log2 of the base
+ * @param end one past the last character to write; digits are written backwards
+ * @return pointer to the first digit written
+ */
+static char* unpackShift(unsigned long magnitude, int shift, char* end)
+{
+    unsigned long mask = (1UL << shift) - 1;
+    do {
+        *--end = DIGITS[magnitude & mask];
+        magnitude >>= shift;
+    } while (magnitude);
+    return end;
+}
+
+#ifdef RADIX_BMI2
+/**
+ * Unpack a magnitude in base 2^shift eight digits at a time: pdep spreads 8 * shift bits into one digit per byte.
+ * @param magnitude the value
+ * @param shift log2 of the base
+ * @param end one past the last character to write; digits are written backwards
+ * @return pointer to the first digit written
+ */
+__attribute__((target("bmi2")))
+static char* unpackPdep(unsigned long magnitude, int shift, char* end)
+{
+    uint64_t mask = ((1ULL << shift) - 1) * ONES;
+    int groupBits = 8 * shift;
+    while (groupBits < 64 && magnitude >> groupBits) {
+        uint64_t group = magnitude & ((1ULL << groupBits) - 1);
+        end -= 8;
+        storeEightBigEndian(end, eightDigitChars(_pdep_u64(group, mask)));
+        magnitude >>= groupBits;
+    }
+    return unpackShift(magnitude, shift, end);
+}
+#endif
+
+/**
+ * Unpack a magnitude in base 2^shift, using pdep when the CPU has BMI2.
+ * @param magnitude the value
+ * @param shift log2 of the base
+ * @param end one past the last character to write; digits are written backwards
+ * @return pointer to the first digit written
+ */
+static inline char* unpackPowerOfTwo(unsigned long magnitude, int shift, char* end)
+{
+#ifdef RADIX_BMI2
+    if (__builtin_cpu_supports("bmi2")) {
+        return unpackPdep(magnitude, shift, end);
+    }
+#endif
+    return unpackShift(magnitude, shift, end);
+}
+
+/**
+ * Body of the parse kernel for a base that is not a power of two. Always inlined into a kernel, where base,
+ * table and safeDigits are constants.
+ * @param digits the digit characters
+ * @param length how many there are
+ * @param value set to the parsed magnitude
+ * @param base the base
+ * @param table digit value plus one by character, 0 for characters that are not digits of the base
+ * @param safeDigits how many digits can never exceed LONG_MAX + 1
+ * @return 0, FAIL_INPUT or FAIL_OVERFLOW
+ */
+static inline __attribute__((always_inline))
+int parseKernel(const char* digits, int length, unsigned long* value, const int base, const unsigned char* table, const int safeDigits)
+{
+    unsigned long result = 0;
+    bool invalid = false;
+    bool overflow = false;
+    int fast = length < safeDigits ? length : safeDigits;
+    int i = 0;
+
+    for (; i < fast; i++) {
+        unsigned entry = table[(unsigned char)digits[i]];
+        invalid |= entry == 0;
+        result = result * base + entry - 1;
+    }
+    for (; i < length; i++) {
+        unsigned entry = table[(unsigned char)digits[i]];
+        invalid |= entry == 0;
+        overflow = overflow || __builtin_mul_overflow(result, (unsigned long)base, &result)
+                            || __builtin_add_overflow(result, (unsigned long)(entry - 1), &result)
+                            || result > LITERAL_LIMIT;
+    }
+    if (invalid) {
+        return FAIL_INPUT;
+    }
+    if (overflow) {
+        return FAIL_OVERFLOW;
+    }
+    *value = result;
+    return 0;
+}
+
+/**
+ * Body of the format kernel for a base that is not a power of two. Always inlined into a kernel, where the
+ * base is a constant and % and / compile to multiplications.
+ * @param magnitude the value
+ * @param end one past the last character to write; digits are written backwards
+ * @param base the base
+ * @return pointer to the first digit written
+ */
+static inline __attribute__((always_inline))
+char* formatKernel(unsigned long magnitude, char* end, const int base)
+{
+    do {
+        *--end = DIGITS[magnitude % base];
+        magnitude /= base;
+    } while (magnitude);
+    return end;
+}
+
+/** Table entry for one digit character: its value plus one if it is a digit of the base, otherwise 0. */
+#define DIGIT_ENTRY(c, d, B) [c] = (d) < (B) ? (d) + 1 : 0
+
+/** Digit lookup table for base B. */
+#define DIGIT_TABLE(B) { \
+    DIGIT_ENTRY('0', 0, B), DIGIT_ENTRY('1', 1, B), DIGIT_ENTRY('2', 2, B), DIGIT_ENTRY('3', 3, B), \
+    DIGIT_ENTRY('4', 4, B), DIGIT_ENTRY('5', 5, B), DIGIT_ENTRY('6', 6, B), DIGIT_ENTRY('7', 7, B), \
+    DIGIT_ENTRY('8', 8, B), DIGIT_ENTRY('9', 9, B), DIGIT_ENTRY('A', 10, B), DIGIT_ENTRY('B', 11, B), \
+    DIGIT_ENTRY('C', 12, B), DIGIT_ENTRY('D', 13, B), DIGIT_ENTRY('E', 14, B), DIGIT_ENTRY('F', 15, B), \
+    DIGIT_ENTRY('G', 16, B), DIGIT_ENTRY('H', 17, B), DIGIT_ENTRY('I', 18, B), DIGIT_ENTRY('J', 19, B), \
+    DIGIT_ENTRY('K', 20, B), DIGIT_ENTRY('L', 21, B), DIGIT_ENTRY('M', 22, B), DIGIT_ENTRY('N', 23, B), \
+    DIGIT_ENTRY('O', 24, B), DIGIT_ENTRY('P', 25, B), DIGIT_ENTRY('Q', 26, B), DIGIT_ENTRY('R', 27, B), \
+    DIGIT_ENTRY('S', 28, B), DIGIT_ENTRY('T', 29, B), DIGIT_ENTRY('U', 30, B), DIGIT_ENTRY('V', 31, B), \
+    DIGIT_ENTRY('W', 32, B), DIGIT_ENTRY('X', 33, B), DIGIT_ENTRY('Y', 34, B), DIGIT_ENTRY('Z', 35, B) }
+
+/** Defines the kernels for base B, which is not a power of two. */
+#define DEFINE_KERNEL(B, SAFE) \
+    static const unsigned char DIGIT_TABLE_##B[UCHAR_MAX + 1] = DIGIT_TABLE(B); \
+    static int parse##B(const char* digits, int length, unsigned long* value) \
+    { \
+        return parseKernel(digits, length, value, B, DIGIT_TABLE_##B, SAFE); \
+    } \
+    static char* format##B(unsigned long magnitude, char* end) \
+    { \
+        return formatKernel(magnitude, end, B); \
+    }
+
+/** Defines the kernels for base B = 2^SHIFT. */
+#define DEFINE_SHIFT_KERNEL(B, SHIFT, SAFE) \
+    static int parse##B(const char* digits, int length, unsigned long* value) \
+    { \
+        return parsePowerOfTwo(digits, length, SHIFT, value); \
+    } \
+    static char* format##B(unsigned long magnitude, char* end) \
+    { \
+        return unpackPowerOfTwo(magnitude, SHIFT, end); \
+    }
+
+/** Dispatch table entry for base B. */
+#define KERNEL_ENTRY(B, SAFE) [B] = { B, SAFE, parse##B, format##B },
+#define SHIFT_KERNEL_ENTRY(B, SHIFT, SAFE) KERNEL_ENTRY(B, SAFE)
+
+/**
+ * Every supported base with its safe digit count, the largest n for which B^n - 1 <= LONG_MAX + 1.
+ * Power-of-two bases also carry log2 of the base.
+ */
+#define FOR_EACH_BASE(GENERIC, SHIFT) \
+    SHIFT(2, 1, 63)   GENERIC(3, 39)    SHIFT(4, 2, 31)   GENERIC(5, 27)    GENERIC(6, 24)    GENERIC(7, 22) \
+    SHIFT(8, 3, 21)   GENERIC(9, 19)    GENERIC(10, 18)   GENERIC(11, 18)   GENERIC(12, 17)   GENERIC(13, 17) \
+    GENERIC(14, 16)   GENERIC(15, 16)   SHIFT(16, 4, 15)  GENERIC(17, 15)   GENERIC(18, 15)   GENERIC(19, 14) \
+    GENERIC(20, 14)   GENERIC(21, 14)   GENERIC(22, 14)   GENERIC(23, 13)   GENERIC(24, 13)   GENERIC(25, 13) \
+    GENERIC(26, 13)   GENERIC(27, 13)   GENERIC(28, 13)   GENERIC(29, 12)   GENERIC(30, 12)   GENERIC(31, 12) \
+    SHIFT(32, 5, 12)
+
+FOR_EACH_BASE(DEFINE_KERNEL, DEFINE_SHIFT_KERNEL)
+
+/** The kernels, indexed by base. */
+static const RadixKernel KERNELS[RADIX_MAX_BASE + 1] = {
+    FOR_EACH_BASE(KERNEL_ENTRY, SHIFT_KERNEL_ENTRY)
+};
+
+/**
+ * Selects the kernel for a base. Callers look it up once per expression and call through it for every literal.
+ * @param base the base
+ * @return the kernel, or NULL if the base is not between 2 and 32
+ */
+const RadixKernel* radixKernel(int base)
+{
+    if (base < 2 || base > RADIX_MAX_BASE) {
+        return NULL;
+    }
+    return &KERNELS[base];
+}
+
+/**
+ * Parses an unsigned literal. The magnitude may be LONG_MAX + 1 so a negated literal can reach LONG_MIN.
+ * @param digits the digit characters, each '0'-'9' or 'A'-'Z'
+ * @param length how many there are, at least 1
+ * @param base the base
+ * @param value set to the parsed magnitude on success
+ * @return 0, FAIL_INPUT if a digit is not valid in the base or the base has no kernel, or FAIL_OVERFLOW if it is too big
+ */
+int parseRadixLiteral(const char* digits, int length, int base, unsigned long* value)
+{
+    const RadixKernel* kernel = radixKernel(base);
+    if (kernel == NULL) {
+        return FAIL_INPUT;
+    }
+    return kernel->parse(digits, length, value);
+}
+
+/**
+ * Formats a value with a kernel as a null-terminated string, with a leading '-' when negative.
+ * LONG_MIN is formatted exactly since the magnitude is taken as unsigned.
+ * @param val the value to format
+ * @param kernel the kernel of the base
+ * @param out buffer of at least RADIX_MAX_DIGITS characters
+ * @return the length of the formatted string
+ */
+int formatWithKernel(long val, const RadixKernel* kernel, char* out)
+{
+    char buffer[RADIX_MAX_DIGITS];
+    char* end = buffer + sizeof(buffer);
+    unsigned long magnitude = val < 0 ? -(unsigned long)val : (unsigned long)val;
+    char* start = kernel->format(magnitude, end);
+
+    int length = 0;
+    if (val < 0) {
+        out[length++] = '-';
+    }
+    memcpy(out + length, start, end - start);
+    length += end - start;
+    out[length] = '\0';
+    return length;
+}
+
+/**
+ * Formats a value in the given base as a null-terminated string, with a leading '-' when negative.
+ * @param val the value to format
+ * @param base the base, 2 to 32
+ * @param out buffer of at least RADIX_MAX_DIGITS characters
+ * @return the length of the formatted string, or -1 if the base is not supported
+ */
+int formatRadix(long val, int base, char* out)
+{
+    const RadixKernel* kernel = radixKernel(base);
+    if (kernel == NULL) {
+        return -1;
+    }
+    return formatWithKernel(val, kernel, out);
+}
@@ -0,0 +1,28 @@
+#ifndef RADIX_H
+#define RADIX_H
+
+/** Room for the longest formatted value: 64 binary digits, a sign and the terminator. */
+#define RADIX_MAX_DIGITS 66
+
+/** Largest base with a parse/format kernel; digits past 'V' are never printed. */
+#define RADIX_MAX_BASE 32
+
+/** Parse and format kernels specialized for one base. */
+typedef struct {
+    int base;
+    /** Literals with at most this many digits can never overflow, so they skip the checks */
+    int safeDigits;
+    int (*parse)(const char* digits, int length, unsigned long* value);
+    char* (*format)(unsigned long magnitude, char* end);
+} RadixKernel;
+
+/** Function to select the kernel for a base*/
+const RadixKernel* radixKernel(int base);
+/** Function to parse an unsigned literal of base digits, using shifts for power-of-two bases*/
+int parseRadixLiteral(const char* digits, int length, int base, unsigned long* value);
+/** Function to format a value with a base's kernel*/
+int formatWithKernel(long val, const RadixKernel* kernel, char* out);
+/** Function to format a value in a base, using shifts for power-of-two bases*/
+int formatRadix(long val, int base, char* out);
+
+#endif /*RADIX_H*/
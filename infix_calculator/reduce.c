@@ -0,0 +1,219 @@
+/** 
+ * @file reduce.c
+ * @author Jason Wang
+ * This program folds the results of many lines into one aggregate for --reduce, so that a sum, a minimum, a maximum,
+ * a count or a histogram of a batch is printed instead of every result. Each evaluator thread folds the lines it
+ * evaluates into a Reduction of its own and the pipeline merges them at the end, so nothing is formatted per line.
+ * The sum is kept in 128 bits, which no run of fewer than 2^64 lines can overflow, and is checked all the same.
+*/
+#include "reduce.h"
+
+#include <string.h>
+#include <limits.h>
+
+#include "radix.h"
+#include "operation.h"
+
+/** Names of the reductions, indexed by kind. */
+static const char* const REDUCE_NAMES[] = { "sum", "min", "max", "count", "histogram" };
+
+/**
+ * Looks up a reduction by the name given to --reduce.
+ * @param name the name
+ * @return REDUCE_SUM to REDUCE_HISTOGRAM, or -1 if there is no such reduction
+ */
+int reduceKindNamed(const char* name)
+{
+    for (int kind = 0; kind < (int)(sizeof(REDUCE_NAMES) / sizeof(REDUCE_NAMES[0])); kind++) {
+        if (strcmp(name, REDUCE_NAMES[kind]) == 0) {
+            return kind;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Starts an empty reduction.
+ * @param reduction the reduction
+ * @param kind REDUCE_SUM to REDUCE_HISTOGRAM
+ */
+void reduceInit(Reduction* reduction, int kind)
+{
+    memset(reduction, 0, sizeof(Reduction));
+    reduction->kind = kind;
+    reduction->min = LONG_MAX;
+    reduction->max = LONG_MIN;
+    reduction->firstFailure = UINT64_MAX;
+}
+
+/**
+ * Histogram bucket of a value: 64 for 0, 64 + its bit length if positive, 64 less the bit length of its magnitude if negative.
+ * @param value the value
+ * @return the bucket, 0 to REDUCE_BUCKETS - 1
+ */
+static inline int bucketOf(long value)
+{
+    if (value == 0) {
+        return 64;
+    }
+    unsigned long magnitude = value < 0 ? 0 - (unsigned long)value : (unsigned long)value;
+    int bits = 64 - __builtin_clzl(magnitude);
+    return value < 0 ? 64 - bits : 64 + bits;
+}
+
+/**
+ * Remembers a failure if it comes before every failure seen so far.
+ * @param reduction the reduction
+ * @param position the line's position
+ * @param status its exit status
+ */
+static void noteFailure(Reduction* reduction, uint64_t position, int status)
+{
+    if (position < reduction->firstFailure) {
+        reduction->firstFailure = position;
+        reduction->firstFailureStatus = status;
+    }
+}
+
+/**
+ * Folds one line into a reduction. A value flagged as overflowed by wrap or saturate is folded, and counted with status 100.
+ * @param reduction the reduction
+ * @param position where the line is in the input, to find the first failure
+ * @param status 0 or the line's exit status
+ * @param value the line's value, if the status is 0
+ * @param base the base of the value
+ * @param overflowed whether the value overflowed under a policy that keeps going
+ */
+void reduceAdd(Reduction* reduction, uint64_t position, int status, long value, int base, bool overflowed)
+{
+    if (status != 0) {
+        reduction->statuses[status >= FAIL_OVERFLOW && status <= FAIL_LIMIT ? status - FAIL_OVERFLOW + 1 : 0]++;
+        noteFailure(reduction, position, status);
+        return;
+    }
+    if (overflowed) {
+        reduction->statuses[1]++;
+        noteFailure(reduction, position, FAIL_OVERFLOW);
+    } else {
+        reduction->statuses[0]++;
+    }
+    reduction->count++;
+    reduction->sumOverflowed |= __builtin_add_overflow(reduction->sum, (__int128)value, &reduction->sum);
+    reduction->min = value < reduction->min ? value : reduction->min;
+    reduction->max = value > reduction->max ? value : reduction->max;
+    reduction->buckets[bucketOf(value)]++;
+    reduction->base = reduction->base == 0 || reduction->base == base ? base : -1;
+}
+
+/**
+ * Folds one reduction into another.
+ * @param into the reduction that receives the other
+ * @param from the reduction folded in
+ */
+void reduceMerge(Reduction* into, const Reduction* from)
+{
+    into->sumOverflowed |= from->sumOverflowed | __builtin_add_overflow(into->sum, from->sum, &into->sum);
+    into->min = from->min < into->min ? from->min : into->min;
+    into->max = from->max > into->max ? from->max : into->max;
+    into->count += from->count;
+    for (int i = 0; i < REDUCE_BUCKETS; i++) {
+        into->buckets[i] += from->buckets[i];
+    }
+    for (int i = 0; i < REDUCE_STATUSES; i++) {
+        into->statuses[i] += from->statuses[i];
+    }
+    if (from->base != 0) {
+        into->base = into->base == 0 || into->base == from->base ? from->base : -1;
+    }
+    if (from->firstFailure != UINT64_MAX) {
+        noteFailure(into, from->firstFailure, from->firstFailureStatus);
+    }
+}
+
+/**
+ * Formats a 128-bit value in a base.
+ * @param value the value
+ * @param base the base, 2 to 32
+ * @param out room for 130 characters
+ */
+static void formatWide(__int128 value, int base, char* out)
+{
+    unsigned __int128 magnitude = value < 0 ? 0 - (unsigned __int128)value : (unsigned __int128)value;
+    char digits[130];
+    int count = 0;
+    do {
+        digits[count++] = "0123456789ABCDEFGHIJKLMNOPQRSTUV"[magnitude % base];
+        magnitude /= base;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *out++ = '-';
+    }
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    *out = '\0';
+}
+
+/**
+ * Prints a reduction in the base of its values (base 10 if lines in different bases were folded together),
+ * followed by one "status S N" line for each exit status that occurred, 0 included.
+ * @param reduction the reduction
+ * @param out where to print it
+ * @return the exit status of the first line that failed or overflowed, or 0
+ */
+int reducePrint(const Reduction* reduction, FILE* out)
+{
+    int base = reduction->base > 0 ? reduction->base : 10;
+    char first[RADIX_MAX_DIGITS];
+    char second[RADIX_MAX_DIGITS];
+    char wide[130];
+    switch (reduction->kind) {
+    case REDUCE_SUM:
+        formatWide(reduction->sum, base, wide);
+        fprintf(out, "sum %s\n", reduction->sumOverflowed ? "overflow" : wide);
+        break;
+    case REDUCE_MIN:
+    case REDUCE_MAX:
+        if (reduction->count == 0) {
+            fprintf(out, "%s none\n", REDUCE_NAMES[reduction->kind]);
+        } else {
+            formatRadix(reduction->kind == REDUCE_MIN ? reduction->min : reduction->max, base, first);
+            fprintf(out, "%s %s\n", REDUCE_NAMES[reduction->kind], first);
+        }
+        break;
+    case REDUCE_COUNT:
+        fprintf(out, "count %lu\n", (unsigned long)reduction->count);
+        break;
+    case REDUCE_HISTOGRAM:
+        // Each bucket prints its lowest and highest value and how many results fell in it
+        for (int i = 0; i < REDUCE_BUCKETS; i++) {
+            if (reduction->buckets[i] == 0) {
+                continue;
+            }
+            long low = 0;
+            long high = 0;
+            if (i > 64) {
+                int bits = i - 64;
+                low = 1L << (bits - 1);
+                high = (long)((1UL << bits) - 1);
+            } else if (i < 64) {
+                int bits = 64 - i;
+                low = (long)(0 - (bits == 64 ? 1UL << 63 : (1UL << bits) - 1));
+                high = (long)(0 - (1UL << (bits - 1)));
+            }
+            formatRadix(low, base, first);
+            formatRadix(high, base, second);
+            fprintf(out, "histogram %s %s %lu\n", first, second, (unsigned long)reduction->buckets[i]);
+        }
+        break;
+    }
+    for (int i = 0; i < REDUCE_STATUSES; i++) {
+        if (reduction->statuses[i] != 0) {
+            fprintf(out, "status %d %lu\n", i == 0 ? 0 : FAIL_OVERFLOW + i - 1, (unsigned long)reduction->statuses[i]);
+        }
+    }
+    if (reduction->kind == REDUCE_SUM && reduction->sumOverflowed) {
+        return FAIL_OVERFLOW;
+    }
+    return reduction->firstFailure == UINT64_MAX ? 0 : reduction->firstFailureStatus;
+}
@@ -0,0 +1,57 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** --reduce sum: the sum of the results, in 128 bits */
+#define REDUCE_SUM 0
+/** --reduce min: the smallest result */
+#define REDUCE_MIN 1
+/** --reduce max: the largest result */
+#define REDUCE_MAX 2
+/** --reduce count: the number of results */
+#define REDUCE_COUNT 3
+/** --reduce histogram: the results counted by sign and bit length */
+#define REDUCE_HISTOGRAM 4
+
+/** Histogram buckets: 0, and each sign with bit lengths 1 to 64 (64 only holds LONG_MIN). */
+#define REDUCE_BUCKETS 129
+
+/** Exit statuses counted separately: 0 and 100 to 104. */
+#define REDUCE_STATUSES 6
+
+/** Results folded together; folding is order-free, so each thread keeps one and they are merged at the end. */
+typedef struct {
+    int kind;
+    __int128 sum;
+    /** Set when the sum left 128 bits */
+    bool sumOverflowed;
+    long min;
+    long max;
+    /** Lines that produced a value, flagged as overflowed or not */
+    uint64_t count;
+    uint64_t buckets[REDUCE_BUCKETS];
+    /** Lines by exit status: index 0 for success, status - 99 for the failures */
+    uint64_t statuses[REDUCE_STATUSES];
+    /** Base of the values, 0 before the first and -1 once lines in different bases were seen */
+    int base;
+    /** Position of the first failed line, to report the same exit status as the pipeline */
+    uint64_t firstFailure;
+    int firstFailureStatus;
+} Reduction;
+
+/** Function to look up a reduction by name, -1 if unknown*/
+int reduceKindNamed(const char* name);
+/** Function to start an empty reduction*/
+void reduceInit(Reduction* reduction, int kind);
+/** Function to fold one line's result, or its failure, into a reduction*/
+void reduceAdd(Reduction* reduction, uint64_t position, int status, long value, int base, bool overflowed);
+/** Function to fold one reduction into another*/
+void reduceMerge(Reduction* into, const Reduction* from);
+/** Function to print a reduction and the per-status counts, returning the status of the first failed line*/
+int reducePrint(const Reduction* reduction, FILE* out);
+
+#endif /*REDUCE_H*/
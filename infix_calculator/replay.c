@@ -0,0 +1,167 @@
+/**
+ * @file replay.c
+ * @author Jason Wang
+ * This program replays a capture log (see capture.c) through this build's evaluator, with the settings the log
+ * was captured with: at the pace the expressions originally arrived, so queueing and caching behave as they did,
+ * or back to back to measure throughput. Every result is compared with the recorded one, and the latency
+ * percentiles of both runs are printed side by side, so two builds can be compared on a production workload.
+*/
+#include "replay.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture.h"
+#include "operation.h"
+
+/** A percentile printed. */
+typedef struct {
+    const char* name;
+    /** In tenths of a percent, 1000 being the maximum */
+    int permille;
+} Percentile;
+
+/** Percentiles printed. */
+static const Percentile PERCENTILES[] = { { "p50", 500 }, { "p90", 900 }, { "p99", 990 }, { "p99.9", 999 }, { "max", 1000 } };
+
+/**
+ * Sleep until a monotonic clock reading.
+ * @param due the reading, in nanoseconds
+ */
+static void sleepUntil(uint64_t due)
+{
+    struct timespec until = { (time_t)(due / 1000000000), (long)(due % 1000000000) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+    }
+}
+
+/**
+ * Order latencies for qsort.
+ * @param a a latency
+ * @param b another latency
+ * @return negative, 0 or positive as a is below, equal to or above b
+ */
+static int compareLatency(const void* a, const void* b)
+{
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Print how a recorded or replayed expression came out.
+ * @param out the stream
+ * @param status 0 or the exit status
+ * @param result the value, when status is 0
+ * @param base its base
+ * @param overflowed whether a policy that keeps going overflowed
+ */
+static void printOutcome(FILE* out, int status, long result, int base, bool overflowed)
+{
+    if (status != 0) {
+        fprintf(out, "status %d", status);
+    } else {
+        fprintf(out, "%ld (base %d)%s", result, base, overflowed ? " overflowed" : "");
+    }
+}
+
+/**
+ * Print the percentiles of the recorded and replayed latencies and how much they changed. Sorts both.
+ * @param out the stream
+ * @param recorded the recorded latencies
+ * @param replayed the replayed latencies
+ * @param count how many of each, at least 1
+ */
+static void printLatencies(FILE* out, uint64_t* recorded, uint64_t* replayed, size_t count)
+{
+    qsort(recorded, count, sizeof(uint64_t), compareLatency);
+    qsort(replayed, count, sizeof(uint64_t), compareLatency);
+    fprintf(out, "latency   recorded   replayed    change\n");
+    for (size_t i = 0; i < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); i++) {
+        size_t rank = (count - 1) * PERCENTILES[i].permille / 1000;
+        uint64_t before = recorded[rank];
+        uint64_t after = replayed[rank];
+        fprintf(out, "%-7s %8luns %8luns", PERCENTILES[i].name, (unsigned long)before, (unsigned long)after);
+        if (before > 0) {
+            fprintf(out, " %+8.1f%%", 100.0 * ((double)after - (double)before) / (double)before);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+/**
+ * Evaluates every expression of a capture log again, in the order they arrived, and prints the expressions whose
+ * outcome differs, then a summary and the latency percentiles of the recording and the replay.
+ * @param evaluate the line evaluator
+ * @param context the evaluation context, given the settings the log was captured with
+ * @param path the log
+ * @param fast true to evaluate back to back, false to keep the intervals between arrivals
+ * @return 0 if every outcome matched, 1 if any differed, FAIL_INPUT if the log cannot be replayed here
+ */
+int runReplay(LineEvaluator evaluate, EvalContext* context, const char* path, bool fast)
+{
+    CaptureFile file;
+    if (captureLoad(path, &file) != 0) {
+        fprintf(stderr, "Error: %s is not a readable capture log.\n", path);
+        return FAIL_INPUT;
+    }
+    if (captureApplyHeader(context, &file.header) != 0) {
+        fprintf(stderr, "Error: %s was captured by another program.\n", path);
+        captureUnload(&file);
+        return FAIL_INPUT;
+    }
+    uint64_t* recorded = malloc((file.count + 1) * sizeof(uint64_t));
+    uint64_t* replayed = malloc((file.count + 1) * sizeof(uint64_t));
+    char* line = malloc(MAX_SIZE + 1);
+    if (recorded == NULL || replayed == NULL || line == NULL) {
+        free(recorded);
+        free(replayed);
+        free(line);
+        captureUnload(&file);
+        return FAIL_INPUT;
+    }
+
+    size_t differing = 0;
+    uint64_t start = latencyNow();
+    for (size_t i = 0; i < file.count; i++) {
+        const CaptureRecord* record = &file.records[i];
+        if (!fast) {
+            sleepUntil(start + record->arrival);
+        }
+        memcpy(line, record->text, record->length);
+        line[record->length] = '\0';
+        long result = 0;
+        uint64_t before = latencyNow();
+        int status = evaluate(context, line, &result);
+        replayed[i] = latencyNow() - before;
+        recorded[i] = record->nanoseconds;
+
+        bool overflowed = status == 0 && context->overflowed;
+        if (status != record->status
+            || (status == 0 && (result != record->result || context->base != record->base || overflowed != record->overflowed))) {
+            if (differing < REPLAY_SHOWN) {
+                printf("differs: \"%.*s\" recorded ", (int)record->length, record->text);
+                printOutcome(stdout, record->status, record->result, record->base, record->overflowed);
+                printf(", replayed ");
+                printOutcome(stdout, status, result, context->base, overflowed);
+                printf("\n");
+            }
+            differing++;
+        }
+    }
+    uint64_t elapsed = latencyNow() - start;
+
+    printf("%zu expressions replayed %s in %.3fms, %zu differ\n", file.count, fast ? "back to back" : "at the recorded pace",
+           elapsed / 1e6, differing);
+    if (file.count > 0) {
+        printLatencies(stdout, recorded, replayed, file.count);
+    }
+    free(recorded);
+    free(replayed);
+    free(line);
+    captureUnload(&file);
+    return differing > 0 ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "pipeline.h"
+
+/** Differing expressions printed in full; the rest are only counted. */
+#define REPLAY_SHOWN 10
+
+/** Function to evaluate a capture log's expressions again, at their original pace or as fast as possible, and compare*/
+int runReplay(LineEvaluator evaluate, EvalContext* context, const char* path, bool fast);
+
+#endif /*REPLAY_H*/
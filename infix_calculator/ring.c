@@ -0,0 +1,149 @@
+/** 
+ * @file ring.c
+ * @author Jason Wang
+ * This program implements the bounded lock-free ring buffers that link the pipeline stages.
+ * It is Vyukov's bounded MPMC queue: every cell carries a sequence number, so producers and consumers
+ * claim cells with a single compare-and-swap on head or tail and never take a lock.
+*/
+#include "ring.h"
+
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+
+/** Spins with sched_yield before a waiting side starts sleeping. */
+#define RING_SPINS 64
+
+/** How long a waiting side sleeps between attempts once it has spun, in nanoseconds. */
+#define RING_SLEEP_NS 50000
+
+/**
+ * Creates an empty ring.
+ * @param ring the ring
+ * @param capacity how many pointers it holds, a power of two
+ * @return 0, or -1 if the capacity is not a power of two or memory ran out
+ */
+int ringInit(Ring* ring, size_t capacity)
+{
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+    ring->cells = malloc(capacity * sizeof(RingCell));
+    if (ring->cells == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+        ring->cells[i].value = NULL;
+    }
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+/**
+ * Frees a ring. Pointers still in it are not freed.
+ * @param ring the ring
+ */
+void ringDestroy(Ring* ring)
+{
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+/**
+ * Adds a pointer if there is room.
+ * @param ring the ring
+ * @param value the pointer
+ * @return true if it was added, false if the ring is full
+ */
+bool ringTryPush(Ring* ring, void* value)
+{
+    size_t position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;) {
+        RingCell* cell = &ring->cells[position & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->value = value;
+                atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Takes a pointer if there is one.
+ * @param ring the ring
+ * @param value set to the pointer
+ * @return true if one was taken, false if the ring is empty
+ */
+bool ringTryPop(Ring* ring, void** value)
+{
+    size_t position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        RingCell* cell = &ring->cells[position & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *value = cell->value;
+                atomic_store_explicit(&cell->sequence, position + ring->mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Back off while waiting on a ring: yield for a while, then sleep briefly so an idle stage costs no CPU.
+ * @param attempt how many times the caller has waited so far
+ */
+static void ringWait(int attempt)
+{
+    if (attempt < RING_SPINS) {
+        sched_yield();
+    } else {
+        struct timespec pause = { 0, RING_SLEEP_NS };
+        nanosleep(&pause, NULL);
+    }
+}
+
+/**
+ * Adds a pointer, waiting for room.
+ * @param ring the ring
+ * @param value the pointer
+ */
+void ringPush(Ring* ring, void* value)
+{
+    for (int attempt = 0; !ringTryPush(ring, value); attempt++) {
+        ringWait(attempt);
+    }
+}
+
+/**
+ * Takes a pointer, waiting for one.
+ * @param ring the ring
+ * @return the pointer
+ */
+void* ringPop(Ring* ring)
+{
+    void* value;
+    for (int attempt = 0; !ringTryPop(ring, &value); attempt++) {
+        ringWait(attempt);
+    }
+    return value;
+}
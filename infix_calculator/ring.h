@@ -0,0 +1,36 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** One slot of a ring; its sequence number says whose turn it is to use the slot. */
+typedef struct {
+    atomic_size_t sequence;
+    void* value;
+} RingCell;
+
+/** Bounded lock-free queue of pointers, safe for any number of producers and consumers. */
+typedef struct {
+    RingCell* cells;
+    size_t mask;
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+} Ring;
+
+/** Function to create a ring with room for capacity pointers, a power of two*/
+int ringInit(Ring* ring, size_t capacity);
+/** Function to free a ring*/
+void ringDestroy(Ring* ring);
+/** Function to add a pointer if there is room*/
+bool ringTryPush(Ring* ring, void* value);
+/** Function to take a pointer if there is one*/
+bool ringTryPop(Ring* ring, void** value);
+/** Function to add a pointer, waiting for room*/
+void ringPush(Ring* ring, void* value);
+/** Function to take a pointer, waiting for one*/
+void* ringPop(Ring* ring);
+
+#endif /*RING_H*/
@@ -0,0 +1,196 @@
+/**
+ * @file rpn.c
+ * @author Jason Wang
+ * This program evaluates expressions written in postfix (reverse Polish) notation for --rpn: literals and the
+ * operators + - * / ^ separated by whitespace, e.g. "3 4 + 2 *". There are no parentheses, precedences or
+ * operator stack; each literal is pushed on one operand stack and each operator replaces the top two operands.
+ * A line is read in two passes over tokens kept in the arena. The first checks the characters, the literals and
+ * that every operator has two operands and one value is left, so a malformed line fails with FAIL_INPUT before
+ * any arithmetic, as an infix line does. Dividing by a literal 0 fails with FAIL_DIVZERO before any arithmetic too,
+ * as isValid finds "/0" in an infix line. The second pass applies the operators.
+ * Literals follow each program's rules: infix_10 reads them with parseValue as it evaluates, so an overflowing
+ * literal fails where it stands, while infix_32 and infix_n convert them all first and report an overflowing one
+ * only after every digit has been checked, as convertBaseNtoBase10 does.
+*/
+#include "rpn.h"
+
+#include <string.h>
+
+#include "number.h"
+#include "radix.h"
+#include "operation.h"
+#include "probes.h"
+
+/** One token of a postfix expression. */
+typedef struct {
+    /** The literal's value, once converted */
+    long value;
+    /** Index of the literal in the expression, for infix_10 to read it when it is pushed */
+    int position;
+    /** The operator, or 0 for a literal */
+    unsigned char op;
+    /** Whether the token's value is reduced by the modulus; exponents are not, as in infix */
+    bool modular;
+} RpnToken;
+
+/**
+ * Check for the whitespace that separates tokens.
+ * @param c the character
+ * @return true if it is ASCII whitespace
+ */
+static inline bool isSeparator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Check for a character that can be part of a literal: a decimal digit, or for infix_32 and infix_n an
+ * uppercase letter, which the base's kernel then accepts or rejects.
+ * @param c the character
+ * @param letters whether letters are digits
+ * @return true if it can be
+ */
+static inline bool isLiteralChar(char c, bool letters)
+{
+    return (c >= '0' && c <= '9') || (letters && c >= 'A' && c <= 'Z');
+}
+
+/**
+ * Give each token whether its value is reduced by the modulus. Reading backwards, each operator's right operand
+ * ends just before it and its left operand just before that, so a stack of the flags still to hand out suffices.
+ * The right operand of ^ is an ordinary integer, and so is all of it.
+ * @param context the evaluation context, for scratch memory
+ * @param tokens the tokens
+ * @param count how many
+ */
+static void markModular(EvalContext* context, RpnToken* tokens, size_t count)
+{
+    bool* pending = contextAlloc(context, (count + 1) * sizeof(bool));
+    size_t top = 0;
+    pending[top++] = true;
+    for (size_t t = count; t-- > 0;) {
+        bool modular = pending[--top];
+        tokens[t].modular = modular;
+        if (tokens[t].op != 0) {
+            pending[top++] = modular;
+            pending[top++] = modular && tokens[t].op != '^';
+        }
+    }
+}
+
+/**
+ * Evaluates a postfix expression whose literals are in the context's base.
+ * @param context the evaluation context, whose overflow policy and modulus the operators use
+ * @param expression the expression; nothing is modified
+ * @return long value of the expression
+ */
+long evaluateRpn(EvalContext* context, char* expression)
+{
+    size_t length = strlen(expression);
+    bool letters = context->program != PROGRAM_10;
+    const RadixKernel* kernel = letters ? radixKernel(context->base) : NULL;
+    if (letters && kernel == NULL) {
+        fail(context, FAIL_INPUT);
+    }
+
+    // Pass 1: tokens, literal conversion and the operand count, which is also the deepest the stack gets
+    RpnToken* tokens = contextAlloc(context, (length / 2 + 1) * sizeof(RpnToken));
+    size_t count = 0;
+    size_t depth = 0;
+    size_t deepest = 0;
+    bool overflow = false;
+    bool divideByZero = false;
+    bool zeroLiteral = false;
+    int i = 0;
+    for (;;) {
+        while (isSeparator(expression[i])) {
+            i++;
+        }
+        char c = expression[i];
+        if (c == '\0') {
+            break;
+        }
+        RpnToken* token = &tokens[count++];
+        token->op = 0;
+        token->modular = false;
+        if (isLiteralChar(c, letters) || (c == '-' && isLiteralChar(expression[i + 1], letters))) {
+            token->position = i;
+            bool negative = c == '-';
+            int start = i + negative;
+            int end = start;
+            while (isLiteralChar(expression[end], letters)) {
+                end++;
+            }
+            if (letters) {
+                unsigned long magnitude = 0;
+                int status = kernel->parse(expression + start, end - start, &magnitude);
+                if (status == FAIL_INPUT) {
+                    fail(context, FAIL_INPUT);
+                }
+                // The kernel allows LONG_MAX + 1, which only a negative literal can be
+                overflow = overflow || status == FAIL_OVERFLOW || (!negative && magnitude > LONG_MAX);
+                token->value = negative ? (long)(0 - magnitude) : (long)magnitude;
+            }
+            // What isValid would see as "/0": a decimal literal written with a leading 0, or a converted value of 0
+            zeroLiteral = letters ? !negative && token->value == 0 : c == '0';
+            i = end;
+            if (++depth > deepest) {
+                deepest = depth;
+                if (deepest > context->usage.maxDepth) {
+                    limitTooDeep(context);
+                }
+            }
+        } else if (c == '+' || c == '-' || c == '*' || c == '/' || c == '^') {
+            if (depth < 2) {
+                fail(context, FAIL_INPUT);
+            }
+            token->op = c;
+            divideByZero = divideByZero || (c == '/' && count >= 2 && tokens[count - 2].op == 0 && zeroLiteral);
+            depth--;
+            i++;
+        } else {
+            fail(context, FAIL_INPUT);
+        }
+        // Tokens must be separated, so "12+" is not read as "12 +"
+        if (expression[i] != '\0' && !isSeparator(expression[i])) {
+            fail(context, FAIL_INPUT);
+        }
+    }
+    if (depth != 1) {
+        fail(context, FAIL_INPUT);
+    }
+    if (overflow) {
+        fail(context, FAIL_OVERFLOW);
+    }
+    if (divideByZero) {
+        fail(context, FAIL_DIVZERO);
+    }
+    if (letters) {
+        PROBE2(tokenize, count, context->base);
+    }
+    PROBE1(validate, context->base);
+
+    // Pass 2: one operand stack
+    const Modulus* modulus = context->modulus.value != 0 ? &context->modulus : NULL;
+    if (modulus != NULL) {
+        markModular(context, tokens, count);
+    }
+    long* stack = contextAlloc(context, deepest * sizeof(long));
+    size_t top = 0;
+    PROBE1(evaluate__start, context->base);
+    for (size_t t = 0; t < count; t++) {
+        const RpnToken* token = &tokens[t];
+        if (token->op == 0) {
+            long value = letters ? token->value : parseValue(context, expression, &tokens[t].position, (int)length);
+            stack[top++] = token->modular ? modReduce(modulus, value) : value;
+            continue;
+        }
+        limitOperation(context);
+        long rhs = stack[--top];
+        long lhs = stack[top - 1];
+        stack[top - 1] = token->modular ? modApplyOp(context, modulus, lhs, rhs, token->op)
+                                        : context->overflow->ops[token->op](context, lhs, rhs);
+    }
+    PROBE2(evaluate__end, stack[0], (int)length);
+    return stack[0];
+}
@@ -0,0 +1,9 @@
+#ifndef RPN_H
+#define RPN_H
+
+#include "context.h"
+
+/** Function to evaluate a postfix expression in the context's program and base*/
+long evaluateRpn(EvalContext* context, char* expression);
+
+#endif /*RPN_H*/
@@ -0,0 +1,359 @@
+/** 
+ * @file scan.c
+ * @author Jason Wang
+ * This program removes whitespace from an expression and checks its characters in one pass, 16 or 32 bytes at a time.
+ * Every byte is classified with two 16-entry tables: one indexed by its low nibble and one by its high nibble.
+ * The byte belongs to a class when both entries have that class bit set, so a single shuffle per table
+ * classifies a whole vector without any locale-dependent isspace/isdigit calls.
+*/
+#include "scan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+/** \t \n \v \f \r */
+#define CLASS_CONTROL_SPACE 0x01
+/** ' ' */
+#define CLASS_SPACE 0x02
+/** '0'-'9' */
+#define CLASS_DIGIT 0x04
+/** 'A'-'O' */
+#define CLASS_LETTER_LOW 0x08
+/** 'P'-'Z' */
+#define CLASS_LETTER_HIGH 0x10
+/** '*' '+' '/', which may not appear twice in a row */
+#define CLASS_SINGLE 0x20
+/** '(' ')' '-' */
+#define CLASS_OTHER 0x40
+/** '^', which may not appear twice in a row either */
+#define CLASS_CARET 0x80
+
+#define CLASS_WHITESPACE (CLASS_CONTROL_SPACE | CLASS_SPACE)
+#define CLASS_DECIMAL (CLASS_WHITESPACE | CLASS_DIGIT | CLASS_SINGLE | CLASS_OTHER | CLASS_CARET)
+#define CLASS_LETTERS (CLASS_DECIMAL | CLASS_LETTER_LOW | CLASS_LETTER_HIGH)
+
+/** Classes that could contain a byte, by its low nibble. */
+static const uint8_t CLASS_LOW[16] __attribute__((aligned(16))) = {
+    CLASS_SPACE | CLASS_DIGIT | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH,
+    CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH | CLASS_OTHER,
+    CLASS_CONTROL_SPACE | CLASS_DIGIT | CLASS_LETTER_LOW | CLASS_LETTER_HIGH | CLASS_OTHER,
+    CLASS_CONTROL_SPACE | CLASS_LETTER_LOW | CLASS_LETTER_HIGH | CLASS_SINGLE,
+    CLASS_CONTROL_SPACE | CLASS_LETTER_LOW | CLASS_SINGLE,
+    CLASS_CONTROL_SPACE | CLASS_LETTER_LOW,
+    CLASS_CONTROL_SPACE | CLASS_LETTER_LOW | CLASS_OTHER,
+    CLASS_LETTER_LOW | CLASS_CARET,
+    CLASS_LETTER_LOW | CLASS_SINGLE,
+};
+
+/** Classes that could contain a byte, by its high nibble. Bytes 0x80 and up belong to no class. */
+static const uint8_t CLASS_HIGH[16] __attribute__((aligned(16))) = {
+    [0x0] = CLASS_CONTROL_SPACE,
+    [0x2] = CLASS_SPACE | CLASS_SINGLE | CLASS_OTHER,
+    [0x3] = CLASS_DIGIT,
+    [0x4] = CLASS_LETTER_LOW,
+    [0x5] = CLASS_LETTER_HIGH | CLASS_CARET,
+};
+
+/**
+ * Shuffle indices that pack the kept bytes of an 8-byte group to the front, by bitmask of bytes to drop.
+ * Unused slots are 0x80 so a shuffle zeroes them.
+ */
+static const uint64_t COMPACT[256] = {
+    0x0706050403020100ULL, 0x8007060504030201ULL, 0x8007060504030200ULL, 0x8080070605040302ULL,
+    0x8007060504030100ULL, 0x8080070605040301ULL, 0x8080070605040300ULL, 0x8080800706050403ULL,
+    0x8007060504020100ULL, 0x8080070605040201ULL, 0x8080070605040200ULL, 0x8080800706050402ULL,
+    0x8080070605040100ULL, 0x8080800706050401ULL, 0x8080800706050400ULL, 0x8080808007060504ULL,
+    0x8007060503020100ULL, 0x8080070605030201ULL, 0x8080070605030200ULL, 0x8080800706050302ULL,
+    0x8080070605030100ULL, 0x8080800706050301ULL, 0x8080800706050300ULL, 0x8080808007060503ULL,
+    0x8080070605020100ULL, 0x8080800706050201ULL, 0x8080800706050200ULL, 0x8080808007060502ULL,
+    0x8080800706050100ULL, 0x8080808007060501ULL, 0x8080808007060500ULL, 0x8080808080070605ULL,
+    0x8007060403020100ULL, 0x8080070604030201ULL, 0x8080070604030200ULL, 0x8080800706040302ULL,
+    0x8080070604030100ULL, 0x8080800706040301ULL, 0x8080800706040300ULL, 0x8080808007060403ULL,
+    0x8080070604020100ULL, 0x8080800706040201ULL, 0x8080800706040200ULL, 0x8080808007060402ULL,
+    0x8080800706040100ULL, 0x8080808007060401ULL, 0x8080808007060400ULL, 0x8080808080070604ULL,
+    0x8080070603020100ULL, 0x8080800706030201ULL, 0x8080800706030200ULL, 0x8080808007060302ULL,
+    0x8080800706030100ULL, 0x8080808007060301ULL, 0x8080808007060300ULL, 0x8080808080070603ULL,
+    0x8080800706020100ULL, 0x8080808007060201ULL, 0x8080808007060200ULL, 0x8080808080070602ULL,
+    0x8080808007060100ULL, 0x8080808080070601ULL, 0x8080808080070600ULL, 0x8080808080800706ULL,
+    0x8007050403020100ULL, 0x8080070504030201ULL, 0x8080070504030200ULL, 0x8080800705040302ULL,
+    0x8080070504030100ULL, 0x8080800705040301ULL, 0x8080800705040300ULL, 0x8080808007050403ULL,
+    0x8080070504020100ULL, 0x8080800705040201ULL, 0x8080800705040200ULL, 0x8080808007050402ULL,
+    0x8080800705040100ULL, 0x8080808007050401ULL, 0x8080808007050400ULL, 0x8080808080070504ULL,
+    0x8080070503020100ULL, 0x8080800705030201ULL, 0x8080800705030200ULL, 0x8080808007050302ULL,
+    0x8080800705030100ULL, 0x8080808007050301ULL, 0x8080808007050300ULL, 0x8080808080070503ULL,
+    0x8080800705020100ULL, 0x8080808007050201ULL, 0x8080808007050200ULL, 0x8080808080070502ULL,
+    0x8080808007050100ULL, 0x8080808080070501ULL, 0x8080808080070500ULL, 0x8080808080800705ULL,
+    0x8080070403020100ULL, 0x8080800704030201ULL, 0x8080800704030200ULL, 0x8080808007040302ULL,
+    0x8080800704030100ULL, 0x8080808007040301ULL, 0x8080808007040300ULL, 0x8080808080070403ULL,
+    0x8080800704020100ULL, 0x8080808007040201ULL, 0x8080808007040200ULL, 0x8080808080070402ULL,
+    0x8080808007040100ULL, 0x8080808080070401ULL, 0x8080808080070400ULL, 0x8080808080800704ULL,
+    0x8080800703020100ULL, 0x8080808007030201ULL, 0x8080808007030200ULL, 0x8080808080070302ULL,
+    0x8080808007030100ULL, 0x8080808080070301ULL, 0x8080808080070300ULL, 0x8080808080800703ULL,
+    0x8080808007020100ULL, 0x8080808080070201ULL, 0x8080808080070200ULL, 0x8080808080800702ULL,
+    0x8080808080070100ULL, 0x8080808080800701ULL, 0x8080808080800700ULL, 0x8080808080808007ULL,
+    0x8006050403020100ULL, 0x8080060504030201ULL, 0x8080060504030200ULL, 0x8080800605040302ULL,
+    0x8080060504030100ULL, 0x8080800605040301ULL, 0x8080800605040300ULL, 0x8080808006050403ULL,
+    0x8080060504020100ULL, 0x8080800605040201ULL, 0x8080800605040200ULL, 0x8080808006050402ULL,
+    0x8080800605040100ULL, 0x8080808006050401ULL, 0x8080808006050400ULL, 0x8080808080060504ULL,
+    0x8080060503020100ULL, 0x8080800605030201ULL, 0x8080800605030200ULL, 0x8080808006050302ULL,
+    0x8080800605030100ULL, 0x8080808006050301ULL, 0x8080808006050300ULL, 0x8080808080060503ULL,
+    0x8080800605020100ULL, 0x8080808006050201ULL, 0x8080808006050200ULL, 0x8080808080060502ULL,
+    0x8080808006050100ULL, 0x8080808080060501ULL, 0x8080808080060500ULL, 0x8080808080800605ULL,
+    0x8080060403020100ULL, 0x8080800604030201ULL, 0x8080800604030200ULL, 0x8080808006040302ULL,
+    0x8080800604030100ULL, 0x8080808006040301ULL, 0x8080808006040300ULL, 0x8080808080060403ULL,
+    0x8080800604020100ULL, 0x8080808006040201ULL, 0x8080808006040200ULL, 0x8080808080060402ULL,
+    0x8080808006040100ULL, 0x8080808080060401ULL, 0x8080808080060400ULL, 0x8080808080800604ULL,
+    0x8080800603020100ULL, 0x8080808006030201ULL, 0x8080808006030200ULL, 0x8080808080060302ULL,
+    0x8080808006030100ULL, 0x8080808080060301ULL, 0x8080808080060300ULL, 0x8080808080800603ULL,
+    0x8080808006020100ULL, 0x8080808080060201ULL, 0x8080808080060200ULL, 0x8080808080800602ULL,
+    0x8080808080060100ULL, 0x8080808080800601ULL, 0x8080808080800600ULL, 0x8080808080808006ULL,
+    0x8080050403020100ULL, 0x8080800504030201ULL, 0x8080800504030200ULL, 0x8080808005040302ULL,
+    0x8080800504030100ULL, 0x8080808005040301ULL, 0x8080808005040300ULL, 0x8080808080050403ULL,
+    0x8080800504020100ULL, 0x8080808005040201ULL, 0x8080808005040200ULL, 0x8080808080050402ULL,
+    0x8080808005040100ULL, 0x8080808080050401ULL, 0x8080808080050400ULL, 0x8080808080800504ULL,
+    0x8080800503020100ULL, 0x8080808005030201ULL, 0x8080808005030200ULL, 0x8080808080050302ULL,
+    0x8080808005030100ULL, 0x8080808080050301ULL, 0x8080808080050300ULL, 0x8080808080800503ULL,
+    0x8080808005020100ULL, 0x8080808080050201ULL, 0x8080808080050200ULL, 0x8080808080800502ULL,
+    0x8080808080050100ULL, 0x8080808080800501ULL, 0x8080808080800500ULL, 0x8080808080808005ULL,
+    0x8080800403020100ULL, 0x8080808004030201ULL, 0x8080808004030200ULL, 0x8080808080040302ULL,
+    0x8080808004030100ULL, 0x8080808080040301ULL, 0x8080808080040300ULL, 0x8080808080800403ULL,
+    0x8080808004020100ULL, 0x8080808080040201ULL, 0x8080808080040200ULL, 0x8080808080800402ULL,
+    0x8080808080040100ULL, 0x8080808080800401ULL, 0x8080808080800400ULL, 0x8080808080808004ULL,
+    0x8080808003020100ULL, 0x8080808080030201ULL, 0x8080808080030200ULL, 0x8080808080800302ULL,
+    0x8080808080030100ULL, 0x8080808080800301ULL, 0x8080808080800300ULL, 0x8080808080808003ULL,
+    0x8080808080020100ULL, 0x8080808080800201ULL, 0x8080808080800200ULL, 0x8080808080808002ULL,
+    0x8080808080800100ULL, 0x8080808080808001ULL, 0x8080808080808000ULL, 0x8080808080808080ULL,
+};
+
+/**
+ * Classify a single byte.
+ * @param c the byte
+ * @return its class bits
+ */
+static inline uint8_t classify(unsigned char c)
+{
+    return CLASS_LOW[c & 0x0F] & CLASS_HIGH[c >> 4];
+}
+
+/**
+ * Check a pair of adjacent characters of the compacted expression, following the same rules as isValid.
+ * @param a the first character
+ * @param b the character after it
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return true if the pair is not allowed
+ */
+static inline bool isBadPair(unsigned char a, unsigned char b, int mode)
+{
+    if (a == b && (classify(a) & (CLASS_SINGLE | CLASS_CARET))) {
+        return true;
+    }
+    return mode == SCAN_DECIMAL && ((a == '/' && b == '0') || (a == '^' && b == '-'));
+}
+
+/**
+ * Finish a scan one byte at a time. The vector versions hand over whatever does not fill a full vector.
+ * @param s the expression
+ * @param in index of the next byte to read
+ * @param out index of the next byte to write
+ * @param checked index of the first compacted byte whose pair has not been checked
+ * @param len length of the expression
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return true if nothing in the remaining part is illegal
+ */
+static bool scanTail(char* s, size_t in, size_t out, size_t checked, size_t len, int mode)
+{
+    uint8_t legal = mode == SCAN_DECIMAL ? CLASS_DECIMAL : CLASS_LETTERS;
+    bool clean = true;
+
+    for (; in < len; in++) {
+        uint8_t cls = classify(s[in]);
+        clean &= (cls & legal) != 0;
+        s[out] = s[in];
+        out += (cls & CLASS_WHITESPACE) == 0;
+    }
+    s[out] = '\0';
+
+    for (; checked + 1 < out; checked++) {
+        clean &= !isBadPair(s[checked], s[checked + 1], mode);
+    }
+    return clean;
+}
+
+#ifdef SCAN_X86
+
+/**
+ * Classify 16 bytes at once.
+ * @param v the bytes
+ * @return the class bits of every byte
+ */
+__attribute__((target("ssse3")))
+static inline __m128i classify16(__m128i v)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i low = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)CLASS_LOW), _mm_and_si128(v, nibble));
+    __m128i high = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)CLASS_HIGH), _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    return _mm_and_si128(low, high);
+}
+
+/**
+ * Write the non-whitespace bytes of a 16-byte vector to s + out.
+ * Never writes past the 16 bytes the vector was loaded from, so it is safe to compact in place.
+ * @param s the expression
+ * @param out index to write at
+ * @param v the bytes
+ * @param spaces bitmask of the whitespace bytes in v
+ * @return the new write index
+ */
+__attribute__((target("ssse3")))
+static inline size_t compact16(char* s, size_t out, __m128i v, unsigned spaces)
+{
+    if (spaces == 0) {
+        _mm_storeu_si128((__m128i*)(s + out), v);
+        return out + 16;
+    }
+    unsigned low = spaces & 0xFF;
+    unsigned high = spaces >> 8;
+    __m128i lowShuffle = _mm_loadl_epi64((const __m128i*)&COMPACT[low]);
+    __m128i highShuffle = _mm_add_epi8(_mm_loadl_epi64((const __m128i*)&COMPACT[high]), _mm_set1_epi8(8));
+    _mm_storel_epi64((__m128i*)(s + out), _mm_shuffle_epi8(v, lowShuffle));
+    out += 8 - __builtin_popcount(low);
+    _mm_storel_epi64((__m128i*)(s + out), _mm_shuffle_epi8(v, highShuffle));
+    return out + 8 - __builtin_popcount(high);
+}
+
+/**
+ * Flag the bad operator pairs among 16 compacted bytes.
+ * @param a 16 compacted bytes
+ * @param b the same bytes shifted by one
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return 0xFF in every position where a pair starts that is not allowed
+ */
+__attribute__((target("ssse3")))
+static inline __m128i badPairs16(__m128i a, __m128i b, int mode)
+{
+    __m128i slash = _mm_cmpeq_epi8(a, _mm_set1_epi8('/'));
+    __m128i caret = _mm_cmpeq_epi8(a, _mm_set1_epi8('^'));
+    __m128i single = _mm_or_si128(_mm_or_si128(slash, caret),
+                                  _mm_or_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8('+')), _mm_cmpeq_epi8(a, _mm_set1_epi8('*'))));
+    __m128i bad = _mm_and_si128(single, _mm_cmpeq_epi8(a, b));
+    if (mode == SCAN_DECIMAL) {
+        bad = _mm_or_si128(bad, _mm_and_si128(slash, _mm_cmpeq_epi8(b, _mm_set1_epi8('0'))));
+        bad = _mm_or_si128(bad, _mm_and_si128(caret, _mm_cmpeq_epi8(b, _mm_set1_epi8('-'))));
+    }
+    return bad;
+}
+
+/**
+ * SSSE3 scan, 16 bytes per step.
+ * @param s the expression
+ * @param len its length
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return true if the compacted expression is clean
+ */
+__attribute__((target("ssse3")))
+static bool scanSsse3(char* s, size_t len, int mode)
+{
+    const __m128i whitespace = _mm_set1_epi8(CLASS_WHITESPACE);
+    const __m128i legal = _mm_set1_epi8((char)(mode == SCAN_DECIMAL ? CLASS_DECIMAL : CLASS_LETTERS));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i flags = zero;
+    size_t in = 0, out = 0, checked = 0;
+
+    for (; in + 16 <= len; in += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + in));
+        __m128i cls = classify16(v);
+        flags = _mm_or_si128(flags, _mm_cmpeq_epi8(_mm_and_si128(cls, legal), zero));
+        unsigned spaces = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(cls, whitespace), zero)) & 0xFFFF;
+        out = compact16(s, out, v, spaces);
+
+        // Pairs are checked on the compacted output as soon as 17 final bytes are behind the write index
+        for (; checked + 17 <= out; checked += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(s + checked));
+            __m128i b = _mm_loadu_si128((const __m128i*)(s + checked + 1));
+            flags = _mm_or_si128(flags, badPairs16(a, b, mode));
+        }
+    }
+    bool clean = _mm_movemask_epi8(flags) == 0;
+    return scanTail(s, in, out, checked, len, mode) && clean;
+}
+
+/**
+ * AVX2 scan, 32 bytes per step. Blocks without whitespace are stored whole; others are compacted as two halves.
+ * @param s the expression
+ * @param len its length
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return true if the compacted expression is clean
+ */
+__attribute__((target("avx2")))
+static bool scanAvx2(char* s, size_t len, int mode)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)CLASS_LOW));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)CLASS_HIGH));
+    const __m256i whitespace = _mm256_set1_epi8(CLASS_WHITESPACE);
+    const __m256i legal = _mm256_set1_epi8((char)(mode == SCAN_DECIMAL ? CLASS_DECIMAL : CLASS_LETTERS));
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i flags = zero;
+    __m128i pairFlags = _mm_setzero_si128();
+    size_t in = 0, out = 0, checked = 0;
+
+    for (; in + 32 <= len; in += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + in));
+        __m256i cls = _mm256_and_si256(_mm256_shuffle_epi8(lowTable, _mm256_and_si256(v, nibble)),
+                                       _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+        flags = _mm256_or_si256(flags, _mm256_cmpeq_epi8(_mm256_and_si256(cls, legal), zero));
+        uint32_t spaces = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(cls, whitespace), zero));
+
+        if (spaces == 0) {
+            _mm256_storeu_si256((__m256i*)(s + out), v);
+            out += 32;
+        } else {
+            out = compact16(s, out, _mm256_castsi256_si128(v), spaces & 0xFFFF);
+            out = compact16(s, out, _mm256_extracti128_si256(v, 1), spaces >> 16);
+        }
+
+        for (; checked + 17 <= out; checked += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(s + checked));
+            __m128i b = _mm_loadu_si128((const __m128i*)(s + checked + 1));
+            pairFlags = _mm_or_si128(pairFlags, badPairs16(a, b, mode));
+        }
+    }
+    bool clean = _mm256_movemask_epi8(flags) == 0 && _mm_movemask_epi8(pairFlags) == 0;
+    return scanTail(s, in, out, checked, len, mode) && clean;
+}
+
+#endif /* SCAN_X86 */
+
+/**
+ * Removes whitespace from the expression in place and checks, in the same pass, that it only contains
+ * characters allowed in the mode and no doubled operators (plus "/0" and "^-" in decimal mode).
+ * A false result means isValid will find a problem; a true result means isValid can be skipped.
+ * @param expression the expression to compact, null-terminated
+ * @param mode SCAN_DECIMAL or SCAN_LETTERS
+ * @return true if the compacted expression is clean
+ */
+bool scanExpression(char* expression, int mode)
+{
+    size_t len = strlen(expression);
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return scanAvx2(expression, len, mode);
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return scanSsse3(expression, len, mode);
+    }
+#endif
+    return scanTail(expression, 0, 0, 0, len, mode);
+}
@@ -0,0 +1,15 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+
+/** Decimal expressions: digits, operators and parentheses, with the "/0" and "^-" pair checks. */
+#define SCAN_DECIMAL 0
+
+/** Base 32 / base n expressions: digits and 'A'-'Z' are both literal characters. */
+#define SCAN_LETTERS 1
+
+/** Function to remove whitespace in place and check characters and operator pairs in the same pass*/
+bool scanExpression(char* expression, int mode);
+
+#endif /*SCAN_H*/
@@ -0,0 +1,703 @@
+/**
+ * @file script.c
+ * @author Jason Wang
+ * This program evaluates scripts: statements separated by ';' or newlines, each either an expression, whose value
+ * is printed, or an assignment "name = expression", as in "x = 3A*2; y = x^2 - 1; y + x". Variable names start
+ * with a lowercase letter or '_', which no base uses as a digit, followed by lowercase letters, digits and '_'.
+ * The whole script is compiled before anything runs: names are interned in a hashed symbol table and resolved to
+ * slots, so reading a variable at run time is an array load, and the operators are the ones a line would use.
+*/
+#include "script.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "number.h"
+#include "radix.h"
+#include "operation.h"
+
+/** Binding power and associativity of a binary operator, as in infix.c. */
+typedef struct {
+    unsigned char precedence;
+    bool rightAssociative;
+} ScriptOperator;
+
+/** Binary operators indexed by their character; a precedence of 0 means "not an operator". */
+static const ScriptOperator OPERATORS[UCHAR_MAX + 1] = {
+    ['+'] = { 1, false },
+    ['-'] = { 1, false },
+    ['*'] = { 2, false },
+    ['/'] = { 2, false },
+    ['^'] = { 3, true },
+};
+
+/** Everything the compiler carries from one statement to the next. */
+typedef struct {
+    EvalContext* context;
+    /** The modulus of --mod, or NULL */
+    const Modulus* modulus;
+    const char* text;
+    size_t next;
+    ScriptInstruction* code;
+    size_t length;
+    size_t capacity;
+    ScriptSymbol* symbols;
+    size_t symbolCapacity;
+    int symbolCount;
+    /** Values on the stack after the instructions so far, and the most there have been */
+    size_t depth;
+    size_t maxDepth;
+} Compiler;
+
+/**
+ * Check for the whitespace a line would have removed, newlines aside, which end statements.
+ * @param c the character
+ * @return true if it is ignored
+ */
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Check for a character that may start a variable name.
+ * @param c the character
+ * @return true if it is a lowercase letter or '_'
+ */
+static inline bool startsName(char c)
+{
+    return (c >= 'a' && c <= 'z') || c == '_';
+}
+
+/**
+ * Check for a character that may continue a variable name.
+ * @param c the character
+ * @return true if it is a lowercase letter, a decimal digit or '_'
+ */
+static inline bool continuesName(char c)
+{
+    return startsName(c) || (c >= '0' && c <= '9');
+}
+
+/**
+ * Check for a character that may be part of a literal of the program.
+ * @param context the evaluation context
+ * @param c the character
+ * @return true if it is a digit, or an uppercase letter outside infix_10
+ */
+static inline bool isLiteral(const EvalContext* context, char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z' && context->program != PROGRAM_10);
+}
+
+/**
+ * Check for a character a script may contain.
+ * @param context the evaluation context
+ * @param c the character
+ * @return true if it is part of a literal, a name, an operator, a parenthesis, '=' or a statement separator
+ */
+static inline bool isAllowed(const EvalContext* context, char c)
+{
+    return isLiteral(context, c) || continuesName(c) || isOperator(c) || strchr("()=;\n", c) != NULL;
+}
+
+/**
+ * Check for an operator the scanner does not allow twice in a row.
+ * @param c the characters from the operator on
+ * @return true if it is '+', '*', '/' or '^' followed by itself
+ */
+static inline bool isDoubled(const char* c)
+{
+    return (c[0] == '+' || c[0] == '*' || c[0] == '/' || c[0] == '^') && c[1] == c[0];
+}
+
+/**
+ * Check for a divisor that is a zero literal: one starting with '0' as the decimal scanner sees it, or all
+ * zeros once converted from another base.
+ * @param context the evaluation context
+ * @param c the characters after the '/'
+ * @return true if they are a zero literal
+ */
+static bool isZeroLiteral(const EvalContext* context, const char* c)
+{
+    if (context->program == PROGRAM_10) {
+        return *c == '0';
+    }
+    while (*c == '0') {
+        c++;
+    }
+    return c[-1] == '0' && !isLiteral(context, *c);
+}
+
+/**
+ * Check the whole script before compiling it, in the order a line is checked, so a one-line script fails
+ * with the status the single-line mode gives it: for infix_32 and infix_n every character and doubled operator,
+ * then every literal as convertBaseNtoBase10 does, then what isValid checks, position by position.
+ * @param context the evaluation context
+ * @param text the script
+ */
+static void checkScript(EvalContext* context, const char* text)
+{
+    if (context->program != PROGRAM_10) {
+        for (const char* c = text; *c != '\0'; c++) {
+            if (!isAllowed(context, *c) || isDoubled(c)) {
+                fail(context, FAIL_INPUT);
+            }
+        }
+        bool overflow = false;
+        for (const char* c = text; *c != '\0';) {
+            if (startsName(*c)) {
+                // Digits within a name are not a literal
+                while (continuesName(*c)) {
+                    c++;
+                }
+            } else if (isLiteral(context, *c)) {
+                int length = 0;
+                while (isLiteral(context, c[length])) {
+                    length++;
+                }
+                unsigned long magnitude;
+                int status = parseRadixLiteral(c, length, context->base, &magnitude);
+                if (status == FAIL_INPUT) {
+                    fail(context, FAIL_INPUT);
+                }
+                overflow = overflow || status == FAIL_OVERFLOW;
+                c += length;
+            } else {
+                c++;
+            }
+        }
+        if (overflow) {
+            fail(context, FAIL_OVERFLOW);
+        }
+    }
+    for (const char* c = text; *c != '\0'; c++) {
+        if (c[0] == '/' && isZeroLiteral(context, c + 1)) {
+            fail(context, FAIL_DIVZERO);
+        }
+        if (isDoubled(c)) {
+            fail(context, FAIL_INPUT);
+        }
+        if (!isAllowed(context, *c)) {
+            fail(context, FAIL_INPUT);
+        }
+        if (c[0] == '^' && c[1] == '-') {
+            // A negative exponent literal is rejected before evaluation, as the scanner does for a line
+            fail(context, FAIL_INPUT);
+        }
+    }
+}
+
+/**
+ * FNV-1a hash of a variable name.
+ * @param name the name
+ * @param length its length
+ * @return the hash
+ */
+static uint32_t hashName(const char* name, int length)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Find the entry a name hashes to with linear probing: the name's own, or the empty one where it would go.
+ * @param symbols the table
+ * @param capacity its size, a power of two
+ * @param name the name
+ * @param length its length
+ * @param hash its hash
+ * @return the entry
+ */
+static ScriptSymbol* probe(ScriptSymbol* symbols, size_t capacity, const char* name, int length, uint32_t hash)
+{
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        ScriptSymbol* symbol = &symbols[i];
+        if (symbol->name == NULL
+            || (symbol->hash == hash && symbol->length == length && memcmp(symbol->name, name, length) == 0)) {
+            return symbol;
+        }
+    }
+}
+
+/**
+ * Intern a name, giving it the next slot the first time it is seen. The table doubles in the arena when three
+ * quarters full; the old one stays there until the script ends.
+ * @param compiler the compiler
+ * @param name the name, in the script text
+ * @param length its length
+ * @return its entry
+ */
+static ScriptSymbol* intern(Compiler* compiler, const char* name, int length)
+{
+    uint32_t hash = hashName(name, length);
+    ScriptSymbol* symbol = probe(compiler->symbols, compiler->symbolCapacity, name, length, hash);
+    if (symbol->name != NULL) {
+        return symbol;
+    }
+    if ((size_t)(compiler->symbolCount + 1) * 4 > compiler->symbolCapacity * 3) {
+        size_t capacity = compiler->symbolCapacity * 2;
+        ScriptSymbol* symbols = contextAlloc(compiler->context, capacity * sizeof(ScriptSymbol));
+        memset(symbols, 0, capacity * sizeof(ScriptSymbol));
+        for (size_t i = 0; i < compiler->symbolCapacity; i++) {
+            ScriptSymbol* old = &compiler->symbols[i];
+            if (old->name != NULL) {
+                *probe(symbols, capacity, old->name, old->length, old->hash) = *old;
+            }
+        }
+        compiler->symbols = symbols;
+        compiler->symbolCapacity = capacity;
+        symbol = probe(symbols, capacity, name, length, hash);
+    }
+    *symbol = (ScriptSymbol){ .name = name, .length = length, .hash = hash, .slot = compiler->symbolCount++ };
+    return symbol;
+}
+
+/**
+ * Append an instruction, keeping track of the stack depth.
+ * @param compiler the compiler
+ * @param instruction the instruction
+ */
+static void emit(Compiler* compiler, ScriptInstruction instruction)
+{
+    if (compiler->length == compiler->capacity) {
+        ScriptInstruction* code = contextAlloc(compiler->context, compiler->capacity * 2 * sizeof(ScriptInstruction));
+        memcpy(code, compiler->code, compiler->capacity * sizeof(ScriptInstruction));
+        compiler->code = code;
+        compiler->capacity *= 2;
+    }
+    compiler->code[compiler->length++] = instruction;
+    switch (instruction.opcode) {
+    case SCRIPT_PUSH:
+    case SCRIPT_LOAD:
+        if (++compiler->depth > compiler->maxDepth) {
+            compiler->maxDepth = compiler->depth;
+        }
+        break;
+    case SCRIPT_STORE:
+    case SCRIPT_APPLY:
+    case SCRIPT_PRINT:
+        compiler->depth--;
+        break;
+    }
+}
+
+/**
+ * Compile a literal, which may be negative so -9223372036854775808 is exact.
+ * @param compiler the compiler, at the literal's first digit
+ * @param negative whether a '-' came before it
+ * @param modular whether to reduce it modulo --mod
+ */
+static void compileLiteral(Compiler* compiler, bool negative, bool modular)
+{
+    EvalContext* context = compiler->context;
+    const char* digits = compiler->text + compiler->next;
+    int length = 0;
+    while (isLiteral(context, digits[length])) {
+        length++;
+    }
+    compiler->next += length;
+
+    unsigned long magnitude = 0;
+    int status = parseRadixLiteral(digits, length, context->base, &magnitude);
+    if (status == FAIL_INPUT) {
+        fail(context, FAIL_INPUT);
+    }
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    if (status == FAIL_OVERFLOW || magnitude > limit) {
+        fail(context, FAIL_OVERFLOW);
+    }
+    long value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_PUSH, .value = modular ? modReduce(compiler->modulus, value) : value });
+}
+
+static void compileClimb(Compiler* compiler, int minPrecedence, bool modular);
+
+/**
+ * Compile a single operand: a literal, a variable, a parenthesized sub-expression or a negated operand.
+ * @param compiler the compiler, at the operand's first character
+ * @param modular whether arithmetic is modulo --mod here
+ */
+static void compileOperand(Compiler* compiler, bool modular)
+{
+    EvalContext* context = compiler->context;
+    const char* text = compiler->text;
+    char c = text[compiler->next];
+    if (isLiteral(context, c)) {
+        compileLiteral(compiler, false, modular);
+    } else if (c == '-' && isLiteral(context, text[compiler->next + 1])) {
+        compiler->next++;
+        compileLiteral(compiler, true, modular);
+    } else if (c == '-') {
+        compiler->next++;
+        limitEnter(context);
+        compileOperand(compiler, modular);
+        limitLeave(context);
+        emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_NEGATE, .modular = modular });
+    } else if (c == '(') {
+        compiler->next++;
+        limitEnter(context);
+        compileClimb(compiler, 1, modular);
+        if (text[compiler->next] != ')') {
+            fail(context, FAIL_INPUT);
+        }
+        limitLeave(context);
+        compiler->next++;
+    } else if (startsName(c)) {
+        size_t start = compiler->next;
+        while (continuesName(text[compiler->next])) {
+            compiler->next++;
+        }
+        ScriptSymbol* symbol = intern(compiler, text + start, compiler->next - start);
+        if (!symbol->assigned) {
+            // Read before any statement assigns it
+            fail(context, FAIL_INPUT);
+        }
+        emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_LOAD, .modular = modular, .slot = symbol->slot });
+    } else {
+        // Missing operand, e.g. a trailing operator or an empty pair of parentheses
+        fail(context, FAIL_INPUT);
+    }
+}
+
+/**
+ * Precedence climbing, as parse_climb in infix.c does it, emitting each operator after its operands.
+ * @param compiler the compiler
+ * @param minPrecedence the weakest operator this call may consume
+ * @param modular whether arithmetic is modulo --mod here; exponents never are
+ */
+static void compileClimb(Compiler* compiler, int minPrecedence, bool modular)
+{
+    compileOperand(compiler, modular);
+    for (;;) {
+        unsigned char op = compiler->text[compiler->next];
+        ScriptOperator info = OPERATORS[op];
+        if (info.precedence < minPrecedence) {
+            return;
+        }
+        compiler->next++;
+        limitEnter(compiler->context);
+        compileClimb(compiler, info.precedence + !info.rightAssociative, modular && op != '^');
+        limitLeave(compiler->context);
+        emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_APPLY, .op = op, .modular = modular });
+    }
+}
+
+/**
+ * Compile one statement, up to the ';' or newline that ends it.
+ * @param compiler the compiler, at the statement's first character
+ */
+static void compileStatement(Compiler* compiler)
+{
+    const char* text = compiler->text;
+    bool modular = compiler->modulus != NULL;
+    size_t start = compiler->next;
+    size_t end = start;
+    while (startsName(text[start]) && continuesName(text[end])) {
+        end++;
+    }
+    if (end > start && text[end] == '=') {
+        compiler->next = end + 1;
+        compileClimb(compiler, 1, modular);
+        int slot = intern(compiler, text + start, end - start)->slot;
+        emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_STORE, .modular = modular, .slot = slot });
+        if (modular) {
+            // An exponent reading the variable needs the value a line would have had there, not its residue,
+            // so the right-hand side is compiled again without --mod
+            size_t defer = compiler->length;
+            emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_DEFER, .slot = slot });
+            compiler->next = end + 1;
+            compileClimb(compiler, 1, false);
+            emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_STORE, .slot = slot });
+            compiler->code[defer].value = compiler->length - defer - 1;
+        }
+        // Assigned only now, so "x = x + 1" needs an earlier x; the table may have moved since the slot was found
+        intern(compiler, text + start, end - start)->assigned = true;
+    } else {
+        compileClimb(compiler, 1, modular);
+        emit(compiler, (ScriptInstruction){ .opcode = SCRIPT_PRINT });
+    }
+    char c = text[compiler->next];
+    if (c != ';' && c != '\n' && c != '\0') {
+        // Unbalanced ')' or other trailing garbage
+        fail(compiler->context, FAIL_INPUT);
+    }
+}
+
+/**
+ * Compiles a script. Scratch memory comes from the context's arena, as does the program.
+ * @param context the evaluation context, whose base is the base of the literals
+ * @param text the statements, separated by ';' or newlines, with all other whitespace removed
+ * @return the program
+ */
+ScriptProgram scriptCompile(EvalContext* context, const char* text)
+{
+    Compiler compiler = {
+        .context = context,
+        .modulus = context->modulus.value != 0 ? &context->modulus : NULL,
+        .text = text,
+        .code = contextAlloc(context, SCRIPT_CODE * sizeof(ScriptInstruction)),
+        .capacity = SCRIPT_CODE,
+        .symbols = contextAlloc(context, SCRIPT_SYMBOLS * sizeof(ScriptSymbol)),
+        .symbolCapacity = SCRIPT_SYMBOLS,
+    };
+    memset(compiler.symbols, 0, SCRIPT_SYMBOLS * sizeof(ScriptSymbol));
+    checkScript(context, text);
+
+    while (text[compiler.next] != '\0') {
+        char c = text[compiler.next];
+        if (c == ';' || c == '\n') {
+            compiler.next++;
+        } else {
+            compileStatement(&compiler);
+        }
+    }
+    return (ScriptProgram){ compiler.code, compiler.length, compiler.symbolCount, compiler.maxDepth };
+}
+
+/** Values of a running script. */
+typedef struct {
+    /** Each variable's residue under --mod */
+    long* residues;
+    /** Each variable's plain value, the only one it has without --mod */
+    long* plain;
+    /** Status computing the plain value failed with, raised when it is read; 0 if it did not fail */
+    int* failed;
+    /** Whether computing the plain value overflowed under a policy that keeps going */
+    bool* flagged;
+    long* stack;
+    /** Whether a SCRIPT_DEFER copy is running, whose operations a line would not have applied */
+    bool deferred;
+} Machine;
+
+static void runDeferred(EvalContext* context, const ScriptProgram* program, Machine* machine, size_t pc, size_t top);
+
+/**
+ * Runs instructions of a compiled script. Each expression statement's value is printed as the single-line mode
+ * would print it, and a failure ends the script through fail(), after the values of the statements before it.
+ * @param context the evaluation context, whose base is the base to print values in
+ * @param program the program
+ * @param machine the variables and the stack
+ * @param from the first instruction to run
+ * @param to the instruction after the last
+ * @param top the values on the stack
+ */
+static void execute(EvalContext* context, const ScriptProgram* program, Machine* machine, size_t from, size_t to, size_t top)
+{
+    long* stack = machine->stack;
+    const Modulus* modulus = &context->modulus;
+    for (size_t pc = from; pc < to; pc++) {
+        const ScriptInstruction* instruction = &program->code[pc];
+        int slot = instruction->slot;
+        switch (instruction->opcode) {
+        case SCRIPT_PUSH:
+            stack[top++] = instruction->value;
+            break;
+        case SCRIPT_LOAD:
+            if (instruction->modular) {
+                stack[top++] = machine->residues[slot];
+                break;
+            }
+            if (machine->failed[slot] != 0) {
+                fail(context, machine->failed[slot]);
+            }
+            context->overflowed |= machine->flagged[slot];
+            stack[top++] = machine->plain[slot];
+            break;
+        case SCRIPT_STORE:
+            (instruction->modular ? machine->residues : machine->plain)[slot] = stack[--top];
+            break;
+        case SCRIPT_APPLY: {
+            if (!machine->deferred) {
+                limitOperation(context);
+            }
+            long rhs = stack[--top];
+            long lhs = stack[top - 1];
+            unsigned char op = instruction->op;
+            stack[top - 1] = instruction->modular ? modApplyOp(context, modulus, lhs, rhs, op)
+                                                  : context->overflow->ops[op](context, lhs, rhs);
+            break;
+        }
+        case SCRIPT_NEGATE: {
+            if (!machine->deferred) {
+                limitOperation(context);
+            }
+            long value = stack[top - 1];
+            stack[top - 1] = instruction->modular ? modApplyOp(context, modulus, 0, value, '-')
+                                                  : context->overflow->ops['-'](context, 0, value);
+            break;
+        }
+        case SCRIPT_PRINT:
+            if (context->program == PROGRAM_10) {
+                printValue(stack[--top]);
+            } else {
+                convertToBase(context, stack[--top]);
+            }
+            break;
+        case SCRIPT_DEFER:
+            runDeferred(context, program, machine, pc, top);
+            pc += instruction->value;
+            break;
+        }
+    }
+}
+
+/**
+ * Runs the copy of an assignment that computes its variable's plain value under --mod. The statement has already
+ * succeeded with residues, so a failure or overflow here is kept with the variable and raised only when an
+ * exponent reads it, as the single-line mode would only meet it there.
+ * @param context the evaluation context
+ * @param program the program
+ * @param machine the variables and the stack
+ * @param pc the SCRIPT_DEFER instruction
+ * @param top the values on the stack
+ */
+static void runDeferred(EvalContext* context, const ScriptProgram* program, Machine* machine, size_t pc, size_t top)
+{
+    const ScriptInstruction* instruction = &program->code[pc];
+    jmp_buf* outer = context->recovery;
+    bool overflowed = context->overflowed;
+    jmp_buf recovery;
+    context->recovery = &recovery;
+    context->overflowed = false;
+    machine->deferred = true;
+    int status = setjmp(recovery);
+    if (status == 0) {
+        execute(context, program, machine, pc + 1, pc + 1 + instruction->value, top);
+    }
+    machine->deferred = false;
+    machine->failed[instruction->slot] = status;
+    machine->flagged[instruction->slot] = context->overflowed;
+    context->overflowed = overflowed;
+    context->recovery = outer;
+    context->status = 0;
+}
+
+/**
+ * Runs a compiled script. Each expression statement's value is printed as the single-line mode would print it,
+ * and the first failure ends the script through fail(), after the values of the statements before it.
+ * @param context the evaluation context, whose base is the base to print values in
+ * @param program the program
+ */
+void scriptRun(EvalContext* context, const ScriptProgram* program)
+{
+    size_t slots = program->slots + 1;
+    Machine machine = {
+        .residues = contextAlloc(context, slots * sizeof(long)),
+        .plain = contextAlloc(context, slots * sizeof(long)),
+        .failed = contextAlloc(context, slots * sizeof(int)),
+        .flagged = contextAlloc(context, slots * sizeof(bool)),
+        .stack = contextAlloc(context, (program->depth + 1) * sizeof(long)),
+    };
+    memset(machine.failed, 0, slots * sizeof(int));
+    memset(machine.flagged, 0, slots * sizeof(bool));
+    execute(context, program, &machine, 0, program->length, 0);
+}
+
+/**
+ * Reads all of a file descriptor into the arena, null-terminated. The buffer doubles as it fills.
+ * @param context the evaluation context
+ * @param fd the file descriptor, read until end of file
+ * @return the text
+ */
+static char* readAll(EvalContext* context, int fd)
+{
+    size_t capacity = SCRIPT_CHUNK;
+    size_t length = 0;
+    char* text = contextAlloc(context, capacity + 1);
+    for (;;) {
+        if (length == capacity) {
+            char* grown = contextAlloc(context, capacity * 2 + 1);
+            memcpy(grown, text, length);
+            text = grown;
+            capacity *= 2;
+        }
+        ssize_t count = read(fd, text + length, capacity - length);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            fail(context, FAIL_INPUT);
+        }
+        if (count == 0) {
+            break;
+        }
+        length += count;
+        if (context->limits.length != 0 && length > context->limits.length) {
+            fail(context, FAIL_LIMIT);
+        }
+    }
+    text[length] = '\0';
+    return text;
+}
+
+/**
+ * Reads the "$base" header infix_n scripts start with, which must be followed by whitespace.
+ * @param context the evaluation context, whose base is set
+ * @param text the script
+ * @return the rest of the script
+ */
+static char* skipHeader(EvalContext* context, char* text)
+{
+    text += strspn(text, " \t\r\n\v\f");
+    if (*text != '$' || !isdigit(text[1])) {
+        fail(context, FAIL_INPUT);
+    }
+    int base = 0;
+    for (text++; isdigit(*text); text++) {
+        base = base * 10 + *text - '0';
+        if (base > RADIX_MAX_BASE) {
+            fail(context, FAIL_INPUT);
+        }
+    }
+    if (radixKernel(base) == NULL || (*text != '\0' && !isBlank(*text) && *text != '\n')) {
+        fail(context, FAIL_INPUT);
+    }
+    context->base = base;
+    return text;
+}
+
+/**
+ * Compiles and runs the script on standard input, as the context's program reads literals.
+ * @param context the evaluation context
+ * @return 0 or the exit status of the first failure
+ */
+int runScript(EvalContext* context)
+{
+    jmp_buf recovery;
+    context->recovery = &recovery;
+    context->status = setjmp(recovery);
+    if (context->status == 0) {
+        arenaReset(&context->arena);
+        context->overflowed = false;
+        context->base = context->program == PROGRAM_10 ? 10 : 32;
+        limitStart(context, 0);
+        if (context->usage.maxDepth > SCRIPT_MAX_DEPTH) {
+            context->usage.maxDepth = SCRIPT_MAX_DEPTH;
+        }
+        char* text = readAll(context, STDIN_FILENO);
+        if (context->program == PROGRAM_N) {
+            text = skipHeader(context, text);
+        }
+        // Whitespace within a statement is removed as a line's would be; newlines still end statements
+        char* compacted = text;
+        for (char* c = text; *c != '\0'; c++) {
+            if (!isBlank(*c)) {
+                *compacted++ = *c;
+            }
+        }
+        *compacted = '\0';
+
+        ScriptProgram program = scriptCompile(context, text);
+        scriptRun(context, &program);
+        // A policy that keeps going still reports the overflow through the exit status
+        context->status = context->overflowed ? FAIL_OVERFLOW : 0;
+    }
+    context->recovery = NULL;
+    return context->status;
+}
@@ -0,0 +1,86 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "context.h"
+
+/** Bytes read from standard input at a time. */
+#define SCRIPT_CHUNK 65536
+
+/** Symbol table entries allocated at first; always a power of two, doubled when three quarters full. */
+#define SCRIPT_SYMBOLS 16
+
+/** Instructions allocated at first; the code doubles when a longer script needs more. */
+#define SCRIPT_CODE 256
+
+/**
+ * Deepest a statement may nest when --limit depth sets no lower cap: as deep as a line of MAX_SIZE bytes can.
+ * The compiler recurses once per level, so a script, which has no length cap, must not nest without bound.
+ */
+#define SCRIPT_MAX_DEPTH 10000
+
+/** What an instruction does to the value stack. */
+typedef enum {
+    /** Push a literal */
+    SCRIPT_PUSH,
+    /** Push the value of a variable */
+    SCRIPT_LOAD,
+    /** Pop a value into a variable */
+    SCRIPT_STORE,
+    /** Pop two values and push the operator applied to them */
+    SCRIPT_APPLY,
+    /** Negate the value on top */
+    SCRIPT_NEGATE,
+    /** Pop a value and print it in the base of the script */
+    SCRIPT_PRINT,
+    /** Run the next value instructions, which compute a variable's plain value, keeping any failure until it is read */
+    SCRIPT_DEFER,
+} ScriptOpcode;
+
+/** One instruction of a compiled script. */
+typedef struct {
+    unsigned char opcode;
+    /** The operator of SCRIPT_APPLY */
+    unsigned char op;
+    /**
+     * Whether SCRIPT_APPLY or SCRIPT_NEGATE works modulo --mod, and whether SCRIPT_LOAD and SCRIPT_STORE use the
+     * variable's residue rather than its plain value; false inside an exponent, as in infix.c
+     */
+    bool modular;
+    /** The variable of SCRIPT_LOAD, SCRIPT_STORE and SCRIPT_DEFER */
+    int slot;
+    /** The literal of SCRIPT_PUSH, already reduced when modular, or the number of instructions SCRIPT_DEFER runs */
+    long value;
+} ScriptInstruction;
+
+/** A variable name interned in the symbol table. */
+typedef struct {
+    /** The name, in the script text; NULL for an empty entry */
+    const char* name;
+    int length;
+    uint32_t hash;
+    /** Index of the variable's value at run time */
+    int slot;
+    /** Whether a statement compiled so far assigns it, so it may be read */
+    bool assigned;
+} ScriptSymbol;
+
+/** A script compiled to instructions, with every variable resolved to a slot. */
+typedef struct {
+    ScriptInstruction* code;
+    size_t length;
+    /** Number of variables */
+    int slots;
+    /** Most values the stack ever holds */
+    size_t depth;
+} ScriptProgram;
+
+/** Function to compile a script, whitespace already removed, failing through fail()*/
+ScriptProgram scriptCompile(EvalContext* context, const char* text);
+/** Function to run a compiled script, printing the value of each expression statement*/
+void scriptRun(EvalContext* context, const ScriptProgram* program);
+/** Function to compile and run the script on standard input*/
+int runScript(EvalContext* context);
+
+#endif /*SCRIPT_H*/
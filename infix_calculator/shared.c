@@ -0,0 +1,92 @@
+/** 
+ * @file shared.c
+ * @author Jason Wang
+ * This program serves a co-located client through shared memory (see shm.c): the client writes expressions straight
+ * into the request ring of a named region, and the results go back through the response ring in the same order.
+ * Nothing is copied through the kernel, and neither side makes a system call while the other keeps it busy.
+ * One region serves one client; the server removes the region and exits once the client closes it, or with an
+ * error once the client exits without closing it.
+*/
+#include "shared.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "shm.h"
+#include "operation.h"
+
+/**
+ * Evaluates one request into a response.
+ * The text is copied out of shared memory first, so a client writing to the slot meanwhile cannot change it under the parser.
+ * @param evaluate the line evaluator
+ * @param context the evaluation context
+ * @param request the request
+ * @param response the response to fill in
+ */
+static void serveRequest(LineEvaluator evaluate, EvalContext* context, const ShmRequest* request, ShmResponse* response)
+{
+    char line[SHM_TEXT];
+    uint32_t length = request->length;
+    long result = 0;
+    int status = FAIL_INPUT;
+    if (length < SHM_TEXT) {
+        memcpy(line, request->text, length);
+        line[length] = '\0';
+        status = evaluate(context, line, &result);
+    }
+    response->tag = request->tag;
+    response->value = status == 0 ? result : 0;
+    response->status = status;
+    response->base = context->base;
+    response->overflowed = status == 0 && context->overflowed;
+}
+
+/**
+ * Creates the region and answers requests until the client closes it and every request is answered.
+ * @param evaluate the line evaluator
+ * @param context the evaluation context
+ * @param name the region's name, as for shm_open, e.g. "/infix"
+ * @return 0, or FAIL_INPUT if the region could not be created, another server is using it, or the client exited
+ *         without closing it
+ */
+int runShared(LineEvaluator evaluate, EvalContext* context, const char* name)
+{
+    ShmRegion* region = shmMap(name, true);
+    if (region == NULL) {
+        fprintf(stderr, "Error: Cannot create shared memory %s, or another server is using it.\n", name);
+        return FAIL_INPUT;
+    }
+
+    // The client leaves by setting closed; if it is gone and closed is not set, it exited without closing
+    bool gone = false;
+    while (!gone) {
+        uint32_t count = shmWaitReadable(&region->requests, &region->closed, &region->client);
+        if (count == 0) {
+            gone = !atomic_load(&region->closed);
+            break;
+        }
+        uint32_t head = atomic_load_explicit(&region->requests.head, memory_order_relaxed);
+        for (uint32_t n = 0; n < count && !gone; n++) {
+            ShmResponse response;
+            serveRequest(evaluate, context, &region->request[(head + n) & (SHM_SLOTS - 1)], &response);
+            // A client that closed is no longer reading responses, so they are dropped rather than waited for
+            if (shmWaitWritable(&region->responses, &region->closed, &region->client) > 0) {
+                uint32_t tail = atomic_load_explicit(&region->responses.tail, memory_order_relaxed);
+                region->response[tail & (SHM_SLOTS - 1)] = response;
+                shmPublish(&region->responses, 1);
+            } else {
+                gone = !atomic_load(&region->closed);
+            }
+            shmConsume(&region->requests, 1);
+        }
+    }
+
+    shmUnmap(region);
+    shm_unlink(name);
+    if (gone) {
+        fprintf(stderr, "Error: The client of shared memory %s exited without closing it.\n", name);
+        return FAIL_INPUT;
+    }
+    return 0;
+}
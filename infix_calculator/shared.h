@@ -0,0 +1,9 @@
+#ifndef SHARED_H
+#define SHARED_H
+
+#include "pipeline.h"
+
+/** Function to evaluate requests from a client through a named shared-memory region until the client closes it*/
+int runShared(LineEvaluator evaluate, EvalContext* context, const char* name);
+
+#endif /*SHARED_H*/
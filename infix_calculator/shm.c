@@ -0,0 +1,238 @@
+/**
+ * @file shm.c
+ * @author Jason Wang
+ * This program implements the shared-memory region used by --shm and the client library: mapping it by name,
+ * and the single-producer single-consumer rings inside it. A side that finds its ring empty (or full) polls for
+ * a while and then sleeps on a futex, and the other side only calls the kernel to wake it when it is asleep,
+ * so a busy ring costs no system calls at all.
+*/
+#include "shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/**
+ * Tell the processor this is a spin loop.
+ */
+static inline void cpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Sleep while a word still holds a value, for at most SHM_SLEEP_MS. The futex is not private, since the word
+ * lives in memory shared with another process.
+ * @param word the word
+ * @param expected the value it held when the caller decided to sleep
+ */
+static void futexWait(atomic_uint* word, uint32_t expected)
+{
+    struct timespec timeout = { 0, SHM_SLEEP_MS * 1000000L };
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+/**
+ * Wake every process sleeping on a word.
+ * @param word the word
+ */
+static void futexWake(atomic_uint* word)
+{
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, 1 << 30, NULL, NULL, 0);
+}
+
+/**
+ * Checks whether the process whose id a word holds is still running.
+ * @param pid the word, 0 while no process has been recorded
+ * @return false only if a process was recorded and it no longer exists
+ */
+bool shmAlive(const atomic_int* pid)
+{
+    int id = atomic_load(pid);
+    return id == 0 || kill(id, 0) == 0 || errno != ESRCH;
+}
+
+/**
+ * Creates or opens a named region and maps it.
+ * The server creates it, lays it out and writes the magic number last; a client only maps a region whose
+ * magic number and layout match and whose server is still running, and otherwise gets NULL so it can try again.
+ * @param name the name, as for shm_open, e.g. "/infix"
+ * @param create true for the server, which replaces a region of the same name left behind by a server that
+ *        exited, but not one whose server is still running
+ * @return the region, or NULL
+ */
+ShmRegion* shmMap(const char* name, bool create)
+{
+    if (create) {
+        ShmRegion* existing = shmMap(name, false);
+        if (existing != NULL) {
+            shmUnmap(existing);
+            return NULL;
+        }
+        // Unlinking rather than truncating leaves anyone still mapping an old region with the old one
+        shm_unlink(name);
+    }
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if ((create && ftruncate(fd, sizeof(ShmRegion)) != 0) || fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(ShmRegion)) {
+        close(fd);
+        return NULL;
+    }
+    ShmRegion* region = mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (create) {
+        // A fresh region from ftruncate is all zeros, so only the layout needs writing
+        region->version = SHM_VERSION;
+        region->slots = SHM_SLOTS;
+        region->textSize = SHM_TEXT;
+        region->server = getpid();
+        atomic_store_explicit(&region->magic, SHM_MAGIC, memory_order_release);
+    } else if (atomic_load_explicit(&region->magic, memory_order_acquire) != SHM_MAGIC || region->version != SHM_VERSION
+               || region->slots != SHM_SLOTS || region->textSize != SHM_TEXT || !shmAlive(&region->server)) {
+        munmap(region, sizeof(ShmRegion));
+        return NULL;
+    }
+    return region;
+}
+
+/**
+ * Unmaps a region. The server also removes its name with shm_unlink.
+ * @param region the region
+ */
+void shmUnmap(ShmRegion* region)
+{
+    munmap(region, sizeof(ShmRegion));
+}
+
+/**
+ * Counts the slots a consumer may read without waiting.
+ * @param ring the ring
+ * @return the number of published slots not yet consumed
+ */
+uint32_t shmReadable(ShmRing* ring)
+{
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) - atomic_load_explicit(&ring->head, memory_order_relaxed);
+}
+
+/**
+ * Counts the slots a producer may write without waiting.
+ * @param ring the ring
+ * @return the number of free slots
+ */
+static uint32_t shmWritable(ShmRing* ring)
+{
+    return SHM_SLOTS - (atomic_load_explicit(&ring->tail, memory_order_relaxed) - atomic_load_explicit(&ring->head, memory_order_acquire));
+}
+
+/**
+ * Waits until a ring has slots for one side, polling first and then sleeping on the index the other side moves.
+ * The waiting flag is raised before the last check, and the other side moves its index before it reads the flag,
+ * so either this side sees the move or the other side sees the flag and wakes it.
+ * Each time it has slept, it checks that the other side is still running, since a process that exited will
+ * never move its index or set stop.
+ * @param ring the ring
+ * @param readable true for the consumer, waiting on tail; false for the producer, waiting on head
+ * @param stop a flag that ends the wait when set, or NULL
+ * @param peer the process id of the other side, or NULL not to check
+ * @return the number of slots, 0 only if stop was set or the other side exited
+ */
+static uint32_t shmWait(ShmRing* ring, bool readable, const atomic_uint* stop, const atomic_int* peer)
+{
+    atomic_uint* word = readable ? &ring->tail : &ring->head;
+    atomic_uint* waiting = readable ? &ring->consumerWaiting : &ring->producerWaiting;
+    for (int spin = 0;; spin++) {
+        uint32_t available = readable ? shmReadable(ring) : shmWritable(ring);
+        if (available > 0 || (stop != NULL && atomic_load(stop))) {
+            return available;
+        }
+        if (spin > SHM_SPINS && peer != NULL && !shmAlive(peer)) {
+            return 0;
+        }
+        if (spin < SHM_SPINS) {
+            cpuRelax();
+            continue;
+        }
+        uint32_t observed = atomic_load(word);
+        atomic_store(waiting, 1);
+        available = readable ? shmReadable(ring) : shmWritable(ring);
+        if (available == 0 && (stop == NULL || !atomic_load(stop))) {
+            futexWait(word, observed);
+        }
+        atomic_store(waiting, 0);
+    }
+}
+
+/**
+ * Counts the slots a consumer may read, waiting for one.
+ * @param ring the ring
+ * @param stop a flag that ends the wait when set, or NULL
+ * @param peer the process id of the producer, or NULL not to check
+ * @return the number of slots, 0 only if stop was set or the producer exited, and the ring is empty
+ */
+uint32_t shmWaitReadable(ShmRing* ring, const atomic_uint* stop, const atomic_int* peer)
+{
+    return shmWait(ring, true, stop, peer);
+}
+
+/**
+ * Counts the slots a producer may write, waiting for one.
+ * @param ring the ring
+ * @param stop a flag that ends the wait when set, or NULL
+ * @param peer the process id of the consumer, or NULL not to check
+ * @return the number of slots, 0 only if stop was set or the consumer exited, and the ring is full
+ */
+uint32_t shmWaitWritable(ShmRing* ring, const atomic_uint* stop, const atomic_int* peer)
+{
+    return shmWait(ring, false, stop, peer);
+}
+
+/**
+ * Hands slots the producer has written to the consumer.
+ * @param ring the ring
+ * @param count how many slots after tail were written
+ */
+void shmPublish(ShmRing* ring, uint32_t count)
+{
+    atomic_store(&ring->tail, atomic_load_explicit(&ring->tail, memory_order_relaxed) + count);
+    if (atomic_load(&ring->consumerWaiting)) {
+        futexWake(&ring->tail);
+    }
+}
+
+/**
+ * Hands slots the consumer has read back to the producer.
+ * @param ring the ring
+ * @param count how many slots after head were read
+ */
+void shmConsume(ShmRing* ring, uint32_t count)
+{
+    atomic_store(&ring->head, atomic_load_explicit(&ring->head, memory_order_relaxed) + count);
+    if (atomic_load(&ring->producerWaiting)) {
+        futexWake(&ring->head);
+    }
+}
+
+/**
+ * Wakes whoever sleeps on a ring, so they notice a flag such as closed straight away.
+ * @param ring the ring
+ */
+void shmWakeAll(ShmRing* ring)
+{
+    futexWake(&ring->tail);
+    futexWake(&ring->head);
+}
@@ -0,0 +1,103 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Written last when a server has laid out a region, so a client never sees a half-built one ("Infx"). */
+#define SHM_MAGIC 0x78666e49
+
+/** Layout version; a client refuses a region with another. */
+#define SHM_VERSION 2
+
+/** Slots in each ring, a power of two; also the most requests a client may have in flight. */
+#define SHM_SLOTS 256
+
+/** Bytes of expression text in a request slot, including the terminating NUL. */
+#define SHM_TEXT 4096
+
+/** Pause instructions spent polling a ring before sleeping on its futex. */
+#define SHM_SPINS 4096
+
+/** Longest a sleeper waits on a futex before checking whether the other side went away, in milliseconds. */
+#define SHM_SLEEP_MS 100
+
+/**
+ * Single-producer single-consumer ring indices. Each counts up forever; a slot is index & (SHM_SLOTS - 1).
+ * The side that finds the ring empty (or full) sets its waiting flag and sleeps on the futex of tail (or head),
+ * so the other side only makes a system call when the ring went idle.
+ */
+typedef struct {
+    /** Next slot the consumer reads, written only by the consumer */
+    _Alignas(64) atomic_uint head;
+    /** Next slot the producer writes, written only by the producer */
+    _Alignas(64) atomic_uint tail;
+    /** Set while the consumer sleeps on tail */
+    _Alignas(64) atomic_uint consumerWaiting;
+    /** Set while the producer sleeps on head */
+    atomic_uint producerWaiting;
+} ShmRing;
+
+/** One expression, written by the client directly into shared memory. */
+typedef struct {
+    /** Chosen by the client and copied into the response */
+    uint64_t tag;
+    /** Bytes of text, less than SHM_TEXT */
+    uint32_t length;
+    /** The line as the server's program reads it, e.g. "$16 FF + 1" for infix_n */
+    char text[SHM_TEXT];
+} ShmRequest;
+
+/** The result of one request, in request order. */
+typedef struct {
+    uint64_t tag;
+    int64_t value;
+    /** 0 or the exit status the line would have produced */
+    int32_t status;
+    /** Base the value is meant to be printed in */
+    int32_t base;
+    /** Whether the value overflowed under a policy that keeps going */
+    int32_t overflowed;
+} ShmResponse;
+
+/** The whole shared region: requests flow client -> server, responses server -> client. */
+typedef struct {
+    atomic_uint magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t textSize;
+    /** Process id of the server, so a client can tell a region left behind by a server that died */
+    atomic_int server;
+    /** Set by the client that owns the region, so a second one is turned away */
+    atomic_uint connected;
+    /** Process id of that client, so the server can tell one that exited without closing; 0 until it connects */
+    atomic_int client;
+    /** Set by the client when it is done; the server drains the requests and exits */
+    atomic_uint closed;
+    ShmRing requests;
+    ShmRing responses;
+    ShmRequest request[SHM_SLOTS];
+    ShmResponse response[SHM_SLOTS];
+} ShmRegion;
+
+/** Function to create (server) or open (client) a named region and map it*/
+ShmRegion* shmMap(const char* name, bool create);
+/** Function to unmap a region*/
+void shmUnmap(ShmRegion* region);
+/** Function to check whether the process of a pid word is running; true while the word is 0*/
+bool shmAlive(const atomic_int* pid);
+/** Function to count the slots a consumer may read, waiting for one unless stop is set or the peer exits first*/
+uint32_t shmWaitReadable(ShmRing* ring, const atomic_uint* stop, const atomic_int* peer);
+/** Function to count the slots a producer may write, waiting for one unless stop is set or the peer exits first*/
+uint32_t shmWaitWritable(ShmRing* ring, const atomic_uint* stop, const atomic_int* peer);
+/** Function to count the slots a consumer may read without waiting*/
+uint32_t shmReadable(ShmRing* ring);
+/** Function to hand written slots to the consumer, waking it if it sleeps*/
+void shmPublish(ShmRing* ring, uint32_t count);
+/** Function to hand read slots back to the producer, waking it if it sleeps*/
+void shmConsume(ShmRing* ring, uint32_t count);
+/** Function to wake whoever sleeps on either index of a ring*/
+void shmWakeAll(ShmRing* ring);
+
+#endif /*SHM_H*/
@@ -0,0 +1,441 @@
+/**
+ * @file stream.c
+ * @author Jason Wang
+ * This program evaluates one expression of any length, such as millions of terms arriving through a pipe.
+ * Input is read in STREAM_CHUNK pieces with read(2) and consumed a character at a time by a shunting-yard
+ * evaluator: each operator is applied as soon as the operators after it show it may be, so the value and
+ * operator stacks only hold what is still open, and memory grows with the nesting depth (parentheses and
+ * chains of ^), not with the length. A literal, or the "$base" header of infix_n, may be split across reads.
+ * The expression means what it means on a single line: whitespace, newlines included, is ignored everywhere.
+*/
+#include "stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "number.h"
+#include "radix.h"
+#include "operation.h"
+
+/** Entry on the operator stack for a unary minus, which applies to the operand that follows it. */
+#define NEGATE '~'
+
+/** Binding power and associativity of a binary operator, as in infix.c. */
+typedef struct {
+    unsigned char precedence;
+    bool rightAssociative;
+} StreamOperator;
+
+/** Binary operators indexed by their character; a precedence of 0 means "not an operator". */
+static const StreamOperator OPERATORS[UCHAR_MAX + 1] = {
+    ['+'] = { 1, false },
+    ['-'] = { 1, false },
+    ['*'] = { 2, false },
+    ['/'] = { 2, false },
+    ['^'] = { 3, true },
+};
+
+/**
+ * Check for the whitespace a line would have removed.
+ * @param c the character
+ * @return true if it is ignored
+ */
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Grow a stack to twice its size in the arena. The old copy stays in the arena until the evaluation ends,
+ * so a stack never takes more than twice the memory of the deepest nesting.
+ * @param context the evaluation context
+ * @param stack the stack
+ * @param capacity its capacity in entries, doubled
+ * @param size bytes per entry
+ * @return the new stack
+ */
+static void* growStack(EvalContext* context, void* stack, size_t* capacity, size_t size)
+{
+    void* grown = contextAlloc(context, *capacity * 2 * size);
+    memcpy(grown, stack, *capacity * size);
+    *capacity *= 2;
+    return grown;
+}
+
+/**
+ * Push an operator.
+ * @param stream the stream
+ * @param op the operator, '(' or NEGATE
+ */
+static void pushOperator(Stream* stream, unsigned char op)
+{
+    if (stream->operatorCount >= stream->context->usage.maxDepth) {
+        limitTooDeep(stream->context);
+    }
+    if (stream->operatorCount == stream->operatorCapacity) {
+        stream->operators = growStack(stream->context, stream->operators, &stream->operatorCapacity, 1);
+    }
+    stream->operators[stream->operatorCount++] = op;
+    stream->exponents += op == '^';
+}
+
+/**
+ * Push a value, without applying anything to it.
+ * @param stream the stream
+ * @param value the value
+ */
+static void pushValue(Stream* stream, long value)
+{
+    if (stream->valueCount == stream->valueCapacity) {
+        stream->values = growStack(stream->context, stream->values, &stream->valueCapacity, sizeof(long));
+    }
+    stream->values[stream->valueCount++] = value;
+}
+
+/**
+ * The modulus to apply at the top of the stack: none inside an exponent.
+ * @param stream the stream
+ * @return the modulus, or NULL
+ */
+static inline const Modulus* activeModulus(const Stream* stream)
+{
+    return stream->exponents == 0 ? stream->modulus : NULL;
+}
+
+/**
+ * Pop the top operator and apply it to the values on top of the value stack.
+ * @param stream the stream
+ */
+static void applyTop(Stream* stream)
+{
+    EvalContext* context = stream->context;
+    unsigned char op = stream->operators[--stream->operatorCount];
+    stream->exponents -= op == '^';
+    limitOperation(context);
+    const Modulus* modulus = activeModulus(stream);
+    long* top = &stream->values[stream->valueCount - 1];
+    if (op == NEGATE) {
+        *top = modulus ? modApplyOp(context, modulus, 0, *top, '-') : context->overflow->ops['-'](context, 0, *top);
+        return;
+    }
+    long rhs = *top;
+    stream->valueCount--;
+    top--;
+    *top = modulus ? modApplyOp(context, modulus, *top, rhs, op) : context->overflow->ops[op](context, *top, rhs);
+}
+
+/**
+ * An operand is complete: apply the negations waiting for it, and an operator must come next.
+ * @param stream the stream
+ */
+static void operandDone(Stream* stream)
+{
+    while (stream->operatorCount > 0 && stream->operators[stream->operatorCount - 1] == NEGATE) {
+        applyTop(stream);
+    }
+    stream->expectOperand = false;
+}
+
+/**
+ * A '-' that was waiting for what follows it turns out to be a negation.
+ * @param stream the stream
+ */
+static void negatePending(Stream* stream)
+{
+    if (stream->pendingMinus) {
+        stream->pendingMinus = false;
+        pushOperator(stream, NEGATE);
+    }
+}
+
+/**
+ * Value of a literal character in the base being read.
+ * @param stream the stream
+ * @param c the character
+ * @return its value, or -1 if it cannot be part of a literal
+ */
+static inline int digitValue(const Stream* stream, char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'Z' && stream->context->program != PROGRAM_10) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Add a digit to the literal being read. A literal too large for a long fails with FAIL_OVERFLOW once it ends,
+ * so an invalid digit later in the same literal still fails with FAIL_INPUT.
+ * @param stream the stream
+ * @param digit the digit's value
+ */
+static void addDigit(Stream* stream, int digit)
+{
+    EvalContext* context = stream->context;
+    if (digit >= context->base) {
+        fail(context, FAIL_INPUT);
+    }
+    if (!stream->inLiteral) {
+        if (!stream->expectOperand) {
+            fail(context, FAIL_INPUT);
+        }
+        stream->inLiteral = true;
+        stream->negative = stream->pendingMinus;
+        stream->pendingMinus = false;
+        stream->literalOverflow = false;
+        stream->magnitude = 0;
+    }
+    stream->literalOverflow |= __builtin_mul_overflow(stream->magnitude, (unsigned long)context->base, &stream->magnitude);
+    stream->literalOverflow |= __builtin_add_overflow(stream->magnitude, (unsigned long)digit, &stream->magnitude);
+}
+
+/**
+ * The literal being read has ended: push its value.
+ * @param stream the stream
+ */
+static void endLiteral(Stream* stream)
+{
+    stream->inLiteral = false;
+    unsigned long limit = stream->negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    if (stream->literalOverflow || stream->magnitude > limit) {
+        fail(stream->context, FAIL_OVERFLOW);
+    }
+    long value = stream->negative ? (long)(0 - stream->magnitude) : (long)stream->magnitude;
+    const Modulus* modulus = activeModulus(stream);
+    pushValue(stream, modulus ? modReduce(modulus, value) : value);
+    operandDone(stream);
+}
+
+/**
+ * Consume one character of the expression that is not whitespace.
+ * @param stream the stream
+ * @param c the character
+ */
+static void consume(Stream* stream, unsigned char c)
+{
+    EvalContext* context = stream->context;
+    unsigned char last = stream->last;
+    stream->last = c;
+    // The pairs isValid and the scanner turn away on a line, in the same order of precedence
+    if (last == '^' && c == '-') {
+        fail(context, FAIL_INPUT);
+    }
+    if (last == '/' && c == '0' && context->program == PROGRAM_10) {
+        fail(context, FAIL_DIVZERO);
+    }
+
+    int digit = digitValue(stream, c);
+    if (digit >= 0) {
+        addDigit(stream, digit);
+        return;
+    }
+    if (stream->inLiteral) {
+        endLiteral(stream);
+    }
+
+    if (c == '(') {
+        if (!stream->expectOperand) {
+            fail(context, FAIL_INPUT);
+        }
+        negatePending(stream);
+        pushOperator(stream, '(');
+    } else if (c == ')') {
+        if (stream->expectOperand) {
+            // Missing operand, e.g. "()" or "2+)"
+            fail(context, FAIL_INPUT);
+        }
+        while (stream->operatorCount > 0 && stream->operators[stream->operatorCount - 1] != '(') {
+            applyTop(stream);
+        }
+        if (stream->operatorCount == 0) {
+            fail(context, FAIL_INPUT);
+        }
+        stream->operatorCount--;
+        operandDone(stream);
+    } else if (OPERATORS[c].precedence == 0) {
+        fail(context, FAIL_INPUT);
+    } else if (stream->expectOperand) {
+        if (c != '-') {
+            fail(context, FAIL_INPUT);
+        }
+        // Of "--5" the first '-' negates and the second is the sign of -5
+        negatePending(stream);
+        stream->pendingMinus = true;
+    } else {
+        StreamOperator info = OPERATORS[c];
+        while (stream->operatorCount > 0) {
+            StreamOperator top = OPERATORS[stream->operators[stream->operatorCount - 1]];
+            if (top.precedence < info.precedence || (top.precedence == info.precedence && info.rightAssociative)) {
+                break;
+            }
+            applyTop(stream);
+        }
+        pushOperator(stream, c);
+        stream->expectOperand = true;
+    }
+}
+
+/**
+ * Consume one character of an infix_n "$base" header.
+ * @param stream the stream
+ * @param c the character
+ */
+static void consumeHeader(Stream* stream, char c)
+{
+    EvalContext* context = stream->context;
+    if (stream->phase == STREAM_HEADER) {
+        if (c != '$') {
+            fail(context, FAIL_INPUT);
+        }
+        stream->phase = STREAM_BASE;
+        context->base = 0;
+    } else if (c >= '0' && c <= '9') {
+        context->base = context->base * 10 + c - '0';
+        if (context->base > RADIX_MAX_BASE) {
+            fail(context, FAIL_INPUT);
+        }
+    } else {
+        fail(context, FAIL_INPUT);
+    }
+}
+
+/**
+ * Starts an expression, resetting the context's arena, which holds the stacks.
+ * @param stream the stream
+ * @param context the evaluation context; without a header, its base must already be the base of the literals
+ * @param header true if the expression starts with an infix_n "$base" header
+ */
+void streamBegin(Stream* stream, EvalContext* context, bool header)
+{
+    arenaReset(&context->arena);
+    *stream = (Stream){
+        .context = context,
+        .modulus = context->modulus.value != 0 ? &context->modulus : NULL,
+        .phase = header ? STREAM_HEADER : STREAM_EXPRESSION,
+        .values = contextAlloc(context, STREAM_STACK * sizeof(long)),
+        .valueCapacity = STREAM_STACK,
+        .operators = contextAlloc(context, STREAM_STACK),
+        .operatorCapacity = STREAM_STACK,
+        .expectOperand = true,
+    };
+}
+
+/**
+ * Consumes the next piece of the expression. Pieces may split it anywhere, even inside a literal.
+ * @param stream the stream
+ * @param bytes the piece
+ * @param length its length
+ */
+void streamFeed(Stream* stream, const char* bytes, size_t length)
+{
+    EvalContext* context = stream->context;
+    for (size_t i = 0; i < length; i++) {
+        char c = bytes[i];
+        if (isSpace(c)) {
+            // The header's base ends at the first whitespace after it
+            if (stream->phase == STREAM_BASE) {
+                if (radixKernel(context->base) == NULL) {
+                    fail(context, FAIL_INPUT);
+                }
+                stream->phase = STREAM_EXPRESSION;
+            }
+        } else if (stream->phase == STREAM_EXPRESSION) {
+            consume(stream, c);
+        } else {
+            consumeHeader(stream, c);
+        }
+    }
+}
+
+/**
+ * Ends the expression: applies the operators still open and checks nothing is missing.
+ * @param stream the stream
+ * @return long value of the expression
+ */
+long streamEnd(Stream* stream)
+{
+    EvalContext* context = stream->context;
+    if (stream->phase != STREAM_EXPRESSION) {
+        fail(context, FAIL_INPUT);
+    }
+    if (stream->inLiteral) {
+        endLiteral(stream);
+    }
+    if (stream->expectOperand) {
+        // Empty input, or a trailing operator
+        fail(context, FAIL_INPUT);
+    }
+    while (stream->operatorCount > 0) {
+        if (stream->operators[stream->operatorCount - 1] == '(') {
+            fail(context, FAIL_INPUT);
+        }
+        applyTop(stream);
+    }
+    return stream->values[0];
+}
+
+/**
+ * Evaluates everything that can be read from a file descriptor as one expression, as the context's program
+ * would evaluate it on one line. Failures end in fail(), through the context's recovery point.
+ * @param context the evaluation context, whose base is set to the base to print the value in
+ * @param fd the file descriptor, read until end of file
+ * @return long value of the expression
+ */
+long streamEvaluate(EvalContext* context, int fd)
+{
+    context->overflowed = false;
+    context->base = context->program == PROGRAM_10 ? 10 : 32;
+    Stream stream;
+    streamBegin(&stream, context, context->program == PROGRAM_N);
+
+    char* chunk = contextAlloc(context, STREAM_CHUNK);
+    limitStart(context, 0);
+    size_t total = 0;
+    for (;;) {
+        ssize_t count = read(fd, chunk, STREAM_CHUNK);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            fail(context, FAIL_INPUT);
+        }
+        if (count == 0) {
+            break;
+        }
+        total += count;
+        if (context->limits.length != 0 && total > context->limits.length) {
+            fail(context, FAIL_LIMIT);
+        }
+        // Reading and scanning take time even without operators
+        limitReached(context);
+        streamFeed(&stream, chunk, count);
+    }
+    return streamEnd(&stream);
+}
+
+/**
+ * Evaluates all of standard input as one expression and prints the result like the single-line mode does.
+ * @param context the evaluation context
+ * @return 0 or the exit status the expression produced
+ */
+int runStream(EvalContext* context)
+{
+    jmp_buf recovery;
+    context->recovery = &recovery;
+    context->status = setjmp(recovery);
+    if (context->status == 0) {
+        long result = streamEvaluate(context, STDIN_FILENO);
+        if (context->program == PROGRAM_10) {
+            printValue(result);
+        } else {
+            convertToBase(context, result);
+        }
+        // A policy that keeps going still reports the overflow through the exit status
+        context->status = context->overflowed ? FAIL_OVERFLOW : 0;
+    }
+    context->recovery = NULL;
+    return context->status;
+}
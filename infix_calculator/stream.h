@@ -0,0 +1,60 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "context.h"
+
+/** Bytes requested per read of standard input. */
+#define STREAM_CHUNK 65536
+
+/** Stack entries allocated at first; the stacks double when a deeper nesting needs more. */
+#define STREAM_STACK 64
+
+/** Where the reader is in the input. */
+typedef enum {
+    /** Before the '$' of an infix_n header */
+    STREAM_HEADER,
+    /** In the digits of the header's base */
+    STREAM_BASE,
+    /** In the expression */
+    STREAM_EXPRESSION,
+} StreamPhase;
+
+/** Everything carried from one character, and one read, to the next. */
+typedef struct {
+    EvalContext* context;
+    /** The modulus of --mod, or NULL */
+    const Modulus* modulus;
+    StreamPhase phase;
+    long* values;
+    size_t valueCount;
+    size_t valueCapacity;
+    unsigned char* operators;
+    size_t operatorCount;
+    size_t operatorCapacity;
+    /** Number of '^' on the operator stack; under one, arithmetic is ordinary even with a modulus, as exponents are */
+    int exponents;
+    /** True where an operand must come next, false where an operator or ')' must */
+    bool expectOperand;
+    /** A '-' where an operand was expected: the sign of a literal if a digit follows, a negation otherwise */
+    bool pendingMinus;
+    /** A literal is being read */
+    bool inLiteral;
+    bool negative;
+    bool literalOverflow;
+    unsigned long magnitude;
+    /** The character before this one, whitespace aside */
+    unsigned char last;
+} Stream;
+
+/** Function to start evaluating an expression fed in pieces*/
+void streamBegin(Stream* stream, EvalContext* context, bool header);
+/** Function to consume the next piece of an expression*/
+void streamFeed(Stream* stream, const char* bytes, size_t length);
+/** Function to finish an expression and return its value*/
+long streamEnd(Stream* stream);
+/** Function to evaluate all of a file descriptor as one expression, read in chunks, failing through fail()*/
+long streamEvaluate(EvalContext* context, int fd);
+/** Function to evaluate all of standard input as one expression and print the result*/
+int runStream(EvalContext* context);
+
+#endif /*STREAM_H*/
@@ -117,6 +117,26 @@ if [ -x infix_10 ] ; then
     testinfix_10 14 101
     testinfix_10 15 0
     testinfix_10 16 100
+    testinfix_10 17 0
+    testinfix_10 18 0
+    testinfix_10 19 100
+    testinfix_10 20 0
+    testinfix_10 21 0
+    testinfix_10 22 100
+
+    echo "Test single line: ./infix_10 with a 40000-byte line, then under --limit length=100"
+    head -c 40000 /dev/zero | tr '\0' '1' > output-long.txt
+    ./infix_10 < output-long.txt > output.txt 2> /dev/null
+    STATUS=$?
+    ./infix_10 --limit length=100 < output-long.txt > output.txt 2> /dev/null
+    LIMITED=$?
+    if [ $STATUS -ne 102 ] || [ $LIMITED -ne 104 ]; then
+        echo "**** FAILED - Expected exit statuses of 102 and 104, but got: $STATUS and $LIMITED"
+        FAIL=1
+    else
+        echo "PASS"
+    fi
+    rm -f output-long.txt
 else
     echo "**** Your infix_10 program couldn't be tested since it didn't compile successfully."
     FAIL=1
@@ -143,6 +163,7 @@ if [ -x infix_32 ] ; then
     testinfix_32 09 100
     testinfix_32 10 100
     testinfix_32 11 102
+    testinfix_32 12 0
 else
     echo "**** Your infix_32 program couldn't be tested since it didn't compile successfully."
     FAIL=1
@@ -168,12 +189,548 @@ if [ -x infix_n ] ; then
     testinfix_n 08 102
     testinfix_n 09 102
     testinfix_n 10 0
+    testinfix_n 11 0
+    testinfix_n 12 100
 else
     echo "**** Your infix_n program couldn't be tested since it didn't compile successfully."
     FAIL=1
 
 fi
 
+# Pipeline mode: one output line per input line, exit status of the first failing line
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test pipeline: ./infix_10 --pipeline 2 < input-10-pipeline.txt > output.txt"
+  ./infix_10 --pipeline 2 < input-10-pipeline.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-pipeline.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Postfix mode: the same values and exit statuses as infix, in every program
+if [ -x infix_10 ] && [ -x infix_n ] ; then
+  rm -f output.txt
+  echo "Test rpn: ./infix_10 --rpn --pipeline 1 < input-10-rpn.txt > output.txt"
+  ./infix_10 --rpn --pipeline 1 < input-10-rpn.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-rpn.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test rpn: ./infix_n --rpn against ./infix_n on the same expression"
+  if [ "$(echo '$16 A 5 + 2 *' | ./infix_n --rpn)" != "$(echo '$16 (A + 5) * 2' | ./infix_n)" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Worker mode: the same output as pipeline mode, and a worker that crashes costs only the line it was on
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test workers: ./infix_10 --workers 2 < input-10-pipeline.txt > output.txt"
+  ./infix_10 --workers 2 < input-10-pipeline.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-pipeline.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test workers: a line nested too deeply for a 64 KiB stack in ./infix_10 --workers 2"
+  (ulimit -s 64; awk 'BEGIN { print "1 + 1"; for (i = 0; i < 4990; i++) printf "("; printf "1"; for (i = 0; i < 4990; i++) printf ")"; print ""; print "2 * 3"; }' | ./infix_10 --workers 2 > output.txt)
+  STATUS=$?
+  if [ $STATUS -ne 139 ]; then
+      echo "**** FAILED - Expected an exit status of 139, but got: $STATUS"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "$(printf '2\nerror 139\n6')" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Reduce mode: only the aggregate and the per-status counts are printed, and the exit status is the pipeline's
+if [ -x infix_10 ] ; then
+  echo "Test reduce: ./infix_10 --reduce histogram 2 < input-10-pipeline.txt > output.txt"
+  ./infix_10 --reduce histogram 2 < input-10-pipeline.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-reduce.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Script mode: assignments and expressions in one process, and a variable read before it is assigned
+if [ -x infix_n ] ; then
+  echo "Test script: ./infix_n --script < input-n-script.txt > output.txt"
+  ./infix_n --script < input-n-script.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-n-script.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test script: undefined variable in ./infix_n --script"
+  printf '$10\nx = 1\ny + x\n' | ./infix_n --script > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 102 ]; then
+      echo "**** FAILED - Expected an exit status of 102, but got: $STATUS"
+      FAIL=1
+  elif [ -s output.txt ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test script: variables in exponents under ./infix_10 --mod 7 --script"
+  printf 'x = 10; 2^x; 2^10\ny = 99999999999*99999999999; y; 2^y\n' | ./infix_10 --mod 7 --script > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "$(printf '2\n2\n2')" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test script: 2000000 nested parentheses in ./infix_10 --script"
+  awk 'BEGIN { for (i = 0; i < 2000000; i++) printf "("; printf "1"; for (i = 0; i < 2000000; i++) printf ")"; print ""; }' | ./infix_10 --script > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 104 ]; then
+      echo "**** FAILED - Expected an exit status of 104, but got: $STATUS"
+      FAIL=1
+  elif [ -s output.txt ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Latency report: results are unchanged and standard error counts every evaluated line
+if [ -x infix_10 ] ; then
+  rm -f output.txt output-latency.txt
+  echo "Test latency: ./infix_10 --latency --pipeline 2 < input-10-pipeline.txt > output.txt 2> output-latency.txt"
+  ./infix_10 --latency --pipeline 2 < input-10-pipeline.txt > output.txt 2> output-latency.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-pipeline.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  elif [ "$(awk '$1 == "all" { print $2 }' output-latency.txt)" != "$(wc -l < expected-10-pipeline.txt | tr -d ' ')" ] ; then
+      echo "**** FAILED - latency report didn't count every line."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-latency.txt
+fi
+
+# Capture and replay: capturing leaves results unchanged, and replaying the log reproduces every one of them
+if [ -x infix_10 ] ; then
+  rm -f output.txt output-capture.log
+  echo "Test capture: ./infix_10 --capture output-capture.log --overflow wrap --pipeline 2 < input-10-overflow.txt > output.txt"
+  ./infix_10 --capture output-capture.log --overflow wrap --pipeline 2 < input-10-overflow.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-overflow-wrap.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test replay: ./infix_10 --replay output-capture.log fast > output.txt"
+  ./infix_10 --replay output-capture.log fast > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif ! grep -q "^8 expressions replayed back to back in .*, 0 differ$" output.txt ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test replay: a log captured with --limit operations=2, replayed without it"
+  printf '1+1+1+1+1\n1+1\n' | ./infix_10 --limit operations=2 --capture output-limit.log --pipeline 1 > /dev/null
+  ./infix_10 --replay output-limit.log fast > output.txt
+  STATUS=$?
+  rm -f output-limit.log
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif ! grep -q "^2 expressions replayed back to back in .*, 0 differ$" output.txt ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test replay: ./infix_10 --replay of a log whose record is longer than a line may be"
+  head -c 56 output-capture.log > output-long.log
+  { printf '\000\300\232\014'; head -c 200000 /dev/zero | tr '\0' '1'; printf '\000\012\000\000'; } >> output-long.log
+  ./infix_10 --replay output-long.log fast > output.txt 2> /dev/null
+  STATUS=$?
+  if [ $STATUS -ne 102 ]; then
+      echo "**** FAILED - Expected an exit status of 102, but got: $STATUS"
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-capture.log output-long.log
+fi
+
+# Compiled files: loading reproduces the pipeline's output under the settings given then, and a damaged file is refused
+if [ -x infix_10 ] ; then
+  rm -f output.txt output-compiled.bin
+  echo "Test compiled: ./infix_10 --compile output-compiled.bin < input-10-overflow.txt, then --overflow wrap --load output-compiled.bin"
+  ./infix_10 --compile output-compiled.bin < input-10-overflow.txt
+  ./infix_10 --overflow wrap --load output-compiled.bin > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-overflow-wrap.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test compiled: ./infix_10 --load of a file with one byte changed"
+  printf 'X' | dd of=output-compiled.bin bs=1 seek=44 conv=notrunc 2>/dev/null
+  ./infix_10 --load output-compiled.bin > output.txt 2>/dev/null
+  STATUS=$?
+  if [ $STATUS -ne 102 ]; then
+      echo "**** FAILED - Expected an exit status of 102, but got: $STATUS"
+      FAIL=1
+  elif [ -s output.txt ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-compiled.bin
+fi
+
+# Modular mode: every operation modulo a prime, division by inverse, exponents kept whole
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test modular: ./infix_10 --mod 1000000007 --pipeline 2 < input-10-mod.txt > output.txt"
+  ./infix_10 --mod 1000000007 --pipeline 2 < input-10-mod.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 101 ]; then
+      echo "**** FAILED - Expected an exit status of 101, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-mod.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Overflow policies: overflowing lines keep a wrapped or saturated value and are flagged
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test overflow wrap: ./infix_10 --overflow wrap --pipeline 2 < input-10-overflow.txt > output.txt"
+  ./infix_10 --overflow wrap --pipeline 2 < input-10-overflow.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-overflow-wrap.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test overflow saturate: ./infix_10 --overflow saturate --pipeline 2 < input-10-overflow.txt > output.txt"
+  ./infix_10 --overflow saturate --pipeline 2 < input-10-overflow.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-10-overflow-saturate.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# File mode: one "filename<TAB>result<TAB>status" line per file
+if [ -x infix_n ] ; then
+  rm -f output.txt
+  echo "Test files: ./infix_n --files input-n-01.txt input-n-02.txt input-n-03.txt input-n-05.txt > output.txt"
+  ./infix_n --files input-n-01.txt input-n-02.txt input-n-03.txt input-n-05.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 100 ]; then
+      echo "**** FAILED - Expected an exit status of 100, but got: $STATUS"
+      FAIL=1
+  elif ! diff -q expected-n-files.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Stress: many evaluator threads at once, each line in a different base and some failing part way through;
+# every thread has its own context, so the result must match evaluating the same lines on one thread
+if [ -x infix_n ] ; then
+  rm -f output.txt output-serial.txt input-stress.txt
+  awk 'BEGIN {
+    srand(38);
+    digits = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+    ops = "+-*/^";
+    for (line = 0; line < 20000; line++) {
+      base = 2 + line % 31;
+      text = "$" base;
+      terms = 1 + int(rand() * 4);
+      for (t = 0; t < terms; t++) {
+        if (t > 0) text = text " " substr(ops, 1 + int(rand() * 5), 1);
+        literal = "";
+        size = 1 + int(rand() * 6);
+        for (d = 0; d < size; d++) literal = literal substr(digits, 1 + int(rand() * base), 1);
+        text = text " " literal;
+      }
+      print text;
+    }
+  }' > input-stress.txt
+  echo "Test stress: ./infix_n --pipeline 16 < input-stress.txt against ./infix_n --pipeline 1"
+  ./infix_n --pipeline 1 < input-stress.txt > output-serial.txt
+  SERIAL=$?
+  ./infix_n --pipeline 16 < input-stress.txt > output.txt
+  STATUS=$?
+  if [ $STATUS -ne $SERIAL ]; then
+      echo "**** FAILED - Expected an exit status of $SERIAL, but got: $STATUS"
+      FAIL=1
+  elif [ $(wc -l < output.txt) -ne 20000 ] || ! diff -q output-serial.txt output.txt >/dev/null 2>&1 ; then
+      echo "**** FAILED - output didn't match the single-threaded output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-serial.txt input-stress.txt
+fi
+
+# Streaming and parallel modes: one expression far longer than a line, piped through in many reads or split across threads
+if [ -x infix_10 ] ; then
+  echo "Test stream: 1000000 terms piped to ./infix_10 --stream"
+  awk 'BEGIN { print "0"; for (i = 0; i < 1000000; i++) print "+ 12 - 5 * (3 - 2)"; }' | ./infix_10 --stream > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "7000000" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test parallel: 1000000 terms in a file, ./infix_10 --parallel FILE 4"
+  awk 'BEGIN { print "0"; for (i = 0; i < 1000000; i++) print "+ 12 - 5 * (3 - 2)"; }' > parallel-input.txt
+  ./infix_10 --parallel parallel-input.txt 4 > output.txt
+  STATUS=$?
+  rm -f parallel-input.txt
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "7000000" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Limits: a nesting or operation cap fails that evaluation with 104 and leaves expressions within the caps alone
+if [ -x infix_10 ] ; then
+  rm -f output.txt
+  echo "Test limit: 60 nested parentheses with ./infix_10 --limit depth=50"
+  awk 'BEGIN { for (i = 0; i < 60; i++) printf "("; printf "1"; for (i = 0; i < 60; i++) printf ")"; print ""; }' | ./infix_10 --limit depth=50 > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 104 ]; then
+      echo "**** FAILED - Expected an exit status of 104, but got: $STATUS"
+      FAIL=1
+  elif [ -s output.txt ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test limit: ./infix_10 --limit operations=2 --pipeline 1"
+  printf '1 + 2 * 3\n1 + 2 + 3 + 4\n(((4)))\n' | ./infix_10 --limit operations=2 --limit depth=3 --pipeline 1 > output.txt
+  STATUS=$?
+  if [ $STATUS -ne 104 ]; then
+      echo "**** FAILED - Expected an exit status of 104, but got: $STATUS"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "$(printf '7\nerror 104\n4')" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test limit: ./infix_10 --limit operations=COUNT --parallel FILE 4 caps the whole file, as one thread would"
+  awk 'BEGIN { for (i = 0; i < 2000000; i++) printf "1+"; print "1"; }' > parallel-input.txt
+  ./infix_10 --limit operations=2000000 --parallel parallel-input.txt 4 > /dev/null
+  STATUS=$?
+  ./infix_10 --limit operations=2000001 --parallel parallel-input.txt 4 > output.txt
+  WITHIN=$?
+  rm -f parallel-input.txt
+  if [ $STATUS -ne 104 ] || [ $WITHIN -ne 0 ]; then
+      echo "**** FAILED - Expected exit statuses of 104 and 0, but got: $STATUS and $WITHIN"
+      FAIL=1
+  elif [ "$(cat output.txt)" != "2000001" ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Shared-memory mode: the load test checks every result it gets back and closing it stops the server
+echo "Building infix_load with make"
+make infix_load
+if [ $? -ne 0 ]; then
+    echo "**** Make didn't run succesfully when trying to build infix_load."
+    FAIL=1
+fi
+
+if [ -x infix_n ] && [ -x infix_load ] ; then
+  echo "Test shm: ./infix_n --shm /infix-test-$$ with ./infix_load /infix-test-$$ 20000 64"
+  ./infix_n --shm /infix-test-$$ &
+  SERVER=$!
+  ./infix_load /infix-test-$$ 20000 64 > output.txt
+  STATUS=$?
+  wait $SERVER
+  SERVERSTATUS=$?
+  if [ $STATUS -ne 0 ] || [ $SERVERSTATUS -ne 0 ]; then
+      echo "**** FAILED - Expected exit statuses of 0, but got: $STATUS from the load test and $SERVERSTATUS from the server"
+      FAIL=1
+  elif ! grep -q "^20000 requests, 64 in flight: .* 0 wrong$" output.txt ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test shm: a second ./infix_n --shm /infix-test-$$ while the first runs, then a client killed mid-run"
+  ./infix_n --shm /infix-test-$$ 2> /dev/null &
+  SERVER=$!
+  ./infix_load /infix-test-$$ 100000000 64 > /dev/null 2>&1 &
+  CLIENT=$!
+  sleep 0.3
+  ./infix_n --shm /infix-test-$$ 2> /dev/null
+  SECONDSTATUS=$?
+  kill -9 $CLIENT
+  wait $CLIENT 2> /dev/null
+  wait $SERVER 2> /dev/null
+  SERVERSTATUS=$?
+  if [ $SECONDSTATUS -ne 102 ] || [ $SERVERSTATUS -ne 102 ]; then
+      echo "**** FAILED - Expected exit statuses of 102, but got: $SECONDSTATUS from the second server and $SERVERSTATUS from the first"
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+fi
+
+# Binary column mode is the same in every program, so it is only tested with infix_10
+if [ -x infix_10 ] ; then
+  rm -f output.txt output-status.txt
+  echo "Test columns: ./infix_10 --columns / input-columns-left.bin input-columns-right.bin output.txt output-status.txt"
+  ./infix_10 --columns / input-columns-left.bin input-columns-right.bin output.txt output-status.txt
+  STATUS=$?
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif ! cmp -s expected-columns-result.bin output.txt || ! cmp -s expected-columns-status.bin output-status.txt ; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+
+  echo "Test columns: ./infix_10 --mod 7 --columns / input-columns-left.bin input-columns-right.bin output.txt output-status.txt"
+  ./infix_10 --mod 7 --columns / input-columns-left.bin input-columns-right.bin output.txt output-status.txt
+  STATUS=$?
+  if [ $STATUS -ne 0 ]; then
+      echo "**** FAILED - Expected an exit status of 0, but got: $STATUS"
+      FAIL=1
+  elif [ "$(od -An -v -td8 -w8 output.txt | tr -d ' ' | tr '\n' ' ')" != "0 0 0 6 4 1 " ] \
+       || [ "$(od -An -v -tu1 -w1 output-status.txt | tr -d ' ' | tr '\n' ' ')" != "0 0 101 0 0 0 " ]; then
+      echo "**** FAILED - output didn't match expected output."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-status.txt
+
+  echo "Test columns: an operand column as the result, then a bad operator, with ./infix_10 --columns"
+  cp input-columns-left.bin output-left.bin
+  ./infix_10 --columns + output-left.bin input-columns-right.bin output-left.bin output-status.txt 2> /dev/null
+  STATUS=$?
+  ./infix_10 --columns x input-columns-left.bin input-columns-right.bin output-result.bin output-status.txt 2> /dev/null
+  OPSTATUS=$?
+  if [ $STATUS -ne 102 ] || [ $OPSTATUS -ne 102 ]; then
+      echo "**** FAILED - Expected exit statuses of 102 and 102, but got: $STATUS and $OPSTATUS"
+      FAIL=1
+  elif ! cmp -s input-columns-left.bin output-left.bin || [ -e output-result.bin ] || [ -e output-status.txt ]; then
+      echo "**** FAILED - a column file was truncated or created."
+      FAIL=1
+  else
+      echo "PASS"
+  fi
+  rm -f output-left.bin output-result.bin output-status.txt
+fi
+
 if [ $FAIL -ne 0 ]; then
   echo "**** There were failing tests"
   exit 1
@@ -0,0 +1,163 @@
+/** 
+ * @file uring.c
+ * @author Jason Wang
+ * This program is a minimal io_uring wrapper over the raw system calls, so no liburing is needed:
+ * it maps the submission and completion rings, prepares reads, submits them in batches and reaps completions.
+*/
+#include "uring.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/**
+ * Creates an io_uring.
+ * @param ring the ring to set up
+ * @param entries submission queue size, rounded up to a power of two by the kernel
+ * @return 0, or -1 if io_uring is unavailable (old kernel, or blocked by a sandbox)
+ */
+int uringInit(Uring* ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+#ifdef __NR_io_uring_setup
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+#else
+    ring->fd = -1;
+#endif
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            munmap(ring->sqRing, ring->sqRingSize);
+            close(ring->fd);
+            return -1;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cqRing != ring->sqRing) {
+            munmap(ring->cqRing, ring->cqRingSize);
+        }
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(ring->fd);
+        return -1;
+    }
+
+    char* sq = ring->sqRing;
+    char* cq = ring->cqRing;
+    ring->entries = params.sq_entries;
+    ring->sqHead = (unsigned*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * Unmaps the rings and closes the io_uring.
+ * @param ring the ring
+ */
+void uringDestroy(Uring* ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+/**
+ * Prepares a read of size bytes at offset of fd into buffer.
+ * @param ring the ring
+ * @param fd the file
+ * @param buffer where to read to
+ * @param size how many bytes
+ * @param offset where in the file
+ * @param userData handed back with the completion
+ * @return false if the submission queue is full
+ */
+bool uringQueueRead(Uring* ring, int fd, void* buffer, unsigned size, unsigned long long offset, unsigned long long userData)
+{
+    unsigned tail = *ring->sqTail;
+    unsigned head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->entries) {
+        return false;
+    }
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buffer;
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = userData;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->unsubmitted++;
+    return true;
+}
+
+/**
+ * Hands every prepared entry to the kernel with one system call and waits for completions.
+ * @param ring the ring
+ * @param waitFor how many completions to wait for, 0 to not wait
+ * @return 0, or -1 on error
+ */
+int uringSubmit(Uring* ring, unsigned waitFor)
+{
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int submitted = syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, waitFor, flags, NULL, 0);
+    if (submitted < 0) {
+        return -1;
+    }
+    ring->unsubmitted -= submitted;
+    return 0;
+}
+
+/**
+ * Takes the oldest completion.
+ * @param ring the ring
+ * @param userData set to the value given when the read was queued
+ * @param result set to the byte count read, or a negative errno
+ * @return false if no completion is waiting
+ */
+bool uringReap(Uring* ring, unsigned long long* userData, int* result)
+{
+    unsigned head = *ring->cqHead;
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+    *userData = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
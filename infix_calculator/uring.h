@@ -0,0 +1,41 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/** An io_uring instance with its submission and completion rings mapped. */
+typedef struct {
+    int fd;
+    unsigned entries;
+    /** Entries prepared but not yet handed to the kernel */
+    unsigned unsubmitted;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+} Uring;
+
+/** Function to set up an io_uring with room for entries submissions*/
+int uringInit(Uring* ring, unsigned entries);
+/** Function to tear down an io_uring*/
+void uringDestroy(Uring* ring);
+/** Function to prepare a read; it is not submitted until uringSubmit*/
+bool uringQueueRead(Uring* ring, int fd, void* buffer, unsigned size, unsigned long long offset, unsigned long long userData);
+/** Function to submit the prepared entries and wait for at least waitFor completions*/
+int uringSubmit(Uring* ring, unsigned waitFor);
+/** Function to take one completion if there is one*/
+bool uringReap(Uring* ring, unsigned long long* userData, int* result);
+
+#endif /*URING_H*/
@@ -0,0 +1,616 @@
+/**
+ * @file workers.c
+ * @author Jason Wang
+ * This program evaluates a stream of expressions, one per line, in pre-forked worker processes instead of threads,
+ * so an evaluation that crashes or exits takes out one worker rather than the run. The coordinator (the calling
+ * process) splits standard input into lines, sends each down a pipe to the worker with the least work in flight,
+ * reads the answers back from another pipe and prints them in input order, as pipeline mode does.
+ * Each worker notes in memory shared with the coordinator which line it is evaluating. When one dies, that line
+ * gets the worker's exit status, or 128 plus the signal that killed it, as its own status; the worker is replaced
+ * and its other unanswered lines are sent again.
+*/
+#include "workers.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "radix.h"
+#include "operation.h"
+
+/** Bytes of formatted output collected before each write. */
+#define WRITE_CHUNK 65536
+
+/** Where a worker has got to, in lines counted from 1 since it started. */
+typedef struct {
+    /** The line being evaluated, or the last one evaluated */
+    atomic_uint_fast64_t started;
+    /** The last line evaluated */
+    atomic_uint_fast64_t finished;
+} WorkerProgress;
+
+/** A line of input, from when it is read until it is printed. */
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+    bool done;
+    int status;
+    long result;
+    int base;
+    bool overflowed;
+} Line;
+
+/** The coordinator's view of one worker process. */
+typedef struct {
+    pid_t pid;
+    /** Write end of the pipe the worker reads lines from */
+    int requests;
+    /** Read end of the pipe the worker writes a WorkerResult per line to */
+    int responses;
+    /** Sequence numbers of the lines sent and not yet answered, oldest first */
+    uint64_t queue[WORKER_WINDOW];
+    int head;
+    int count;
+    /** Bytes of the lines in the queue, newlines included */
+    size_t bytes;
+    /** Lines answered since the worker started */
+    uint64_t answered;
+    /** Start of a WorkerResult whose rest has not arrived yet */
+    unsigned char partial[sizeof(WorkerResult)];
+    size_t partialLength;
+} Worker;
+
+/** Everything the coordinator keeps. */
+typedef struct {
+    LineEvaluator evaluate;
+    const EvalContext* settings;
+    Worker* workers;
+    int count;
+    /** Progress of each worker, in memory shared with the worker processes */
+    WorkerProgress* progress;
+    /** Lines read and not yet printed, at their sequence number modulo capacity */
+    Line* lines;
+    size_t capacity;
+    /** Sequence number of the next line read */
+    uint64_t nextLine;
+    /** Sequence number of the next line printed */
+    uint64_t nextOutput;
+    /** Lines to send: new ones, and the unanswered lines of workers that died */
+    uint64_t* waiting;
+    size_t waitingHead;
+    size_t waitingCount;
+    /** Standard input not yet split into lines */
+    char* input;
+    size_t inputStart;
+    size_t inputEnd;
+    bool inputEnded;
+    /** Whether the rest of the current line is being dropped for being too long */
+    bool tooLong;
+} Coordinator;
+
+/**
+ * Write all of a buffer to a file descriptor.
+ * @param fd the file descriptor
+ * @param data the bytes
+ * @param size how many
+ * @return true if all were written
+ */
+static bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * Body of a worker process: evaluates the lines arriving on one pipe and answers each on the other, until the
+ * coordinator closes its end. The shared progress is updated around every line, which costs two stores.
+ * @param coordinator the coordinator, as it was when the worker was forked
+ * @param index the worker's index
+ * @param requests the pipe lines arrive on
+ * @param responses the pipe answers go to
+ */
+static void __attribute__((noreturn)) workerMain(const Coordinator* coordinator, int index, int requests, int responses)
+{
+    // Latency histograms would stay in this process, so workers do not record them
+    EvalContext settings = *coordinator->settings;
+    settings.report = NULL;
+    EvalContext context;
+    contextInitFrom(&context, &settings);
+    WorkerProgress* progress = &coordinator->progress[index];
+    char* buffer = malloc(WORKER_BYTES);
+    WorkerResult* results = malloc(WORKER_WINDOW * sizeof(WorkerResult));
+    if (buffer == NULL || results == NULL) {
+        _exit(FAIL_INPUT);
+    }
+
+    // The coordinator never has more than WORKER_BYTES of lines in flight, so a partial line always fits
+    size_t used = 0;
+    uint64_t number = 0;
+    for (;;) {
+        ssize_t n = read(requests, buffer + used, WORKER_BYTES - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        used += n;
+        int answers = 0;
+        char* line = buffer;
+        char* newline;
+        while ((newline = memchr(line, '\n', buffer + used - line)) != NULL) {
+            *newline = '\0';
+            atomic_store_explicit(&progress->started, ++number, memory_order_relaxed);
+            long result = 0;
+            int status = coordinator->evaluate(&context, line, &result);
+            atomic_store_explicit(&progress->finished, number, memory_order_relaxed);
+            results[answers++] = (WorkerResult){
+                .result = result, .status = status, .base = (uint8_t)context.base, .overflowed = context.overflowed
+            };
+            line = newline + 1;
+        }
+        writeAll(responses, results, answers * sizeof(WorkerResult));
+        used = buffer + used - line;
+        memmove(buffer, line, used);
+    }
+    contextFree(&context);
+    _exit(0);
+}
+
+/**
+ * Fork a worker into a slot whose previous worker, if any, has been reaped.
+ * @param coordinator the coordinator
+ * @param index the slot
+ * @return 0, or -1 if the pipes or the process could not be created
+ */
+static int spawnWorker(Coordinator* coordinator, int index)
+{
+    int requests[2];
+    int responses[2];
+    if (pipe(requests) != 0) {
+        return -1;
+    }
+    if (pipe(responses) != 0) {
+        close(requests[0]);
+        close(requests[1]);
+        return -1;
+    }
+    atomic_store(&coordinator->progress[index].started, 0);
+    atomic_store(&coordinator->progress[index].finished, 0);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(requests[0]);
+        close(requests[1]);
+        close(responses[0]);
+        close(responses[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        // Only the coordinator may hold the other workers' pipes, or they would never see the end of their lines
+        for (int i = 0; i < coordinator->count; i++) {
+            if (i != index && coordinator->workers[i].pid > 0) {
+                close(coordinator->workers[i].requests);
+                close(coordinator->workers[i].responses);
+            }
+        }
+        close(requests[1]);
+        close(responses[0]);
+        workerMain(coordinator, index, requests[0], responses[1]);
+    }
+    close(requests[0]);
+    close(responses[1]);
+    coordinator->workers[index] = (Worker){ .pid = pid, .requests = requests[1], .responses = responses[0] };
+    return 0;
+}
+
+/**
+ * Record how a line came out.
+ * @param line the line
+ * @param status 0 or the exit status
+ * @param result the value, when status is 0
+ * @param base its base
+ * @param overflowed whether a policy that keeps going overflowed
+ */
+static void finishLine(Line* line, int status, long result, int base, bool overflowed)
+{
+    line->done = true;
+    line->status = status;
+    line->result = result;
+    line->base = base;
+    line->overflowed = overflowed;
+}
+
+/**
+ * Queue a line to be sent to a worker.
+ * @param coordinator the coordinator
+ * @param sequence the line's sequence number
+ */
+static void pushWaiting(Coordinator* coordinator, uint64_t sequence)
+{
+    coordinator->waiting[(coordinator->waitingHead + coordinator->waitingCount++) % coordinator->capacity] = sequence;
+}
+
+/**
+ * Reap a worker that died and start another in its place. The line it was evaluating gets its exit status, or
+ * 128 plus the signal that killed it, like a shell reports; so does its first line if it died before starting one.
+ * Its other unanswered lines are queued again, those it finished included, since their answers were lost.
+ * @param coordinator the coordinator
+ * @param index the worker's slot
+ * @return 0, or -1 if no new worker could be started
+ */
+static int replaceWorker(Coordinator* coordinator, int index)
+{
+    Worker* worker = &coordinator->workers[index];
+    close(worker->requests);
+    close(worker->responses);
+    int how = 0;
+    while (waitpid(worker->pid, &how, 0) < 0 && errno == EINTR) {
+    }
+    worker->pid = 0;
+
+    uint64_t started = atomic_load(&coordinator->progress[index].started);
+    uint64_t finished = atomic_load(&coordinator->progress[index].finished);
+    uint64_t culprit = started > finished ? started : started == 0 ? 1 : 0;
+    int status = FAIL_INPUT;
+    if (WIFSIGNALED(how)) {
+        status = 128 + WTERMSIG(how);
+    } else if (WIFEXITED(how) && WEXITSTATUS(how) != 0) {
+        status = WEXITSTATUS(how);
+    }
+    for (int k = 0; k < worker->count; k++) {
+        uint64_t sequence = worker->queue[(worker->head + k) % WORKER_WINDOW];
+        if (worker->answered + k + 1 == culprit) {
+            finishLine(&coordinator->lines[sequence % coordinator->capacity], status, 0, 0, false);
+        } else {
+            pushWaiting(coordinator, sequence);
+        }
+    }
+    return spawnWorker(coordinator, index);
+}
+
+/**
+ * Read what a worker has answered and record it against the lines it was sent.
+ * @param coordinator the coordinator
+ * @param worker the worker, whose response pipe is readable
+ * @return false if the worker has died
+ */
+static bool readResults(Coordinator* coordinator, Worker* worker)
+{
+    unsigned char buffer[WORKER_WINDOW * sizeof(WorkerResult)];
+    memcpy(buffer, worker->partial, worker->partialLength);
+    ssize_t n = read(worker->responses, buffer + worker->partialLength, sizeof(buffer) - worker->partialLength);
+    if (n < 0 && errno == EINTR) {
+        return true;
+    }
+    if (n <= 0) {
+        return false;
+    }
+    size_t available = worker->partialLength + n;
+    size_t used = 0;
+    while (available - used >= sizeof(WorkerResult) && worker->count > 0) {
+        WorkerResult result;
+        memcpy(&result, buffer + used, sizeof(WorkerResult));
+        used += sizeof(WorkerResult);
+        Line* line = &coordinator->lines[worker->queue[worker->head] % coordinator->capacity];
+        worker->head = (worker->head + 1) % WORKER_WINDOW;
+        worker->count--;
+        worker->bytes -= line->length + 1;
+        worker->answered++;
+        finishLine(line, result.status, (long)result.result, result.base, result.overflowed);
+    }
+    worker->partialLength = available - used;
+    memcpy(worker->partial, buffer + used, worker->partialLength);
+    return true;
+}
+
+/**
+ * Send waiting lines, each to the worker with the fewest lines in flight, while any worker has room for them.
+ * @param coordinator the coordinator
+ */
+static void dispatch(Coordinator* coordinator)
+{
+    while (coordinator->waitingCount > 0) {
+        uint64_t sequence = coordinator->waiting[coordinator->waitingHead];
+        Line* line = &coordinator->lines[sequence % coordinator->capacity];
+        Worker* best = NULL;
+        for (int i = 0; i < coordinator->count; i++) {
+            Worker* worker = &coordinator->workers[i];
+            if (worker->count < WORKER_WINDOW && worker->bytes + line->length + 1 <= WORKER_BYTES
+                && (best == NULL || worker->count < best->count)) {
+                best = worker;
+            }
+        }
+        if (best == NULL) {
+            return;
+        }
+        coordinator->waitingHead = (coordinator->waitingHead + 1) % coordinator->capacity;
+        coordinator->waitingCount--;
+        // A worker that died is noticed on its response pipe, and this line is sent again then
+        writeAll(best->requests, line->text, line->length + 1);
+        best->queue[(best->head + best->count) % WORKER_WINDOW] = sequence;
+        best->count++;
+        best->bytes += line->length + 1;
+    }
+}
+
+/**
+ * Check whether a line has anything but whitespace; blank lines are skipped like scanf(" %[^\n]") does.
+ * @param line the line
+ * @param length its length
+ * @return true if the line is blank
+ */
+static bool isBlank(const char* line, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '\v' && line[i] != '\f') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Take the next complete line of the input read so far and give it a sequence number, or skip it if it is blank.
+ * A line too long to evaluate is finished with FAIL_INPUT at once. There must be room for another line.
+ * @param coordinator the coordinator
+ * @return true if anything was taken, false if more input is needed or there is none
+ */
+static bool takeLine(Coordinator* coordinator)
+{
+    char* start = coordinator->input + coordinator->inputStart;
+    size_t available = coordinator->inputEnd - coordinator->inputStart;
+    char* newline = memchr(start, '\n', available);
+    if (newline == NULL && !coordinator->inputEnded) {
+        if (available >= MAX_SIZE) {
+            coordinator->tooLong = true;
+            coordinator->inputStart = coordinator->inputEnd = 0;
+        }
+        return false;
+    }
+    if (newline == NULL && available == 0 && !coordinator->tooLong) {
+        return false;
+    }
+    size_t length = newline != NULL ? (size_t)(newline - start) : available;
+    coordinator->inputStart += length + (newline != NULL);
+    if (!coordinator->tooLong && length < MAX_SIZE && isBlank(start, length)) {
+        return true;
+    }
+
+    uint64_t sequence = coordinator->nextLine++;
+    Line* line = &coordinator->lines[sequence % coordinator->capacity];
+    line->length = length;
+    if (coordinator->tooLong || length >= MAX_SIZE) {
+        coordinator->tooLong = false;
+        finishLine(line, FAIL_INPUT, 0, 0, false);
+        return true;
+    }
+    if (line->capacity < length + 1) {
+        char* text = realloc(line->text, length + 1);
+        if (text == NULL) {
+            finishLine(line, FAIL_INPUT, 0, 0, false);
+            return true;
+        }
+        line->text = text;
+        line->capacity = length + 1;
+    }
+    memcpy(line->text, start, length);
+    line->text[length] = '\n';
+    pushWaiting(coordinator, sequence);
+    return true;
+}
+
+/**
+ * Read more of standard input after what has not been split into lines yet.
+ * @param coordinator the coordinator
+ */
+static void readInput(Coordinator* coordinator)
+{
+    size_t available = coordinator->inputEnd - coordinator->inputStart;
+    memmove(coordinator->input, coordinator->input + coordinator->inputStart, available);
+    coordinator->inputStart = 0;
+    coordinator->inputEnd = available;
+    ssize_t n = read(STDIN_FILENO, coordinator->input + available, WORKER_BYTES - available);
+    if (n < 0 && errno == EINTR) {
+        return;
+    }
+    if (n <= 0) {
+        coordinator->inputEnded = true;
+        return;
+    }
+    coordinator->inputEnd += n;
+}
+
+/**
+ * Write out whatever has been formatted.
+ * @param buffer the formatted text
+ * @param length its length, reset to 0
+ */
+static void flushOutput(const char* buffer, size_t* length)
+{
+    writeAll(STDOUT_FILENO, buffer, *length);
+    *length = 0;
+}
+
+/**
+ * Format the finished lines that are next in input order, as pipeline mode prints them: the result, followed by
+ * " overflow" if it overflowed under wrap or saturate, or "error <status>".
+ * @param coordinator the coordinator
+ * @param output the formatted text
+ * @param length its length
+ * @param firstFailure set to the status of the first failed line, if it is still 0
+ */
+static void printReady(Coordinator* coordinator, char* output, size_t* length, int* firstFailure)
+{
+    while (coordinator->nextOutput < coordinator->nextLine) {
+        Line* line = &coordinator->lines[coordinator->nextOutput % coordinator->capacity];
+        if (!line->done) {
+            return;
+        }
+        if (line->status == 0) {
+            *length += formatRadix(line->result, line->base, output + *length);
+            if (line->overflowed) {
+                *length += sprintf(output + *length, " overflow");
+                if (*firstFailure == 0) {
+                    *firstFailure = FAIL_OVERFLOW;
+                }
+            }
+            output[(*length)++] = '\n';
+        } else {
+            *length += sprintf(output + *length, "error %d\n", line->status);
+            if (*firstFailure == 0) {
+                *firstFailure = line->status;
+            }
+        }
+        line->done = false;
+        coordinator->nextOutput++;
+        if (*length >= WRITE_CHUNK) {
+            flushOutput(output, length);
+        }
+    }
+}
+
+/**
+ * Close every worker's pipes, which ends it once it has answered what it was sent, and reap it.
+ * @param coordinator the coordinator
+ */
+static void stopWorkers(Coordinator* coordinator)
+{
+    for (int i = 0; i < coordinator->count; i++) {
+        if (coordinator->workers[i].pid > 0) {
+            close(coordinator->workers[i].requests);
+            close(coordinator->workers[i].responses);
+        }
+    }
+    for (int i = 0; i < coordinator->count; i++) {
+        if (coordinator->workers[i].pid > 0) {
+            while (waitpid(coordinator->workers[i].pid, NULL, 0) < 0 && errno == EINTR) {
+            }
+        }
+    }
+}
+
+/**
+ * Evaluates every non-blank line of standard input in worker processes and prints one line per expression, in
+ * input order. A line whose worker died prints as "error <status>" with the worker's exit status, or 128 plus the
+ * signal that killed it, and the worker is replaced.
+ * @param evaluate evaluates a single line
+ * @param settings the context each worker copies its settings from; latency is not recorded in workers
+ * @param count number of workers, or 0 for the number of processors less one (at least 1)
+ * @return the exit status of the first failed line, or 0
+ */
+int runWorkers(LineEvaluator evaluate, const EvalContext* settings, int count)
+{
+    if (count <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        count = processors > 2 ? (int)processors - 1 : 1;
+    }
+    Coordinator coordinator = { .evaluate = evaluate, .settings = settings, .count = count };
+    coordinator.capacity = (size_t)count * WORKER_WINDOW;
+    coordinator.workers = calloc(count, sizeof(Worker));
+    coordinator.lines = calloc(coordinator.capacity, sizeof(Line));
+    coordinator.waiting = malloc(coordinator.capacity * sizeof(uint64_t));
+    coordinator.input = malloc(WORKER_BYTES);
+    char* output = malloc(WRITE_CHUNK + RADIX_MAX_DIGITS + 16);
+    struct pollfd* polls = malloc((count + 1) * sizeof(struct pollfd));
+    void* shared = mmap(NULL, count * sizeof(WorkerProgress), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    coordinator.progress = shared != MAP_FAILED ? shared : NULL;
+
+    // Sending to a worker that just died must fail rather than end the coordinator
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    bool ready = coordinator.workers != NULL && coordinator.lines != NULL && coordinator.waiting != NULL
+                 && coordinator.input != NULL && output != NULL && polls != NULL && coordinator.progress != NULL;
+    for (int i = 0; ready && i < count; i++) {
+        ready = spawnWorker(&coordinator, i) == 0;
+    }
+    if (!ready) {
+        fprintf(stderr, "Error: Cannot start the workers.\n");
+    }
+
+    size_t length = 0;
+    int firstFailure = 0;
+    bool running = ready;
+    while (running) {
+        // Hand out lines while the workers and the reordering window have room, then print what is next in order
+        bool roomy = false;
+        for (;;) {
+            dispatch(&coordinator);
+            roomy = coordinator.waitingCount == 0 && coordinator.nextLine - coordinator.nextOutput < coordinator.capacity;
+            if (!roomy || !takeLine(&coordinator)) {
+                break;
+            }
+        }
+        uint64_t printed = coordinator.nextOutput;
+        printReady(&coordinator, output, &length, &firstFailure);
+        if (coordinator.inputEnded && coordinator.inputStart == coordinator.inputEnd && !coordinator.tooLong
+            && coordinator.nextOutput == coordinator.nextLine) {
+            break;
+        }
+        if (!roomy && coordinator.nextOutput != printed && coordinator.waitingCount == 0) {
+            // Printing made room for more lines
+            continue;
+        }
+
+        flushOutput(output, &length);
+        int polled = 0;
+        if (roomy && !coordinator.inputEnded) {
+            polls[polled++] = (struct pollfd){ .fd = STDIN_FILENO, .events = POLLIN };
+        }
+        for (int i = 0; i < count; i++) {
+            polls[polled++] = (struct pollfd){ .fd = coordinator.workers[i].responses, .events = POLLIN };
+        }
+        if (poll(polls, polled, -1) < 0) {
+            continue;
+        }
+        int first = polled - count;
+        if (first == 1 && polls[0].revents != 0) {
+            readInput(&coordinator);
+        }
+        for (int i = 0; i < count; i++) {
+            if (polls[first + i].revents != 0 && !readResults(&coordinator, &coordinator.workers[i])
+                && replaceWorker(&coordinator, i) != 0) {
+                fprintf(stderr, "Error: Cannot restart a worker.\n");
+                running = false;
+                ready = false;
+                break;
+            }
+        }
+    }
+    flushOutput(output, &length);
+
+    if (coordinator.workers != NULL) {
+        stopWorkers(&coordinator);
+    }
+    for (size_t i = 0; coordinator.lines != NULL && i < coordinator.capacity; i++) {
+        free(coordinator.lines[i].text);
+    }
+    if (coordinator.progress != NULL) {
+        munmap(coordinator.progress, count * sizeof(WorkerProgress));
+    }
+    free(coordinator.workers);
+    free(coordinator.lines);
+    free(coordinator.waiting);
+    free(coordinator.input);
+    free(output);
+    free(polls);
+    return ready ? firstFailure : FAIL_INPUT;
+}
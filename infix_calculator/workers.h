@@ -0,0 +1,26 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stdint.h>
+
+#include "pipeline.h"
+
+/** Most lines a worker is sent before it answers the first of them. */
+#define WORKER_WINDOW 256
+
+/** Most bytes of lines a worker is sent before it answers them; no more than a pipe holds. */
+#define WORKER_BYTES 65536
+
+/** A worker's answer for one line, written back in the order the lines came. */
+typedef struct {
+    int64_t result;
+    int32_t status;
+    uint8_t base;
+    uint8_t overflowed;
+    uint16_t reserved;
+} WorkerResult;
+
+/** Function to evaluate every line of standard input in worker processes, restarting any that die*/
+int runWorkers(LineEvaluator evaluate, const EvalContext* settings, int count);
+
+#endif /*WORKERS_H*/